@@ -13,7 +13,15 @@ SOURCES += \
         keyvaluemodel.cpp                      \
         main.cpp                               \
         mainwindow.cpp                         \
+        mapfileloader.cpp                      \
+        mapfilesaver.cpp                       \
         mapscene.cpp                           \
+        maprenderer.cpp                        \
+        maptiles.cpp                           \
+        refreshscheduler.cpp                   \
+        profilerdock.cpp                       \
+        layersortfiltermodel.cpp               \
+        layertabledock.cpp                     \
         mapsettings.cpp                        \
         layersettings.cpp                      \
         layersettingsvector.cpp                \
@@ -21,6 +29,9 @@ SOURCES += \
         fontsettings.cpp                       \
         commands/changemapnamecommand.cpp      \
         commands/changemapstatuscommand.cpp    \
+        commands/commandjournal.cpp            \
+        commands/continuousedit.cpp            \
+        commands/journalfactory.cpp            \
         commands/layercommands.cpp             \
         commands/outputformatcommands.cpp      \
         commands/setanglecommand.cpp           \
@@ -40,8 +51,12 @@ SOURCES += \
         commands/setshapepathcommand.cpp       \
         commands/setsymbolsetcommand.cpp       \
         commands/settemplatepatterncommand.cpp \
+        commands/undobudget.cpp                \
         parser/layer.cpp                       \
         parser/mapfileparser.cpp               \
+        parser/mapfilepatcher.cpp              \
+        parser/mapfilesnapshot.cpp             \
+        parser/ogcrequests.cpp                 \
         parser/outputformat.cpp \
     layerclasssettings.cpp \
     classstylesetting.cpp
@@ -49,7 +64,15 @@ SOURCES += \
 HEADERS  += \
     keyvaluemodel.h                         \
     mainwindow.h                            \
+    mapfileloader.h                         \
+    mapfilesaver.h                          \
     mapscene.h                              \
+    maprenderer.h                           \
+    maptiles.h                              \
+    refreshscheduler.h                      \
+    profilerdock.h                          \
+    layersortfiltermodel.h                  \
+    layertabledock.h                        \
     mapsettings.h                           \
     layersettings.h                         \
     layersettingsvector.h                   \
@@ -57,6 +80,9 @@ HEADERS  += \
     fontsettings.h                          \
     commands/changemapnamecommand.h         \
     commands/changemapstatuscommand.h       \
+    commands/commandids.h                   \
+    commands/commandjournal.h               \
+    commands/continuousedit.h               \
     commands/layercommands.h                \
     commands/outputformatcommands.h         \
     commands/setanglecommand.h              \
@@ -76,8 +102,12 @@ HEADERS  += \
     commands/setshapepathcommand.h          \
     commands/setsymbolsetcommand.h          \
     commands/settemplatepatterncommand.h    \
+    commands/undobudget.h                   \
     parser/layer.h                          \
     parser/mapfileparser.h                  \
+    parser/mapfilepatcher.h                 \
+    parser/mapfilesnapshot.h                \
+    parser/ogcrequests.h                    \
     parser/outputformat.h \
     layerclasssettings.h \
     classstylesetting.h
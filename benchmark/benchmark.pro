@@ -0,0 +1,19 @@
+TEMPLATE = app
+TARGET = benchmark
+INCLUDEPATH += .
+
+INCLUDEPATH += "/usr/include/mapserver" \
+               "/usr/include/gdal"
+
+LIBS += -lmapserver -lgdal
+
+# headless: no widgets, no display needed
+QT -= widgets
+CONFIG += console debug_and_release
+CONFIG -= app_bundle
+
+QMAKE_CLEAN += $(TARGET)
+
+# Input
+HEADERS += mapbenchmark.h ../parser/mapfileparser.h ../parser/mapfilepatcher.h ../parser/mapfilesnapshot.h ../parser/ogcrequests.h ../parser/outputformat.h ../parser/layer.h
+SOURCES += main.cpp mapbenchmark.cpp ../parser/mapfileparser.cpp ../parser/mapfilepatcher.cpp ../parser/mapfilesnapshot.cpp ../parser/ogcrequests.cpp ../parser/outputformat.cpp ../parser/layer.cpp
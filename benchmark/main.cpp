@@ -0,0 +1,56 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+
+#include "mapbenchmark.h"
+
+/**
+ * Headless benchmark of a mapfile rendering, e.g.:
+ *
+ *   benchmark world.map -n 500 -j 4 -s 256x256 -s 1024x768
+ */
+int main(int argc, char ** argv) {
+  QCoreApplication app(argc, argv);
+  QStringList args = app.arguments();
+
+  if ((args.size() < 2) || args.at(1).startsWith("-")) {
+    QTextStream(stderr) << MapBenchmark::usage(args.at(0)) << "\n";
+    return 1;
+  }
+
+  MapBenchmark benchmark(args.at(1));
+  if (! benchmark.parseArguments(args.mid(2))) {
+    QTextStream(stderr) << MapBenchmark::usage(args.at(0)) << "\n";
+    return 1;
+  }
+
+  return benchmark.exec(app.applicationFilePath());
+}
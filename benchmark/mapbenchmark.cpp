@@ -0,0 +1,244 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QTextStream>
+#include <QtCore/QDebug>
+
+#include "mapbenchmark.h"
+#include "../parser/mapfileparser.h"
+
+MapBenchmark::MapBenchmark(QString const & mapfile) :
+    mapfile(mapfile), renderCount(100), workerCount(1), worker(-1) {}
+
+QString MapBenchmark::usage(QString const & program) {
+  return QString("Usage: %1 <mapfile> [-n renders] [-j workers]"
+                 " [-e minx,miny,maxx,maxy]... [-s WIDTHxHEIGHT]...\n"
+                 "\n"
+                 "  -n  number of renders (default: 100)\n"
+                 "  -j  number of worker processes (default: 1)\n"
+                 "  -e  extent to render, can be repeated (default: the mapfile one)\n"
+                 "  -s  image size, can be repeated (default: the mapfile one)\n"
+                 "\n"
+                 "Renders are spread over the extents and sizes in turn.").arg(program);
+}
+
+bool MapBenchmark::parseArguments(QStringList const & args) {
+  for (int i = 0; i < args.size(); ++i) {
+    QString const & opt = args.at(i);
+    if (i + 1 >= args.size()) {
+      return false;
+    }
+    QString value = args.at(++i);
+    bool ok = true;
+
+    if (opt == "-n") {
+      renderCount = value.toInt(& ok);
+      ok = ok && (renderCount > 0);
+    } else if (opt == "-j") {
+      workerCount = value.toInt(& ok);
+      ok = ok && (workerCount > 0);
+    } else if (opt == "--worker") {
+      worker = value.toInt(& ok);
+    } else if (opt == "-e") {
+      QStringList coords = value.split(",");
+      ok = (coords.size() == 4);
+      double c[4];
+      for (int j = 0; ok && (j < 4); ++j) {
+        c[j] = coords.at(j).toDouble(& ok);
+      }
+      if (ok) {
+        extents << QRectF(QPointF(c[0], c[1]), QPointF(c[2], c[3]));
+      }
+    } else if (opt == "-s") {
+      QStringList size = value.split("x");
+      ok = (size.size() == 2);
+      int w = ok ? size.at(0).toInt(& ok) : 0;
+      int h = ok ? size.at(1).toInt(& ok) : 0;
+      ok = ok && (w > 0) && (h > 0);
+      if (ok) {
+        sizes << QSize(w, h);
+      }
+    } else {
+      ok = false;
+    }
+
+    if (! ok) {
+      qDebug() << "Invalid option" << opt << value;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Returns the value below which the given percentage of the (sorted) values
+ * fall, using the nearest-rank method.
+ */
+double MapBenchmark::percentile(QList<double> const & sorted, double p) {
+  if (sorted.isEmpty()) {
+    return 0.0;
+  }
+  int rank = (int) std::ceil(p / 100.0 * sorted.size());
+  return sorted.at(qBound(1, rank, sorted.size()) - 1);
+}
+
+QStringList MapBenchmark::workerArguments(int worker) const {
+  QStringList args;
+  args << mapfile << "-n" << QString::number(renderCount) << "-j" << QString::number(workerCount);
+  for (int i = 0; i < extents.size(); ++i) {
+    args << "-e" << QString("%1,%2,%3,%4").arg(extents[i].left(), 0, 'g', 17).arg(extents[i].top(), 0, 'g', 17)
+                                          .arg(extents[i].right(), 0, 'g', 17).arg(extents[i].bottom(), 0, 'g', 17);
+  }
+  for (int i = 0; i < sizes.size(); ++i) {
+    args << "-s" << QString("%1x%2").arg(sizes[i].width()).arg(sizes[i].height());
+  }
+  args << "--worker" << QString::number(worker);
+  return args;
+}
+
+/**
+ * Renders every step-th image, starting from the first one.
+ */
+QList<double> MapBenchmark::render(int first, int step, double * elapsed) {
+  QList<double> latencies;
+  MapfileParser parser(mapfile);
+  if (! parser.isLoaded()) {
+    qDebug() << "Unable to load the mapfile" << mapfile;
+    * elapsed = 0.0;
+    return latencies;
+  }
+
+  if (extents.isEmpty()) {
+    extents << QRectF(QPointF(parser.getMapExtentMinX(), parser.getMapExtentMinY()),
+                      QPointF(parser.getMapExtentMaxX(), parser.getMapExtentMaxY()));
+  }
+  if (sizes.isEmpty()) {
+    sizes << QSize(parser.getMapWidth(), parser.getMapHeight());
+  }
+
+  QElapsedTimer total, timer;
+  total.start();
+  for (int i = first; i < renderCount; i += step) {
+    QRectF const & extent = extents.at(i % extents.size());
+    QSize const & size = sizes.at(i % sizes.size());
+
+    parser.setMapExtent(extent.left(), extent.top(), extent.right(), extent.bottom());
+    timer.start();
+    unsigned char * image = parser.getCurrentMapImage(size.width(), size.height());
+    double latency = timer.nsecsElapsed() / 1.0e6;
+
+    latencies << ((image && parser.getCurrentMapImageSize() > 0) ? latency : -1.0);
+  }
+  * elapsed = total.nsecsElapsed() / 1.0e6;
+  return latencies;
+}
+
+/**
+ * Worker process: renders its share of the images, and gives the latencies
+ * back to the main process on the standard output.
+ */
+int MapBenchmark::runWorker() {
+  double elapsed = 0.0;
+  QList<double> latencies = render(worker, workerCount, & elapsed);
+
+  QTextStream out(stdout);
+  for (int i = 0; i < latencies.size(); ++i) {
+    out << latencies[i] << "\n";
+  }
+  out << "elapsed " << elapsed << "\n";
+  return latencies.isEmpty() ? 1 : 0;
+}
+
+int MapBenchmark::exec(QString const & program) {
+  if (worker >= 0) {
+    return runWorker();
+  }
+
+  QList<double> latencies;
+  double elapsed = 0.0;
+
+  if (workerCount == 1) {
+    latencies = render(0, 1, & elapsed);
+  } else {
+    QList<QProcess *> workers;
+    for (int i = 0; i < workerCount; ++i) {
+      QProcess * process = new QProcess();
+      process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+      process->start(program, workerArguments(i));
+      workers << process;
+    }
+    for (int i = 0; i < workers.size(); ++i) {
+      workers[i]->waitForFinished(-1);
+      QList<QByteArray> lines = workers[i]->readAllStandardOutput().split('\n');
+      for (int j = 0; j < lines.size(); ++j) {
+        QByteArray line = lines[j].trimmed();
+        if (line.startsWith("elapsed ")) {
+          // workers are running concurrently, the slowest one gives the pace
+          elapsed = qMax(elapsed, line.mid(8).toDouble());
+        } else if (! line.isEmpty()) {
+          latencies << line.toDouble();
+        }
+      }
+      delete workers[i];
+    }
+  }
+  return report(latencies, elapsed);
+}
+
+int MapBenchmark::report(QList<double> const & latencies, double elapsed) {
+  QList<double> succeeded;
+  for (int i = 0; i < latencies.size(); ++i) {
+    if (latencies[i] >= 0) {
+      succeeded << latencies[i];
+    }
+  }
+  std::sort(succeeded.begin(), succeeded.end());
+
+  int failed = renderCount - succeeded.size();
+
+  QTextStream out(stdout);
+  out << "mapfile:    " << mapfile << "\n";
+  out << "renders:    " << succeeded.size() << " (" << failed << " failed, "
+      << workerCount << " worker(s))\n";
+  if (! succeeded.isEmpty()) {
+    out << "latency ms: min " << succeeded.first()
+        << " / median " << percentile(succeeded, 50)
+        << " / p95 " << percentile(succeeded, 95)
+        << " / p99 " << percentile(succeeded, 99)
+        << " / max " << succeeded.last() << "\n";
+  }
+  if (elapsed > 0) {
+    out << "throughput: " << succeeded.size() / (elapsed / 1000.0) << " renders/s\n";
+  }
+  return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#ifndef MAPBENCHMARK_H
+#define MAPBENCHMARK_H
+
+#include <QList>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+/**
+ * Renders a mapfile repeatedly over a set of extents and image sizes, and
+ * measures the latency of each render.
+ *
+ * The renders are spread over several worker processes (the benchmark
+ * binary itself, launched with the --worker option), each of them loading
+ * its own copy of the mapfile.
+ */
+class MapBenchmark {
+
+ public:
+  MapBenchmark(QString const & mapfile);
+
+  bool parseArguments(QStringList const & args);
+  static QString usage(QString const & program);
+
+  int exec(QString const & program);
+
+  // nearest-rank percentile of sorted values
+  static double percentile(QList<double> const & sorted, double p);
+
+ private:
+  QString mapfile;
+  int renderCount;
+  int workerCount;
+  // index of the current worker process, -1 for the main one
+  int worker;
+  QList<QRectF> extents;
+  QList<QSize> sizes;
+
+  int runWorker();
+  int report(QList<double> const & latencies, double elapsed);
+
+  QStringList workerArguments(int worker) const;
+  // latencies (in ms) of the renders done by this process, negative values
+  // for the failed ones.
+  QList<double> render(int first, int step, double * elapsed);
+};
+
+#endif // MAPBENCHMARK_H
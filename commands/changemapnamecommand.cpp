@@ -44,3 +44,10 @@ void ChangeMapNameCommand::redo(void) {
   parser->setMapName(this->newName);
 }
 
+int ChangeMapNameCommand::journalId() const {
+  return CHANGE_MAP_NAME_COMMAND;
+}
+
+void ChangeMapNameCommand::writeJournal(QDataStream & out) const {
+  out << newName;
+}
@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class ChangeMapNameCommand : public QUndoCommand {
+class ChangeMapNameCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeMapNameCommand(QString, MapfileParser *, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString oldName;
@@ -43,3 +43,10 @@ void ChangeMapStatusCommand::redo(void) {
   parser->setMapStatus(this->newStatus);
 }
 
+int ChangeMapStatusCommand::journalId() const {
+  return CHANGE_MAP_STATUS_COMMAND;
+}
+
+void ChangeMapStatusCommand::writeJournal(QDataStream & out) const {
+  out << newStatus;
+}
@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class ChangeMapStatusCommand : public QUndoCommand {
+class ChangeMapStatusCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeMapStatusCommand(bool newStatus, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    bool oldStatus;
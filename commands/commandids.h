@@ -0,0 +1,81 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#ifndef COMMANDIDS_H
+#define COMMANDIDS_H
+
+/**
+ * Identifiers of the commands.
+ *
+ * Those which can be merged return theirs from QUndoCommand::id(): consecutive
+ * changes of the same value, such as the steps of a slider, end up as a
+ * single entry of the undo stack.
+ *
+ * All of them are written in the recovery journal (see CommandJournal), new
+ * identifiers have to be appended so that the existing journals still read.
+ */
+enum CommandId {
+  SET_ANGLE_COMMAND = 1,
+  SET_MAP_EXTENT_COMMAND,
+  SET_MAP_SIZE_COMMAND,
+  SET_RESOLUTION_COMMAND,
+  SET_DEF_RESOLUTION_COMMAND,
+  SET_IMAGE_COLOR_COMMAND,
+  CHANGE_LAYER_OPACITY_COMMAND,
+  CHANGE_LAYER_MIN_SCALE_DENOM_COMMAND,
+  CHANGE_LAYER_MAX_SCALE_DENOM_COMMAND,
+  CHANGE_MAP_NAME_COMMAND,
+  CHANGE_MAP_STATUS_COMMAND,
+  SET_CONFIG_OPTION_COMMAND,
+  SET_DATA_PATTERN_COMMAND,
+  SET_FONT_SET_COMMAND,
+  SET_MAP_DEBUG_COMMAND,
+  SET_MAP_MAX_SIZE_COMMAND,
+  SET_MAP_PROJECTION_COMMAND,
+  SET_MAP_UNITS_COMMAND,
+  SET_METADATA_COMMAND,
+  SET_SHAPE_PATH_COMMAND,
+  SET_SYMBOL_SET_COMMAND,
+  SET_TEMPLATE_PATTERN_COMMAND,
+  ADD_LAYER_COMMAND,
+  REMOVE_LAYER_COMMAND,
+  CHANGE_LAYER_NAME_COMMAND,
+  CHANGE_LAYER_STATUS_COMMAND,
+  CHANGE_LAYER_REQUIRES_COMMAND,
+  CHANGE_LAYER_MASK_COMMAND,
+  CHANGE_LAYER_GROUP_COMMAND,
+  CHANGE_LAYER_DEBUG_LEVEL_COMMAND,
+  CHANGE_LAYER_TEMPLATE_COMMAND,
+  CHANGE_LAYER_HEADER_COMMAND,
+  CHANGE_LAYER_FOOTER_COMMAND,
+  ADD_OUTPUT_FORMAT_COMMAND,
+  REMOVE_OUTPUT_FORMAT_COMMAND,
+  UPDATE_OUTPUT_FORMAT_COMMAND,
+  SET_DEFAULT_OUTPUT_FORMAT_COMMAND
+};
+
+#endif // COMMANDIDS_H
@@ -0,0 +1,251 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#include <QDebug>
+
+#include "commandjournal.h"
+#include "../mapfileloader.h"
+
+CommandJournal::CommandJournal(QUndoStack * stack, QObject * parent) :
+  QObject(parent), stack(stack), base(0), lastIndex(0), suspended(false)
+{
+  this->connect(stack, SIGNAL(indexChanged(int)), SLOT(indexChanged(int)));
+}
+
+CommandJournal::~CommandJournal() {}
+
+QString CommandJournal::getJournalPath(QString const & mapfilePath) {
+  return mapfilePath + ".journal";
+}
+
+bool CommandJournal::isActive() const {
+  return this->file.isOpen();
+}
+
+bool CommandJournal::isSuspended() const {
+  return this->suspended;
+}
+
+bool CommandJournal::start(QString const & mapfilePath) {
+  this->discard();
+  this->mapfilePath = mapfilePath;
+  this->commands.clear();
+  for (int i = 0; i < this->stack->count(); ++i) {
+    this->commands << this->stack->command(i);
+  }
+  this->base = this->stack->index();
+  this->lastIndex = this->base;
+  this->suspended = false;
+  this->contentHash = MapfileLoader::computeContentHash(mapfilePath);
+  return this->writeHeader();
+}
+
+/**
+ * Starts over from the state which has been saved: the commands which can
+ * still be redone from there are written again, so that the index of the
+ * stack can be restored. The records are replayed on top of the saved state,
+ * which is the clean one of the recovered stack then.
+ */
+void CommandJournal::reset() {
+  if (this->mapfilePath.isEmpty()) {
+    return;
+  }
+  int clean = this->stack->cleanIndex();
+  // the saved state is no longer part of the stack
+  if (clean < 0) {
+    this->suspend();
+    return;
+  }
+  this->base = clean;
+  this->lastIndex = this->stack->index();
+  this->suspended = false;
+  // the save may have rewritten any of the files
+  this->contentHash = MapfileLoader::computeContentHash(this->mapfilePath);
+  if (! this->writeHeader()) {
+    return;
+  }
+  for (int i = this->base; i < this->stack->count(); ++i) {
+    this->writeCommand(PUSH, this->stack->command(i));
+  }
+  if (this->stack->index() != this->stack->count()) {
+    this->writeRecord(SET_INDEX, this->stack->index() - this->base);
+  }
+}
+
+void CommandJournal::discard() {
+  this->file.close();
+  if (! this->mapfilePath.isEmpty()) {
+    QFile::remove(getJournalPath(this->mapfilePath));
+  }
+  this->mapfilePath.clear();
+  this->commands.clear();
+}
+
+/**
+ * The kind of change is found out by comparing the stack to the commands
+ * known from the records written so far.
+ */
+void CommandJournal::indexChanged(int index) {
+  if ((! this->isActive()) || this->suspended) {
+    return;
+  }
+  int previous = this->lastIndex;
+  this->lastIndex = index;
+
+  if (this->stack->count() == 0) {
+    // the mapfile on disk is the new starting point only if the history was
+    // cleared at the saved state (not when collapsed by UndoBudget)
+    if (previous != this->base) {
+      this->suspend();
+      return;
+    }
+    this->commands.clear();
+    this->base = 0;
+    this->writeRecord(CLEAR);
+    return;
+  }
+  if (index < this->base) {
+    this->suspend();
+    return;
+  }
+
+  QUndoCommand const * top = (index > 0) ? this->stack->command(index - 1) : NULL;
+  // QUndoStack::push() notifies a merge without changing the index
+  if (index == previous) {
+    // the command merged into was there before the saved state
+    if (index <= this->base) {
+      this->suspend();
+    } else {
+      this->writeCommand(MERGE, top);
+    }
+    return;
+  }
+  // the commands which could be redone are replaced by the pushed one
+  if ((index == previous + 1) && (index == this->stack->count()) && (this->commands.value(index - 1) != top)) {
+    this->commands = this->commands.mid(0, index - 1);
+    this->commands << top;
+    this->writeCommand(PUSH, top);
+    return;
+  }
+  this->writeRecord(SET_INDEX, index - this->base);
+}
+
+bool CommandJournal::writeHeader() {
+  this->file.close();
+  this->file.setFileName(getJournalPath(this->mapfilePath));
+  // each record reaches the system as soon as it is written, and outlives a
+  // crash of the application
+  if (! this->file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+    qWarning() << "Unable to write the journal" << this->file.fileName();
+    return false;
+  }
+  QByteArray header;
+  QDataStream out(& header, QIODevice::WriteOnly);
+  out.setVersion(STREAM_VERSION);
+  out << MAGIC << VERSION << this->contentHash;
+  if (this->file.write(header) != header.size()) {
+    this->file.close();
+    return false;
+  }
+  return true;
+}
+
+// nothing can be recovered until the next save
+void CommandJournal::suspend() {
+  if (this->mapfilePath.isEmpty()) {
+    return;
+  }
+  this->suspended = true;
+  this->writeHeader();
+}
+
+void CommandJournal::writeCommand(RecordKind kind, QUndoCommand const * command) {
+  JournaledCommand const * journaled = dynamic_cast<JournaledCommand const *>(command);
+  if ((! journaled) || (! journaled->isJournalable())) {
+    qWarning() << "Unable to journal the command" << command->text();
+    this->suspend();
+    return;
+  }
+  QByteArray payload;
+  QDataStream out(& payload, QIODevice::WriteOnly);
+  out.setVersion(STREAM_VERSION);
+  journaled->writeJournal(out);
+  this->writeRecord(kind, journaled->journalId(), payload);
+}
+
+void CommandJournal::writeRecord(RecordKind kind, int value, QByteArray const & payload) {
+  QByteArray record;
+  QDataStream out(& record, QIODevice::WriteOnly);
+  out.setVersion(STREAM_VERSION);
+  out << quint8(kind) << qint32(value) << payload;
+  // written at once, a crash leaves at worst the last record truncated
+  if (this->file.write(record) != record.size()) {
+    qWarning() << "Unable to write the journal" << this->file.fileName();
+    this->file.close();
+  }
+}
+
+bool CommandJournal::read(QString const & mapfilePath, QList<Record> & records) {
+  records.clear();
+  QFile journal(getJournalPath(mapfilePath));
+  if (! journal.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QDataStream in(& journal);
+  in.setVersion(STREAM_VERSION);
+
+  quint32 magic, version;
+  QByteArray contentHash;
+  in >> magic >> version >> contentHash;
+  if ((in.status() != QDataStream::Ok) || (magic != MAGIC) || (version != VERSION)) {
+    return false;
+  }
+  // the mapfile, or one of its included files, has been saved (or modified
+  // elsewhere) since
+  if (contentHash != MapfileLoader::computeContentHash(mapfilePath)) {
+    return false;
+  }
+
+  forever {
+    quint8 kind;
+    qint32 value;
+    QByteArray payload;
+    in >> kind >> value >> payload;
+    // the last record may have been partly written when crashing
+    if ((in.status() != QDataStream::Ok) || (kind < PUSH) || (kind > CLEAR)) {
+      break;
+    }
+    Record record;
+    record.kind = RecordKind(kind);
+    record.commandId = ((kind == PUSH) || (kind == MERGE)) ? value : 0;
+    record.payload = payload;
+    record.index = (kind == SET_INDEX) ? value : 0;
+    records << record;
+  }
+  return ! records.isEmpty();
+}
@@ -0,0 +1,147 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#ifndef COMMANDJOURNAL_H
+#define COMMANDJOURNAL_H
+
+#include <QDataStream>
+#include <QFile>
+#include <QList>
+#include <QObject>
+#include <QUndoCommand>
+#include <QUndoStack>
+
+class MainWindow;
+class MapfileParser;
+
+/**
+ * Implemented by the commands which can be written into the recovery
+ * journal, so that they can be created again after a crash (see
+ * createJournaledCommand()).
+ */
+class JournaledCommand {
+ public:
+  virtual ~JournaledCommand() {}
+
+  // one of CommandId, telling how to read the values back
+  virtual int journalId() const = 0;
+  // writes the values given to the constructor
+  virtual void writeJournal(QDataStream &) const = 0;
+  // false if these values would not tell what the command applies to when
+  // read back, e.g. a layer sharing its name with another one
+  virtual bool isJournalable() const { return true; }
+};
+
+/**
+ * Records the edits of a mapfile which has not been saved yet, by appending
+ * each command pushed onto the undo stack (and each undo / redo) to a compact
+ * binary file next to the mapfile. After a crash, the records are replayed
+ * on top of the file as it was last saved.
+ *
+ * The journal starts over once the mapfile is saved, so that its size is
+ * proportional to the number of unsaved edits, not to the size of the
+ * mapfile. Undoing past the saved state cannot be expressed as records, the
+ * journal is emptied until the next save in this case.
+ */
+class CommandJournal : public QObject {
+
+ Q_OBJECT
+
+ public:
+  enum RecordKind {
+    // a command pushed onto the stack
+    PUSH = 1,
+    // a command merged into the one on top of the stack
+    MERGE,
+    // undo / redo, the index is relative to the saved state
+    SET_INDEX,
+    // the history has been cleared at the saved state
+    CLEAR
+  };
+
+  struct Record {
+    RecordKind kind;
+    // PUSH and MERGE only
+    int commandId;
+    QByteArray payload;
+    // SET_INDEX only
+    int index;
+  };
+
+  CommandJournal(QUndoStack * stack, QObject * parent = 0);
+  ~CommandJournal();
+
+  // journals the edits of the given mapfile, made on top of the file as it is
+  bool start(QString const & mapfilePath);
+  // the mapfile has been saved as it was at the clean index of the stack
+  void reset();
+  // stops journaling, removing the journal
+  void discard();
+  // nothing can be recovered until the next save
+  void suspend();
+
+  bool isActive() const;
+  bool isSuspended() const;
+
+  static QString getJournalPath(QString const & mapfilePath);
+  // reads the journal of the given mapfile, false if there is none applying
+  // to the mapfile as it is on disk
+  static bool read(QString const & mapfilePath, QList<Record> & records);
+
+  static const quint32 MAGIC = 0x514d454a;
+  static const quint32 VERSION = 1;
+  // the records are read back by later versions
+  static const QDataStream::Version STREAM_VERSION = QDataStream::Qt_4_8;
+
+ private slots:
+  void indexChanged(int);
+
+ private:
+  bool writeHeader();
+  void writeCommand(RecordKind, QUndoCommand const *);
+  void writeRecord(RecordKind, int value = 0, QByteArray const & payload = QByteArray());
+
+  QUndoStack * stack;
+  QFile file;
+  QString mapfilePath;
+  // identifies the files the records apply to (see
+  // MapfileLoader::computeContentHash())
+  QByteArray contentHash;
+  // the commands of the stack, as known from the last records written
+  QList<QUndoCommand const *> commands;
+  // index of the stack matching the mapfile on disk
+  int base;
+  int lastIndex;
+  bool suspended;
+};
+
+// creates a command from its journal record, NULL if it does not apply to
+// the mapfile (see journalfactory.cpp)
+QUndoCommand * createJournaledCommand(int commandId, QByteArray const & payload, MapfileParser *, MainWindow *);
+
+#endif // COMMANDJOURNAL_H
@@ -0,0 +1,56 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#include <QDateTime>
+
+#include "continuousedit.h"
+
+const qint64 ContinuousEdit::DEFAULT_INTERVAL;
+const qint64 ContinuousEdit::ALWAYS;
+
+qint64 ContinuousEdit::interval = ContinuousEdit::DEFAULT_INTERVAL;
+
+ContinuousEdit::ContinuousEdit() : time(QDateTime::currentMSecsSinceEpoch()) {}
+
+bool ContinuousEdit::continuesWith(ContinuousEdit const & next) {
+  qint64 elapsed = next.time - this->time;
+  // the clock may have been set back in between
+  if ((elapsed < 0) || (elapsed >= interval)) {
+    return false;
+  }
+  this->time = next.time;
+  return true;
+}
+
+qint64 ContinuousEdit::getInterval() {
+  return interval;
+}
+
+void ContinuousEdit::setInterval(qint64 msecs) {
+  interval = msecs;
+}
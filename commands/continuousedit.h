@@ -0,0 +1,65 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#ifndef CONTINUOUSEDIT_H
+#define CONTINUOUSEDIT_H
+
+#include <QtGlobal>
+
+/**
+ * Tells the successive changes of a setting made in one continuous
+ * interaction (e.g. while dragging a slider), which are merged into a single
+ * undo step, from the deliberate ones (e.g. each validation of a dialog),
+ * which are kept apart.
+ *
+ * Changes are continuous as long as each one comes less than getInterval()
+ * milliseconds after the previous one.
+ */
+class ContinuousEdit {
+ public:
+  ContinuousEdit();
+
+  // true if the given change continues this one, which is then extended to it
+  bool continuesWith(ContinuousEdit const & next);
+
+  static qint64 getInterval();
+  // 0 keeps every change apart, ALWAYS merges them all (e.g. when replaying
+  // the journal, see MainWindow::recoverUnsavedEdits())
+  static void setInterval(qint64 msecs);
+
+  static const qint64 DEFAULT_INTERVAL = 500;
+  static const qint64 ALWAYS = Q_INT64_C(0x7fffffffffffffff);
+
+ private:
+  // time of the last change, in milliseconds since the epoch
+  qint64 time;
+
+  static qint64 interval;
+};
+
+#endif // CONTINUOUSEDIT_H
@@ -0,0 +1,247 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#include "commandjournal.h"
+#include "changemapnamecommand.h"
+#include "changemapstatuscommand.h"
+#include "layercommands.h"
+#include "outputformatcommands.h"
+#include "setanglecommand.h"
+#include "setconfigoptioncommand.h"
+#include "setdatapatterncommand.h"
+#include "setdefresolutioncommand.h"
+#include "setfontsetcommand.h"
+#include "setimagecolorcommand.h"
+#include "setmapdebugcommand.h"
+#include "setmapextentcommand.h"
+#include "setmapmaxsizecommand.h"
+#include "setmapprojectioncommand.h"
+#include "setmapsizecommand.h"
+#include "setmapunitscommand.h"
+#include "setmetadatacommand.h"
+#include "setresolutioncommand.h"
+#include "setshapepathcommand.h"
+#include "setsymbolsetcommand.h"
+#include "settemplatepatterncommand.h"
+
+/**
+ * Creation of the commands from their journal records (see CommandJournal),
+ * reading the values in the order they are written by writeJournal().
+ */
+
+template <typename T>
+static T readValue(QDataStream & in) {
+  T value;
+  in >> value;
+  return value;
+}
+
+// the layers are identified by their names in the records
+static Layer * findLayer(MapfileParser * parser, QString const & name) {
+  return parser->getLayer(parser->getLayerIndex(name));
+}
+
+// commands of the layer settings, made of the layer and its old / new value
+template <class C, typename T>
+static QUndoCommand * createLayerCommand(QDataStream & in, MapfileParser * parser) {
+  QString name;
+  T oldValue, newValue;
+  in >> name >> oldValue >> newValue;
+  Layer * layer = findLayer(parser, name);
+  if ((! layer) || (in.status() != QDataStream::Ok)) {
+    return NULL;
+  }
+  return new C(layer, oldValue, newValue);
+}
+
+QUndoCommand * createJournaledCommand(int commandId, QByteArray const & payload, MapfileParser * parser, MainWindow * mainwindow) {
+  QDataStream in(payload);
+  in.setVersion(CommandJournal::STREAM_VERSION);
+  QUndoCommand * command = NULL;
+
+  switch (commandId) {
+    // map settings
+    case CHANGE_MAP_NAME_COMMAND:
+      command = new ChangeMapNameCommand(readValue<QString>(in), parser);
+      break;
+    case CHANGE_MAP_STATUS_COMMAND:
+      command = new ChangeMapStatusCommand(readValue<bool>(in), parser);
+      break;
+    case SET_ANGLE_COMMAND:
+      command = new SetAngleCommand(readValue<float>(in), parser);
+      break;
+    case SET_CONFIG_OPTION_COMMAND: {
+      QString key, value;
+      in >> key >> value;
+      command = new SetConfigOptionCommand(key, value, parser);
+      break;
+    }
+    case SET_DATA_PATTERN_COMMAND:
+      command = new SetDataPatternCommand(readValue<QString>(in), parser);
+      break;
+    case SET_DEF_RESOLUTION_COMMAND:
+      command = new SetDefResolutionCommand(readValue<double>(in), parser);
+      break;
+    case SET_FONT_SET_COMMAND:
+      command = new SetFontSetCommand(readValue<QString>(in), parser);
+      break;
+    case SET_IMAGE_COLOR_COMMAND:
+      command = new SetImageColorCommand(readValue<QColor>(in), parser);
+      break;
+    case SET_MAP_DEBUG_COMMAND:
+      command = new SetMapDebugCommand(readValue<qint32>(in), parser);
+      break;
+    case SET_MAP_EXTENT_COMMAND: {
+      double minx, miny, maxx, maxy;
+      in >> minx >> miny >> maxx >> maxy;
+      command = new SetMapExtentCommand(minx, miny, maxx, maxy, parser);
+      break;
+    }
+    case SET_MAP_MAX_SIZE_COMMAND:
+      command = new SetMapMaxSizeCommand(readValue<qint32>(in), parser);
+      break;
+    case SET_MAP_PROJECTION_COMMAND:
+      command = new SetMapProjectionCommand(readValue<QString>(in), parser);
+      break;
+    case SET_MAP_SIZE_COMMAND: {
+      qint32 width, height;
+      in >> width >> height;
+      command = new SetMapSizeCommand(width, height, parser);
+      break;
+    }
+    case SET_MAP_UNITS_COMMAND:
+      command = new SetMapUnitsCommand(readValue<qint32>(in), parser);
+      break;
+    case SET_METADATA_COMMAND: {
+      QString key, value;
+      in >> key >> value;
+      command = new SetMetadataCommand(key, value, parser);
+      break;
+    }
+    case SET_RESOLUTION_COMMAND:
+      command = new SetResolutionCommand(readValue<double>(in), parser);
+      break;
+    case SET_SHAPE_PATH_COMMAND:
+      command = new SetShapePathCommand(readValue<QString>(in), parser);
+      break;
+    case SET_SYMBOL_SET_COMMAND:
+      command = new SetSymbolSetCommand(readValue<QString>(in), parser);
+      break;
+    case SET_TEMPLATE_PATTERN_COMMAND:
+      command = new SetTemplatePatternCommand(readValue<QString>(in), parser);
+      break;
+
+    // layers
+    case ADD_LAYER_COMMAND: {
+      QString name;
+      bool isRaster;
+      in >> name >> isRaster;
+      command = new AddLayerCommand(name, isRaster, mainwindow);
+      break;
+    }
+    case REMOVE_LAYER_COMMAND: {
+      Layer * layer = findLayer(parser, readValue<QString>(in));
+      if (layer) {
+        command = new RemoveLayerCommand(layer, mainwindow);
+      }
+      break;
+    }
+    case CHANGE_LAYER_NAME_COMMAND: {
+      QString oldName, newName;
+      in >> oldName >> newName;
+      Layer * layer = findLayer(parser, oldName);
+      if (layer) {
+        command = new ChangeLayerNameCommand(layer, oldName, newName);
+      }
+      break;
+    }
+    case CHANGE_LAYER_STATUS_COMMAND:
+      command = createLayerCommand<ChangeLayerStatusCommand, qint32>(in, parser);
+      break;
+    case CHANGE_LAYER_REQUIRES_COMMAND:
+      command = createLayerCommand<ChangeLayerRequiresCommand, QString>(in, parser);
+      break;
+    case CHANGE_LAYER_MASK_COMMAND:
+      command = createLayerCommand<ChangeLayerMaskCommand, QString>(in, parser);
+      break;
+    case CHANGE_LAYER_OPACITY_COMMAND:
+      command = createLayerCommand<ChangeLayerOpacityCommand, qint32>(in, parser);
+      break;
+    case CHANGE_LAYER_GROUP_COMMAND:
+      command = createLayerCommand<ChangeLayerGroupCommand, QString>(in, parser);
+      break;
+    case CHANGE_LAYER_DEBUG_LEVEL_COMMAND:
+      command = createLayerCommand<ChangeLayerDebugLevelCommand, qint32>(in, parser);
+      break;
+    case CHANGE_LAYER_MIN_SCALE_DENOM_COMMAND:
+      command = createLayerCommand<ChangeLayerMinScaleDenomCommand, double>(in, parser);
+      break;
+    case CHANGE_LAYER_MAX_SCALE_DENOM_COMMAND:
+      command = createLayerCommand<ChangeLayerMaxScaleDenomCommand, double>(in, parser);
+      break;
+    case CHANGE_LAYER_TEMPLATE_COMMAND:
+      command = createLayerCommand<ChangeLayerTemplateCommand, QString>(in, parser);
+      break;
+    case CHANGE_LAYER_HEADER_COMMAND:
+      command = createLayerCommand<ChangeLayerHeaderCommand, QString>(in, parser);
+      break;
+    case CHANGE_LAYER_FOOTER_COMMAND:
+      command = createLayerCommand<ChangeLayerFooterCommand, QString>(in, parser);
+      break;
+
+    // outputformats, the commands keep their own copies
+    case ADD_OUTPUT_FORMAT_COMMAND: {
+      OutputFormat format;
+      in >> format;
+      command = new AddNewOutputFormatCommand(& format, parser);
+      break;
+    }
+    case REMOVE_OUTPUT_FORMAT_COMMAND: {
+      OutputFormat format;
+      in >> format;
+      command = new RemoveOutputFormatCommand(& format, parser);
+      break;
+    }
+    case UPDATE_OUTPUT_FORMAT_COMMAND: {
+      OutputFormat format;
+      in >> format;
+      command = new UpdateOutputFormatCommand(& format, parser);
+      break;
+    }
+    case SET_DEFAULT_OUTPUT_FORMAT_COMMAND:
+      command = new SetDefaultOutputFormatCommand(readValue<QString>(in), parser);
+      break;
+  }
+
+  // written by another version, or truncated
+  if (in.status() != QDataStream::Ok) {
+    delete command;
+    return NULL;
+  }
+  return command;
+}
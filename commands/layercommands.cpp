@@ -46,6 +46,14 @@ void AddLayerCommand::redo(void) {
   mainwindow->addLayer(layerName, isRaster);
 }
 
+int AddLayerCommand::journalId() const {
+  return ADD_LAYER_COMMAND;
+}
+
+void AddLayerCommand::writeJournal(QDataStream & out) const {
+  out << layerName << isRaster;
+}
+
 AddLayerCommand::~AddLayerCommand() {}
 
 // "Remove layer" command
@@ -54,6 +62,7 @@ RemoveLayerCommand::RemoveLayerCommand(Layer *deletedLayer, MainWindow *wnd, QUn
      : QUndoCommand(parent), mainwindow(wnd)
 {
   this->deletedLayer = new Layer(* deletedLayer);
+  this->uniqueName = (deletedLayer->getNameCount(deletedLayer->getName()) == 1);
   setText(QObject::tr("Delete layer '%1'").arg(deletedLayer->getName()));
 }
 
@@ -65,6 +74,18 @@ void RemoveLayerCommand::redo(void) {
   mainwindow->removeLayer(deletedLayer);
 }
 
+int RemoveLayerCommand::journalId() const {
+  return REMOVE_LAYER_COMMAND;
+}
+
+void RemoveLayerCommand::writeJournal(QDataStream & out) const {
+  out << deletedLayer->getName();
+}
+
+bool RemoveLayerCommand::isJournalable() const {
+  return uniqueName;
+}
+
 RemoveLayerCommand::~RemoveLayerCommand() {
   delete deletedLayer;
 }
@@ -73,6 +94,7 @@ RemoveLayerCommand::~RemoveLayerCommand() {
 ChangeLayerNameCommand::ChangeLayerNameCommand(Layer * modifiedLayer, QString & oldLayerName, QString & newLayerName, QUndoCommand * parent)
   : QUndoCommand(parent), oldLayerName(oldLayerName), newLayerName(newLayerName), modifiedLayer(modifiedLayer)
 {
+  this->uniqueName = (modifiedLayer->getNameCount(oldLayerName) == 1) && (modifiedLayer->getNameCount(newLayerName) == 0);
   setText(QObject::tr("Rename layer '%1' to '%2'").arg(newLayerName, oldLayerName));
 }
 
@@ -84,6 +106,18 @@ void ChangeLayerNameCommand::redo(void) {
   modifiedLayer->setName(newLayerName);
 }
 
+int ChangeLayerNameCommand::journalId() const {
+  return CHANGE_LAYER_NAME_COMMAND;
+}
+
+void ChangeLayerNameCommand::writeJournal(QDataStream & out) const {
+  out << oldLayerName << newLayerName;
+}
+
+bool ChangeLayerNameCommand::isJournalable() const {
+  return uniqueName;
+}
+
 ChangeLayerNameCommand::~ChangeLayerNameCommand() {}
 
 // "Change layer status" command
@@ -114,6 +148,18 @@ void ChangeLayerStatusCommand::redo(void) {
   modifiedLayer->setStatus(newStatus);
 }
 
+int ChangeLayerStatusCommand::journalId() const {
+  return CHANGE_LAYER_STATUS_COMMAND;
+}
+
+void ChangeLayerStatusCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << qint32(oldStatus) << qint32(newStatus);
+}
+
+bool ChangeLayerStatusCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerStatusCommand::~ChangeLayerStatusCommand() {}
 
 // "Change requires" command
@@ -130,6 +176,18 @@ void ChangeLayerRequiresCommand::redo() {
   modifiedLayer->setRequires(newLayer);
 }
 
+int ChangeLayerRequiresCommand::journalId() const {
+  return CHANGE_LAYER_REQUIRES_COMMAND;
+}
+
+void ChangeLayerRequiresCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << oldLayer << newLayer;
+}
+
+bool ChangeLayerRequiresCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerRequiresCommand::~ChangeLayerRequiresCommand() {}
 
 // "Change mask" command
@@ -146,6 +204,18 @@ void ChangeLayerMaskCommand::redo() {
   modifiedLayer->setMask(newLayer);
 }
 
+int ChangeLayerMaskCommand::journalId() const {
+  return CHANGE_LAYER_MASK_COMMAND;
+}
+
+void ChangeLayerMaskCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << oldLayer << newLayer;
+}
+
+bool ChangeLayerMaskCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerMaskCommand::~ChangeLayerMaskCommand() {}
 
 // "Change mask" command
@@ -162,8 +232,33 @@ void ChangeLayerOpacityCommand::redo() {
   modifiedLayer->setOpacity(newOpacity);
 }
 
+int ChangeLayerOpacityCommand::journalId() const {
+  return CHANGE_LAYER_OPACITY_COMMAND;
+}
+
+void ChangeLayerOpacityCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << qint32(oldOpacity) << qint32(newOpacity);
+}
+
+bool ChangeLayerOpacityCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerOpacityCommand::~ChangeLayerOpacityCommand() {}
 
+int ChangeLayerOpacityCommand::id() const {
+  return CHANGE_LAYER_OPACITY_COMMAND;
+}
+
+bool ChangeLayerOpacityCommand::mergeWith(QUndoCommand const * command) {
+  ChangeLayerOpacityCommand const * other = static_cast<ChangeLayerOpacityCommand const *>(command);
+  if ((other->modifiedLayer != this->modifiedLayer) || (! this->edit.continuesWith(other->edit)))
+    return false;
+  this->newOpacity = other->newOpacity;
+  setText(QObject::tr("Change layer opacity from '%1' to '%2'").arg(oldOpacity).arg(newOpacity));
+  return true;
+}
+
 // "Change group" command
 ChangeLayerGroupCommand::ChangeLayerGroupCommand(Layer * modifiedLayer, QString oldGroup, QString newGroup, QUndoCommand *parent)
   : QUndoCommand(parent), oldGroup(oldGroup), newGroup(newGroup), modifiedLayer(modifiedLayer)  {
@@ -178,6 +273,18 @@ void ChangeLayerGroupCommand::redo() {
   modifiedLayer->setGroup(newGroup);
 }
 
+int ChangeLayerGroupCommand::journalId() const {
+  return CHANGE_LAYER_GROUP_COMMAND;
+}
+
+void ChangeLayerGroupCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << oldGroup << newGroup;
+}
+
+bool ChangeLayerGroupCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerGroupCommand::~ChangeLayerGroupCommand() {}
 
 // "Change debug" command
@@ -194,6 +301,18 @@ void ChangeLayerDebugLevelCommand::redo() {
   modifiedLayer->setDebugLevel(newDebug);
 }
 
+int ChangeLayerDebugLevelCommand::journalId() const {
+  return CHANGE_LAYER_DEBUG_LEVEL_COMMAND;
+}
+
+void ChangeLayerDebugLevelCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << qint32(oldDebug) << qint32(newDebug);
+}
+
+bool ChangeLayerDebugLevelCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerDebugLevelCommand::~ChangeLayerDebugLevelCommand() {}
 
 
@@ -211,8 +330,33 @@ void ChangeLayerMinScaleDenomCommand::redo() {
   modifiedLayer->setMinScaleDenom(newmin);
 }
 
+int ChangeLayerMinScaleDenomCommand::journalId() const {
+  return CHANGE_LAYER_MIN_SCALE_DENOM_COMMAND;
+}
+
+void ChangeLayerMinScaleDenomCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << oldmin << newmin;
+}
+
+bool ChangeLayerMinScaleDenomCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerMinScaleDenomCommand::~ChangeLayerMinScaleDenomCommand() {}
 
+int ChangeLayerMinScaleDenomCommand::id() const {
+  return CHANGE_LAYER_MIN_SCALE_DENOM_COMMAND;
+}
+
+bool ChangeLayerMinScaleDenomCommand::mergeWith(QUndoCommand const * command) {
+  ChangeLayerMinScaleDenomCommand const * other = static_cast<ChangeLayerMinScaleDenomCommand const *>(command);
+  if ((other->modifiedLayer != this->modifiedLayer) || (! this->edit.continuesWith(other->edit)))
+    return false;
+  this->newmin = other->newmin;
+  setText(QObject::tr("Change layer min scale denominator from '%1' to '%2'").arg(oldmin).arg(newmin));
+  return true;
+}
+
 // "Change maxscaledenom" command
 ChangeLayerMaxScaleDenomCommand::ChangeLayerMaxScaleDenomCommand(Layer * modifiedLayer, double oldmax, double newmax, QUndoCommand *parent)
   : QUndoCommand(parent), oldmax(oldmax), newmax(newmax), modifiedLayer(modifiedLayer)  {
@@ -227,8 +371,33 @@ void ChangeLayerMaxScaleDenomCommand::redo() {
   modifiedLayer->setMaxScaleDenom(newmax);
 }
 
+int ChangeLayerMaxScaleDenomCommand::journalId() const {
+  return CHANGE_LAYER_MAX_SCALE_DENOM_COMMAND;
+}
+
+void ChangeLayerMaxScaleDenomCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << oldmax << newmax;
+}
+
+bool ChangeLayerMaxScaleDenomCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerMaxScaleDenomCommand::~ChangeLayerMaxScaleDenomCommand() {}
 
+int ChangeLayerMaxScaleDenomCommand::id() const {
+  return CHANGE_LAYER_MAX_SCALE_DENOM_COMMAND;
+}
+
+bool ChangeLayerMaxScaleDenomCommand::mergeWith(QUndoCommand const * command) {
+  ChangeLayerMaxScaleDenomCommand const * other = static_cast<ChangeLayerMaxScaleDenomCommand const *>(command);
+  if ((other->modifiedLayer != this->modifiedLayer) || (! this->edit.continuesWith(other->edit)))
+    return false;
+  this->newmax = other->newmax;
+  setText(QObject::tr("Change layer max scale denominator from '%1' to '%2'").arg(oldmax).arg(newmax));
+  return true;
+}
+
 // "Change template" command
 ChangeLayerTemplateCommand::ChangeLayerTemplateCommand(Layer * modifiedLayer, QString oldTemplate, QString newTemplate, QUndoCommand *parent)
   : QUndoCommand(parent), oldTemplate(oldTemplate), newTemplate(newTemplate), modifiedLayer(modifiedLayer)  {
@@ -243,6 +412,18 @@ void ChangeLayerTemplateCommand::redo() {
   modifiedLayer->setTemplate(newTemplate);
 }
 
+int ChangeLayerTemplateCommand::journalId() const {
+  return CHANGE_LAYER_TEMPLATE_COMMAND;
+}
+
+void ChangeLayerTemplateCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << oldTemplate << newTemplate;
+}
+
+bool ChangeLayerTemplateCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerTemplateCommand::~ChangeLayerTemplateCommand() {}
 
 // "Change header" command
@@ -259,6 +440,18 @@ void ChangeLayerHeaderCommand::redo() {
   modifiedLayer->setHeader(newHeader);
 }
 
+int ChangeLayerHeaderCommand::journalId() const {
+  return CHANGE_LAYER_HEADER_COMMAND;
+}
+
+void ChangeLayerHeaderCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << oldHeader << newHeader;
+}
+
+bool ChangeLayerHeaderCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerHeaderCommand::~ChangeLayerHeaderCommand() {}
 
 // "Change footer" command
@@ -275,6 +468,18 @@ void ChangeLayerFooterCommand::redo() {
   modifiedLayer->setFooter(newFooter);
 }
 
+int ChangeLayerFooterCommand::journalId() const {
+  return CHANGE_LAYER_FOOTER_COMMAND;
+}
+
+void ChangeLayerFooterCommand::writeJournal(QDataStream & out) const {
+  out << modifiedLayer->getName() << oldFooter << newFooter;
+}
+
+bool ChangeLayerFooterCommand::isJournalable() const {
+  return modifiedLayer->getNameCount(modifiedLayer->getName()) == 1;
+}
+
 ChangeLayerFooterCommand::~ChangeLayerFooterCommand() {}
 
 
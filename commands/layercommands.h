@@ -32,14 +32,19 @@
 #include <QUndoCommand>
 
 #include "../mainwindow.h"
+#include "commandids.h"
+#include "commandjournal.h"
+#include "continuousedit.h"
 
-class AddLayerCommand : public QUndoCommand {
+class AddLayerCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    AddLayerCommand(QString &layerName, bool isRaster, MainWindow * wnd, QUndoCommand *parent = 0);
    ~AddLayerCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString layerName;
@@ -47,169 +52,221 @@ class AddLayerCommand : public QUndoCommand {
    MainWindow * mainwindow;
 };
 
-class RemoveLayerCommand : public QUndoCommand {
+class RemoveLayerCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    RemoveLayerCommand(Layer * deletedLayer, MainWindow *wnd, QUndoCommand *parent = 0);
    ~RemoveLayerCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    Layer * deletedLayer;
    MainWindow * mainwindow;
+   // the layer is the only one with its name
+   bool uniqueName;
 };
 
-class ChangeLayerNameCommand : public QUndoCommand {
+class ChangeLayerNameCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerNameCommand(Layer *l, QString &oldLayerName, QString &newLayerName, QUndoCommand *parent = 0);
    ~ChangeLayerNameCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    QString oldLayerName, newLayerName;
    Layer *modifiedLayer;
+   // the layer is the only one with its old name, and the new one is free
+   bool uniqueName;
 };
 
-class ChangeLayerStatusCommand : public QUndoCommand {
+class ChangeLayerStatusCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerStatusCommand(Layer *l, int oldStatus, int newStatus, QUndoCommand *parent = 0);
    ~ChangeLayerStatusCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    int oldStatus, newStatus;
    Layer *modifiedLayer;
 };
 
-class ChangeLayerRequiresCommand : public QUndoCommand {
+class ChangeLayerRequiresCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerRequiresCommand(Layer *, QString, QString, QUndoCommand * parent = 0);
    ~ChangeLayerRequiresCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    QString oldLayer, newLayer;
    Layer *modifiedLayer;
 };
 
-class ChangeLayerMaskCommand : public QUndoCommand {
+class ChangeLayerMaskCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerMaskCommand(Layer *, QString, QString, QUndoCommand * parent = 0);
    ~ChangeLayerMaskCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    QString oldLayer, newLayer;
    Layer *modifiedLayer;
 };
 
-class ChangeLayerOpacityCommand : public QUndoCommand {
+class ChangeLayerOpacityCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerOpacityCommand(Layer *, int, int, QUndoCommand * parent = 0);
    ~ChangeLayerOpacityCommand();
    void undo();
    void redo();
+   int id() const;
+   bool mergeWith(QUndoCommand const *);
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    int oldOpacity, newOpacity;
    Layer *modifiedLayer;
+   ContinuousEdit edit;
 };
 
-class ChangeLayerGroupCommand : public QUndoCommand {
+class ChangeLayerGroupCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerGroupCommand(Layer *, QString, QString, QUndoCommand * parent = 0);
    ~ChangeLayerGroupCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    QString oldGroup, newGroup;
    Layer *modifiedLayer;
 };
 
-class ChangeLayerDebugLevelCommand : public QUndoCommand {
+class ChangeLayerDebugLevelCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerDebugLevelCommand(Layer *, int, int, QUndoCommand * parent = 0);
    ~ChangeLayerDebugLevelCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    int oldDebug, newDebug;
    Layer *modifiedLayer;
 };
 
-class ChangeLayerMinScaleDenomCommand : public QUndoCommand {
+class ChangeLayerMinScaleDenomCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerMinScaleDenomCommand(Layer *, double, double, QUndoCommand * parent = 0);
    ~ChangeLayerMinScaleDenomCommand();
    void undo();
    void redo();
+   int id() const;
+   bool mergeWith(QUndoCommand const *);
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    double oldmin, newmin;
    Layer *modifiedLayer;
+   ContinuousEdit edit;
 };
 
-class ChangeLayerMaxScaleDenomCommand : public QUndoCommand {
+class ChangeLayerMaxScaleDenomCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerMaxScaleDenomCommand(Layer *, double, double, QUndoCommand * parent = 0);
    ~ChangeLayerMaxScaleDenomCommand();
    void undo();
    void redo();
+   int id() const;
+   bool mergeWith(QUndoCommand const *);
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    double oldmax, newmax;
    Layer *modifiedLayer;
+   ContinuousEdit edit;
 };
 
-class ChangeLayerTemplateCommand : public QUndoCommand {
+class ChangeLayerTemplateCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerTemplateCommand(Layer *, QString, QString, QUndoCommand * parent = 0);
    ~ChangeLayerTemplateCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    QString oldTemplate, newTemplate;
    Layer *modifiedLayer;
 };
 
-class ChangeLayerHeaderCommand : public QUndoCommand {
+class ChangeLayerHeaderCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerHeaderCommand(Layer *, QString, QString, QUndoCommand * parent = 0);
    ~ChangeLayerHeaderCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    QString oldHeader, newHeader;
    Layer *modifiedLayer;
 };
 
-class ChangeLayerFooterCommand : public QUndoCommand {
+class ChangeLayerFooterCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    ChangeLayerFooterCommand(Layer *, QString, QString, QUndoCommand * parent = 0);
    ~ChangeLayerFooterCommand();
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
+   bool isJournalable() const;
 
  private:
    QString oldFooter, newFooter;
@@ -28,72 +28,165 @@
 
 #include "outputformatcommands.h"
 
+/** copies of the outputformats kept by the commands */
+
+OutputFormatCopy::OutputFormatCopy(OutputFormat const * of) : format(of ? new OutputFormat(* of) : NULL) {}
+
+OutputFormat * OutputFormatCopy::get() {
+  if ((! this->format) && (! this->compressed.isEmpty())) {
+    QByteArray data = qUncompress(this->compressed);
+    QDataStream in(& data, QIODevice::ReadOnly);
+    this->format = new OutputFormat();
+    in >> * this->format;
+    this->compressed.clear();
+  }
+  return this->format;
+}
+
+void OutputFormatCopy::reset(OutputFormat * of) {
+  delete this->format;
+  this->format = of;
+  this->compressed.clear();
+}
+
+qint64 OutputFormatCopy::getMemoryUsage() const {
+  return this->format ? this->format->getMemoryUsage() : this->compressed.capacity();
+}
+
+void OutputFormatCopy::compact() {
+  if (! this->format)
+    return;
+  QByteArray data;
+  QDataStream out(& data, QIODevice::WriteOnly);
+  out << * this->format;
+  this->compressed = qCompress(data);
+  delete this->format;
+  this->format = NULL;
+}
+
+// a compacted copy is left as is
+void OutputFormatCopy::write(QDataStream & out) const {
+  if (this->format) {
+    out << * this->format;
+    return;
+  }
+  OutputFormat uncompressed;
+  QByteArray data = qUncompress(this->compressed);
+  QDataStream in(& data, QIODevice::ReadOnly);
+  in >> uncompressed;
+  out << uncompressed;
+}
+
+OutputFormatCopy::~OutputFormatCopy() {
+  delete this->format;
+}
+
 /** related to adding a new Output Format */
 
 AddNewOutputFormatCommand::AddNewOutputFormatCommand(OutputFormat *newFormat, MapfileParser *parser, QUndoCommand *parent)
-     : QUndoCommand(parent), parser(parser)
+     : QUndoCommand(parent), newFormat(newFormat), parser(parser)
 {
-  this->newFormat = new OutputFormat(* newFormat);
   setText(QObject::tr("Create new outputformat '%1'").arg(newFormat->getName()));
 }
 
 void AddNewOutputFormatCommand::undo(void) {
-  parser->removeOutputFormat(newFormat);
+  parser->removeOutputFormat(newFormat.get());
 }
 
 void AddNewOutputFormatCommand::redo(void) {
-  parser->addOutputFormat(newFormat);
+  parser->addOutputFormat(newFormat.get());
+}
+
+qint64 AddNewOutputFormatCommand::getMemoryUsage() const {
+  return sizeof(AddNewOutputFormatCommand) + newFormat.getMemoryUsage();
+}
+
+void AddNewOutputFormatCommand::compact() {
+  newFormat.compact();
+}
+
+int AddNewOutputFormatCommand::journalId() const {
+  return ADD_OUTPUT_FORMAT_COMMAND;
 }
 
-AddNewOutputFormatCommand::~AddNewOutputFormatCommand() {
-  delete newFormat;
+void AddNewOutputFormatCommand::writeJournal(QDataStream & out) const {
+  newFormat.write(out);
 }
 
+AddNewOutputFormatCommand::~AddNewOutputFormatCommand() {}
+
 /** related to removing an Output Format */
 
 RemoveOutputFormatCommand::RemoveOutputFormatCommand(OutputFormat *fmtToRemove, MapfileParser *parser, QUndoCommand *parent)
-     : QUndoCommand(parent), parser(parser)
+     : QUndoCommand(parent), fmtToRemove(fmtToRemove), parser(parser)
 {
-  this->fmtToRemove = new OutputFormat(* fmtToRemove);
   setText(QObject::tr("Remove outputformat '%1'").arg(fmtToRemove->getName()));
 }
 
 void RemoveOutputFormatCommand::undo(void) {
-  parser->addOutputFormat(fmtToRemove);
+  parser->addOutputFormat(fmtToRemove.get());
 }
 
 void RemoveOutputFormatCommand::redo(void) {
-  parser->removeOutputFormat(fmtToRemove);
+  parser->removeOutputFormat(fmtToRemove.get());
+}
+
+qint64 RemoveOutputFormatCommand::getMemoryUsage() const {
+  return sizeof(RemoveOutputFormatCommand) + fmtToRemove.getMemoryUsage();
+}
+
+void RemoveOutputFormatCommand::compact() {
+  fmtToRemove.compact();
 }
 
-RemoveOutputFormatCommand::~RemoveOutputFormatCommand() {
-  delete fmtToRemove;
+int RemoveOutputFormatCommand::journalId() const {
+  return REMOVE_OUTPUT_FORMAT_COMMAND;
 }
 
+void RemoveOutputFormatCommand::writeJournal(QDataStream & out) const {
+  fmtToRemove.write(out);
+}
+
+RemoveOutputFormatCommand::~RemoveOutputFormatCommand() {}
+
 /** related to modifying an existing Output Format */
 
 UpdateOutputFormatCommand::UpdateOutputFormatCommand(OutputFormat *fmtToUpdate, MapfileParser *parser, QUndoCommand *parent)
-     : QUndoCommand(parent), fmtToUpdate(new OutputFormat(* fmtToUpdate)), parser(parser)
+     : QUndoCommand(parent), fmtToUpdate(fmtToUpdate), parser(parser)
 {
-  originalFmt = parser->getOutputFormat(fmtToUpdate->getOriginalName());
+  originalFmt.reset(parser->getOutputFormat(fmtToUpdate->getOriginalName()));
   setText(QObject::tr("Update outputformat '%1'").arg(fmtToUpdate->getName()));
 }
 
 void UpdateOutputFormatCommand::undo(void) {
   // Note: What if a command adds a fmt which has the same name ?
-  parser->updateOutputFormat(originalFmt);
+  parser->updateOutputFormat(originalFmt.get());
 }
 
 void UpdateOutputFormatCommand::redo(void) {
-  parser->updateOutputFormat(fmtToUpdate);
+  parser->updateOutputFormat(fmtToUpdate.get());
+}
+
+qint64 UpdateOutputFormatCommand::getMemoryUsage() const {
+  return sizeof(UpdateOutputFormatCommand) + fmtToUpdate.getMemoryUsage() + originalFmt.getMemoryUsage();
+}
+
+void UpdateOutputFormatCommand::compact() {
+  fmtToUpdate.compact();
+  originalFmt.compact();
+}
+
+// both objects are managed by the QUndo command
+int UpdateOutputFormatCommand::journalId() const {
+  return UPDATE_OUTPUT_FORMAT_COMMAND;
 }
 
-UpdateOutputFormatCommand::~UpdateOutputFormatCommand() {
-  // both objects are managed by the QUndo command
-  delete fmtToUpdate;
-  delete originalFmt;
+void UpdateOutputFormatCommand::writeJournal(QDataStream & out) const {
+  fmtToUpdate.write(out);
 }
 
+UpdateOutputFormatCommand::~UpdateOutputFormatCommand() {}
+
 
 /**  related to setting the default outputformat */
 
@@ -112,3 +205,10 @@ void SetDefaultOutputFormatCommand::redo(void) {
   parser->setDefaultOutputFormat(newDefaultOf);
 }
 
+int SetDefaultOutputFormatCommand::journalId() const {
+  return SET_DEFAULT_OUTPUT_FORMAT_COMMAND;
+}
+
+void SetDefaultOutputFormatCommand::writeJournal(QDataStream & out) const {
+  out << newDefaultOf;
+}
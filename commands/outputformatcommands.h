@@ -32,52 +32,94 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
+#include "undobudget.h"
 
-class AddNewOutputFormatCommand : public QUndoCommand {
+/**
+ * Copy of an outputformat kept by a command. It can be compacted into a
+ * compressed serialized form, restored on the next access.
+ */
+class OutputFormatCopy {
+
+ public:
+   OutputFormatCopy(OutputFormat const * = NULL);
+   ~OutputFormatCopy();
+
+   OutputFormat * get();
+   // takes ownership of the given outputformat
+   void reset(OutputFormat *);
+   qint64 getMemoryUsage() const;
+   void compact();
+   // writes the outputformat, as by its QDataStream operator
+   void write(QDataStream &) const;
+
+ private:
+   Q_DISABLE_COPY(OutputFormatCopy)
+
+   OutputFormat * format;
+   QByteArray compressed;
+};
+
+class AddNewOutputFormatCommand : public QUndoCommand, public SizedCommand, public JournaledCommand {
 
  public:
    AddNewOutputFormatCommand(OutputFormat * newOf, MapfileParser * parser, QUndoCommand *parent = 0);
    ~AddNewOutputFormatCommand();
    void undo();
    void redo();
+   qint64 getMemoryUsage() const;
+   void compact();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
-   OutputFormat * newFormat;
+   OutputFormatCopy newFormat;
    MapfileParser * parser;
 };
 
-class RemoveOutputFormatCommand : public QUndoCommand {
+class RemoveOutputFormatCommand : public QUndoCommand, public SizedCommand, public JournaledCommand {
 
  public:
    RemoveOutputFormatCommand(OutputFormat * fmtToRemove, MapfileParser * parser, QUndoCommand *parent = 0);
    ~RemoveOutputFormatCommand();
    void undo();
    void redo();
+   qint64 getMemoryUsage() const;
+   void compact();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
-   OutputFormat * fmtToRemove;
+   OutputFormatCopy fmtToRemove;
    MapfileParser * parser;
 };
 
-class UpdateOutputFormatCommand : public QUndoCommand {
+class UpdateOutputFormatCommand : public QUndoCommand, public SizedCommand, public JournaledCommand {
 
  public:
    UpdateOutputFormatCommand(OutputFormat * fmtToUpdate, MapfileParser * parser, QUndoCommand *parent = 0);
    ~UpdateOutputFormatCommand();
    void undo();
    void redo();
+   qint64 getMemoryUsage() const;
+   void compact();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
-   OutputFormat * fmtToUpdate, * originalFmt;
+   OutputFormatCopy fmtToUpdate, originalFmt;
    MapfileParser * parser;
 };
 
-class SetDefaultOutputFormatCommand : public QUndoCommand {
+class SetDefaultOutputFormatCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetDefaultOutputFormatCommand(QString const & newDefaultOf, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString oldDefaultOf, newDefaultOf;
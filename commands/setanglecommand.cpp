@@ -44,3 +44,23 @@ void SetAngleCommand::redo(void) {
   parser->setAngle(newAngle);
 }
 
+int SetAngleCommand::id() const {
+  return SET_ANGLE_COMMAND;
+}
+
+bool SetAngleCommand::mergeWith(QUndoCommand const * command) {
+  SetAngleCommand const * other = static_cast<SetAngleCommand const *>(command);
+  if ((other->parser != this->parser) || (! this->edit.continuesWith(other->edit)))
+    return false;
+  this->newAngle = other->newAngle;
+  setText(QObject::tr("change map angle to '%1'").arg(newAngle));
+  return true;
+}
+
+int SetAngleCommand::journalId() const {
+  return SET_ANGLE_COMMAND;
+}
+
+void SetAngleCommand::writeJournal(QDataStream & out) const {
+  out << newAngle;
+}
@@ -32,17 +32,25 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
+#include "continuousedit.h"
 
-class SetAngleCommand : public QUndoCommand {
+class SetAngleCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetAngleCommand(float newAngle, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int id() const;
+   bool mergeWith(QUndoCommand const *);
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    float newAngle, oldAngle;
    MapfileParser * parser;
+   ContinuousEdit edit;
 };
 
 
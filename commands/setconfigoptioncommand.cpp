@@ -44,3 +44,10 @@ void SetConfigOptionCommand::redo(void) {
   parser->setConfigOption(this->key, this->newValue);
 }
 
+int SetConfigOptionCommand::journalId() const {
+  return SET_CONFIG_OPTION_COMMAND;
+}
+
+void SetConfigOptionCommand::writeJournal(QDataStream & out) const {
+  out << key << newValue;
+}
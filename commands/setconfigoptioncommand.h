@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetConfigOptionCommand : public QUndoCommand {
+class SetConfigOptionCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetConfigOptionCommand(QString key, QString newValue, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString key;
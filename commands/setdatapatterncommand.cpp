@@ -44,3 +44,10 @@ void SetDataPatternCommand::redo(void) {
   parser->setDataPattern(newDataPattern);
 }
 
+int SetDataPatternCommand::journalId() const {
+  return SET_DATA_PATTERN_COMMAND;
+}
+
+void SetDataPatternCommand::writeJournal(QDataStream & out) const {
+  out << newDataPattern;
+}
@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetDataPatternCommand : public QUndoCommand {
+class SetDataPatternCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetDataPatternCommand(QString dataPattern, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString oldDataPattern, newDataPattern;
@@ -44,3 +44,23 @@ void SetDefResolutionCommand::redo(void) {
   parser->setDefResolution(newDefResolution);
 }
 
+int SetDefResolutionCommand::id() const {
+  return SET_DEF_RESOLUTION_COMMAND;
+}
+
+bool SetDefResolutionCommand::mergeWith(QUndoCommand const * command) {
+  SetDefResolutionCommand const * other = static_cast<SetDefResolutionCommand const *>(command);
+  if ((other->parser != this->parser) || (! this->edit.continuesWith(other->edit)))
+    return false;
+  this->newDefResolution = other->newDefResolution;
+  setText(QObject::tr("change def resolution to '%1'").arg(newDefResolution));
+  return true;
+}
+
+int SetDefResolutionCommand::journalId() const {
+  return SET_DEF_RESOLUTION_COMMAND;
+}
+
+void SetDefResolutionCommand::writeJournal(QDataStream & out) const {
+  out << newDefResolution;
+}
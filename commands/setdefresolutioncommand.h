@@ -32,17 +32,25 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
+#include "continuousedit.h"
 
-class SetDefResolutionCommand : public QUndoCommand {
+class SetDefResolutionCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetDefResolutionCommand(double newDefResolution, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int id() const;
+   bool mergeWith(QUndoCommand const *);
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    double newDefResolution, oldDefResolution;
    MapfileParser * parser;
+   ContinuousEdit edit;
 };
 
 
@@ -44,3 +44,10 @@ void SetFontSetCommand::redo(void) {
   parser->setFontSet(this->newFontSet);
 }
 
+int SetFontSetCommand::journalId() const {
+  return SET_FONT_SET_COMMAND;
+}
+
+void SetFontSetCommand::writeJournal(QDataStream & out) const {
+  out << newFontSet;
+}
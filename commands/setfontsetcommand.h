@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetFontSetCommand : public QUndoCommand {
+class SetFontSetCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetFontSetCommand(QString newFontSet, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString oldFontSet;
@@ -49,4 +49,23 @@ void SetImageColorCommand::redo(void) {
      parser->setImageColor(QColor(0xff, 0xff, 0xff));
 }
 
+int SetImageColorCommand::id() const {
+  return SET_IMAGE_COLOR_COMMAND;
+}
+
+bool SetImageColorCommand::mergeWith(QUndoCommand const * command) {
+  SetImageColorCommand const * other = static_cast<SetImageColorCommand const *>(command);
+  if ((other->parser != this->parser) || (! this->edit.continuesWith(other->edit)))
+    return false;
+  this->newColor = other->newColor;
+  setText(QObject::tr("change image color to %1").arg(newColor.name()));
+  return true;
+}
 
+int SetImageColorCommand::journalId() const {
+  return SET_IMAGE_COLOR_COMMAND;
+}
+
+void SetImageColorCommand::writeJournal(QDataStream & out) const {
+  out << newColor;
+}
@@ -33,17 +33,25 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
+#include "continuousedit.h"
 
-class SetImageColorCommand : public QUndoCommand {
+class SetImageColorCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetImageColorCommand(QColor color, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int id() const;
+   bool mergeWith(QUndoCommand const *);
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QColor oldColor, newColor;
    MapfileParser * parser;
+   ContinuousEdit edit;
 };
 
 
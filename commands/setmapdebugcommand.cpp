@@ -44,3 +44,10 @@ void SetMapDebugCommand::redo(void) {
   parser->setDebug(newDebug);
 }
 
+int SetMapDebugCommand::journalId() const {
+  return SET_MAP_DEBUG_COMMAND;
+}
+
+void SetMapDebugCommand::writeJournal(QDataStream & out) const {
+  out << qint32(newDebug);
+}
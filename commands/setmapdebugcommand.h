@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetMapDebugCommand : public QUndoCommand {
+class SetMapDebugCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetMapDebugCommand(int newDebug, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    int newDebug, oldDebug;
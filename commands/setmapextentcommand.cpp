@@ -49,3 +49,26 @@ void SetMapExtentCommand::redo(void) {
    parser->setMapExtent(newmx,newmy,newMx,newMy);
 }
 
+int SetMapExtentCommand::id() const {
+  return SET_MAP_EXTENT_COMMAND;
+}
+
+bool SetMapExtentCommand::mergeWith(QUndoCommand const * command) {
+  SetMapExtentCommand const * other = static_cast<SetMapExtentCommand const *>(command);
+  if ((other->parser != this->parser) || (! this->edit.continuesWith(other->edit)))
+    return false;
+  this->newmx = other->newmx;
+  this->newmy = other->newmy;
+  this->newMx = other->newMx;
+  this->newMy = other->newMy;
+  setText(QObject::tr("change map extent to '%1:%2:%3:%4'").arg(newmx).arg(newmy).arg(newMx).arg(newMy));
+  return true;
+}
+
+int SetMapExtentCommand::journalId() const {
+  return SET_MAP_EXTENT_COMMAND;
+}
+
+void SetMapExtentCommand::writeJournal(QDataStream & out) const {
+  out << newmx << newmy << newMx << newMy;
+}
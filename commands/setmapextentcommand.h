@@ -32,17 +32,25 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
+#include "continuousedit.h"
 
-class SetMapExtentCommand : public QUndoCommand {
+class SetMapExtentCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetMapExtentCommand(double mx, double my, double Mx, double My, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int id() const;
+   bool mergeWith(QUndoCommand const *);
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    double newmx, newmy, newMx, newMy, oldmx, oldmy, oldMx, oldMy;
    MapfileParser * parser;
+   ContinuousEdit edit;
 };
 
 
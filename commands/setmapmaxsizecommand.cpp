@@ -44,3 +44,10 @@ void SetMapMaxSizeCommand::redo(void) {
   parser->setMapMaxsize(newMaxSize);
 }
 
+int SetMapMaxSizeCommand::journalId() const {
+  return SET_MAP_MAX_SIZE_COMMAND;
+}
+
+void SetMapMaxSizeCommand::writeJournal(QDataStream & out) const {
+  out << qint32(newMaxSize);
+}
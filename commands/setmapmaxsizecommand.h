@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetMapMaxSizeCommand : public QUndoCommand {
+class SetMapMaxSizeCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetMapMaxSizeCommand(int newMaxSize, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    int newMaxSize, oldMaxSize;
@@ -44,3 +44,10 @@ void SetMapProjectionCommand::redo(void) {
   parser->setMapProjection(this->newProjection);
 }
 
+int SetMapProjectionCommand::journalId() const {
+  return SET_MAP_PROJECTION_COMMAND;
+}
+
+void SetMapProjectionCommand::writeJournal(QDataStream & out) const {
+  out << newProjection;
+}
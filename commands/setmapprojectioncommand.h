@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetMapProjectionCommand : public QUndoCommand {
+class SetMapProjectionCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetMapProjectionCommand(QString projection, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString oldProjection;
@@ -45,3 +45,24 @@ void SetMapSizeCommand::redo(void) {
   parser->setMapSize(newWidth, newHeight);
 }
 
+int SetMapSizeCommand::id() const {
+  return SET_MAP_SIZE_COMMAND;
+}
+
+bool SetMapSizeCommand::mergeWith(QUndoCommand const * command) {
+  SetMapSizeCommand const * other = static_cast<SetMapSizeCommand const *>(command);
+  if ((other->parser != this->parser) || (! this->edit.continuesWith(other->edit)))
+    return false;
+  this->newWidth = other->newWidth;
+  this->newHeight = other->newHeight;
+  setText(QObject::tr("change map size to '%1:%2'").arg(newWidth).arg(newHeight));
+  return true;
+}
+
+int SetMapSizeCommand::journalId() const {
+  return SET_MAP_SIZE_COMMAND;
+}
+
+void SetMapSizeCommand::writeJournal(QDataStream & out) const {
+  out << qint32(newWidth) << qint32(newHeight);
+}
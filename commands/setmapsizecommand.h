@@ -32,17 +32,25 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
+#include "continuousedit.h"
 
-class SetMapSizeCommand : public QUndoCommand {
+class SetMapSizeCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetMapSizeCommand(int newWidth, int newHeight, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int id() const;
+   bool mergeWith(QUndoCommand const *);
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    int newWidth, newHeight, oldWidth, oldHeight;
    MapfileParser * parser;
+   ContinuousEdit edit;
 };
 
 
@@ -45,3 +45,10 @@ void SetMapUnitsCommand::redo(void) {
   parser->setMapUnits(newUnits);
 }
 
+int SetMapUnitsCommand::journalId() const {
+  return SET_MAP_UNITS_COMMAND;
+}
+
+void SetMapUnitsCommand::writeJournal(QDataStream & out) const {
+  out << qint32(newUnits);
+}
@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetMapUnitsCommand : public QUndoCommand {
+class SetMapUnitsCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetMapUnitsCommand(int newUnits, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    int newUnits, oldUnits;
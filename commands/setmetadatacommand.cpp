@@ -44,3 +44,10 @@ void SetMetadataCommand::redo(void) {
   parser->setMetadata(this->key, this->newValue);
 }
 
+int SetMetadataCommand::journalId() const {
+  return SET_METADATA_COMMAND;
+}
+
+void SetMetadataCommand::writeJournal(QDataStream & out) const {
+  out << key << newValue;
+}
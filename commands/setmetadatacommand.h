@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetMetadataCommand : public QUndoCommand {
+class SetMetadataCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetMetadataCommand(QString key, QString newValue, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString key;
@@ -44,3 +44,23 @@ void SetResolutionCommand::redo(void) {
   parser->setResolution(newMapResolution);
 }
 
+int SetResolutionCommand::id() const {
+  return SET_RESOLUTION_COMMAND;
+}
+
+bool SetResolutionCommand::mergeWith(QUndoCommand const * command) {
+  SetResolutionCommand const * other = static_cast<SetResolutionCommand const *>(command);
+  if ((other->parser != this->parser) || (! this->edit.continuesWith(other->edit)))
+    return false;
+  this->newMapResolution = other->newMapResolution;
+  setText(QObject::tr("change map resolution to '%1'").arg(newMapResolution));
+  return true;
+}
+
+int SetResolutionCommand::journalId() const {
+  return SET_RESOLUTION_COMMAND;
+}
+
+void SetResolutionCommand::writeJournal(QDataStream & out) const {
+  out << newMapResolution;
+}
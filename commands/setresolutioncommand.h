@@ -32,17 +32,25 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
+#include "continuousedit.h"
 
-class SetResolutionCommand : public QUndoCommand {
+class SetResolutionCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetResolutionCommand(double newMapResolution, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int id() const;
+   bool mergeWith(QUndoCommand const *);
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    double newMapResolution, oldMapResolution;
    MapfileParser * parser;
+   ContinuousEdit edit;
 };
 
 
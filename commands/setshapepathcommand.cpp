@@ -44,3 +44,10 @@ void SetShapePathCommand::redo(void) {
   parser->setShapepath(this->newShapePath);
 }
 
+int SetShapePathCommand::journalId() const {
+  return SET_SHAPE_PATH_COMMAND;
+}
+
+void SetShapePathCommand::writeJournal(QDataStream & out) const {
+  out << newShapePath;
+}
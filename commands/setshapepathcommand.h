@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetShapePathCommand : public QUndoCommand {
+class SetShapePathCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetShapePathCommand(QString newShapePath, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString oldShapePath;
@@ -44,3 +44,10 @@ void SetSymbolSetCommand::redo(void) {
   parser->setSymbolSet(this->newSymbolSet);
 }
 
+int SetSymbolSetCommand::journalId() const {
+  return SET_SYMBOL_SET_COMMAND;
+}
+
+void SetSymbolSetCommand::writeJournal(QDataStream & out) const {
+  out << newSymbolSet;
+}
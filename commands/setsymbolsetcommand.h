@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetSymbolSetCommand : public QUndoCommand {
+class SetSymbolSetCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetSymbolSetCommand(QString newSymbolSet, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString oldSymbolSet;
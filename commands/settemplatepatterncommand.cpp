@@ -44,3 +44,10 @@ void SetTemplatePatternCommand::redo(void) {
   parser->setTemplatePattern(this->newPattern);
 }
 
+int SetTemplatePatternCommand::journalId() const {
+  return SET_TEMPLATE_PATTERN_COMMAND;
+}
+
+void SetTemplatePatternCommand::writeJournal(QDataStream & out) const {
+  out << newPattern;
+}
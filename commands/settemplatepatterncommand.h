@@ -32,13 +32,17 @@
 #include <QUndoCommand>
 
 #include "../parser/mapfileparser.h"
+#include "commandids.h"
+#include "commandjournal.h"
 
-class SetTemplatePatternCommand : public QUndoCommand {
+class SetTemplatePatternCommand : public QUndoCommand, public JournaledCommand {
 
  public:
    SetTemplatePatternCommand(QString newPattern, MapfileParser * parser, QUndoCommand *parent = 0);
    void undo();
    void redo();
+   int journalId() const;
+   void writeJournal(QDataStream &) const;
 
  private:
    QString oldPattern;
@@ -0,0 +1,219 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#include <QDataStream>
+#include <QDebug>
+#include <QTimer>
+
+#include "commandjournal.h"
+#include "continuousedit.h"
+#include "undobudget.h"
+
+UndoBudget::UndoBudget(QUndoStack * stack, qint64 budget, QObject * parent) : QObject(parent),
+    stack(stack), budget(budget), factory(NULL), parser(NULL), window(NULL),
+    compactedCount(0), enforcePending(false) {
+  this->connect(stack, SIGNAL(indexChanged(int)), SLOT(stackChanged()));
+}
+
+UndoBudget::~UndoBudget() {}
+
+qint64 UndoBudget::getBudget() const {
+  return this->budget;
+}
+
+void UndoBudget::setBudget(qint64 budget) {
+  this->budget = budget;
+  enforce();
+}
+
+void UndoBudget::setCommandFactory(CommandFactory factory, MapfileParser * parser, MainWindow * window) {
+  this->factory = factory;
+  this->parser = parser;
+  this->window = window;
+}
+
+/**
+ * Commands which do not tell their size are counted for the object and
+ * its texts: they only keep a few values.
+ */
+qint64 UndoBudget::getMemoryUsage(QUndoCommand const * command) {
+  qint64 usage;
+  SizedCommand const * sized = dynamic_cast<SizedCommand const *>(command);
+  if (sized) {
+    usage = sized->getMemoryUsage();
+  } else {
+    usage = sizeof(QUndoCommand) + 2 * sizeof(double) + (command->text().size() + command->actionText().size()) * sizeof(QChar);
+  }
+  for (int i = 0; i < command->childCount(); ++i) {
+    usage += getMemoryUsage(command->child(i));
+  }
+  return usage;
+}
+
+qint64 UndoBudget::getMemoryUsage() const {
+  qint64 usage = 0;
+  for (int i = 0; i < this->stack->count(); ++i) {
+    usage += getMemoryUsage(this->stack->command(i));
+  }
+  return usage;
+}
+
+/**
+ * The stack cannot be modified while it notifies a change, the budget is
+ * checked right after.
+ */
+void UndoBudget::stackChanged() {
+  // commands above the index may have been replaced
+  this->compactedCount = qMin(this->compactedCount, this->stack->count());
+  if (! this->enforcePending) {
+    this->enforcePending = true;
+    QTimer::singleShot(0, this, SLOT(enforce()));
+  }
+}
+
+void UndoBudget::enforce() {
+  this->enforcePending = false;
+  if ((this->budget <= 0) || (this->stack->count() == 0))
+    return;
+
+  qint64 usage = getMemoryUsage();
+  if (usage <= this->budget)
+    return;
+
+  // oldest commands first
+  int last = this->stack->count() - UNCOMPACTED_COMMANDS;
+  for (; (this->compactedCount < last) && (usage > this->budget); ++this->compactedCount) {
+    QUndoCommand * command = const_cast<QUndoCommand *>(this->stack->command(this->compactedCount));
+    SizedCommand * sized = dynamic_cast<SizedCommand *>(command);
+    if (sized) {
+      qint64 before = sized->getMemoryUsage();
+      sized->compact();
+      usage -= before - sized->getMemoryUsage();
+    }
+  }
+
+  if (usage > this->budget) {
+    int dropped = collapse();
+    if (dropped > 0) {
+      emit historyCollapsed(dropped);
+    }
+  }
+}
+
+/**
+ * A QUndoStack cannot forget its oldest commands, it is rebuilt instead: the
+ * recent commands are undone, the stack is cleared, then they are created
+ * again from their journal records and pushed back (which redoes them).
+ *
+ * Returns the number of commands dropped.
+ */
+int UndoBudget::collapse() {
+  int count = this->stack->count();
+  int index = this->stack->index();
+  // the current state of the mapfile has to remain in the stack
+  int first = qMin(count - UNCOMPACTED_COMMANDS, index);
+  if ((first <= 0) || (! this->factory)) {
+    return 0;
+  }
+
+  QList<int> ids;
+  QList<QByteArray> payloads;
+  for (int i = first; i < count; ++i) {
+    JournaledCommand const * journaled = dynamic_cast<JournaledCommand const *>(this->stack->command(i));
+    if (! journaled) {
+      return 0;
+    }
+    QByteArray payload;
+    QDataStream out(& payload, QIODevice::WriteOnly);
+    out.setVersion(CommandJournal::STREAM_VERSION);
+    journaled->writeJournal(out);
+    ids << journaled->journalId();
+    payloads << payload;
+  }
+
+  int clean = this->stack->cleanIndex();
+  this->stack->setIndex(first);
+  this->stack->clear();
+  this->compactedCount = 0;
+
+  // the saved state is dropped (or was already gone): pushing below the
+  // clean index makes it unreachable (see QUndoStack::push()), so that the
+  // mapfile is not taken for saved at the bottom of the stack
+  if (clean < first) {
+    this->stack->push(new QUndoCommand());
+    this->stack->setClean();
+    this->stack->undo();
+  }
+
+  // nothing is merged, the commands are pushed back as they were
+  qint64 interval = ContinuousEdit::getInterval();
+  ContinuousEdit::setInterval(0);
+  int pushed = 0;
+  for (; pushed < ids.size(); ++pushed) {
+    QUndoCommand * command = this->factory(ids.at(pushed), payloads.at(pushed), this->parser, this->window);
+    // should not happen, the state of the mapfile is the one it was pushed on
+    if (! command) {
+      qWarning() << "Unable to create the command" << ids.at(pushed) << "again, the later ones are dropped";
+      break;
+    }
+    this->stack->push(command);
+  }
+  ContinuousEdit::setInterval(interval);
+
+  if ((clean >= first) && (clean - first <= pushed)) {
+    this->stack->setIndex(clean - first);
+    this->stack->setClean();
+  }
+  this->stack->setIndex(qMin(index - first, pushed));
+  return first;
+}
+
+UndoMemoryDelegate::UndoMemoryDelegate(QUndoStack * stack, QObject * parent) : QStyledItemDelegate(parent),
+    stack(stack) {}
+
+QString UndoMemoryDelegate::formatSize(qint64 bytes) {
+  if (bytes < 1024)
+    return QObject::tr("%1 B").arg(bytes);
+  if (bytes < 1024 * 1024)
+    return QObject::tr("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1);
+  return QObject::tr("%1 MiB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+void UndoMemoryDelegate::initStyleOption(QStyleOptionViewItem * option, QModelIndex const & index) const {
+  QStyledItemDelegate::initStyleOption(option, index);
+  int i = index.row() - 1;
+  if ((i < 0) || (i >= this->stack->count()))
+    return;
+#if QT_VERSION >= 0x050000
+  QStyleOptionViewItem * item = option;
+#else
+  QStyleOptionViewItemV4 * item = qstyleoption_cast<QStyleOptionViewItemV4 *>(option);
+  if (! item)
+    return;
+#endif
+  item->text += QString(" (%1)").arg(formatSize(UndoBudget::getMemoryUsage(this->stack->command(i))));
+}
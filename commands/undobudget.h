@@ -0,0 +1,128 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#ifndef UNDOBUDGET_H
+#define UNDOBUDGET_H
+
+#include <QObject>
+#include <QStyledItemDelegate>
+#include <QUndoCommand>
+#include <QUndoStack>
+
+class MainWindow;
+class MapfileParser;
+
+/**
+ * Implemented by the commands keeping large copies of mapfile objects, so
+ * that their memory use can be measured, and the copies compacted once the
+ * commands get old.
+ */
+class SizedCommand {
+ public:
+  virtual ~SizedCommand() {}
+
+  virtual qint64 getMemoryUsage() const = 0;
+  // replaces the copies with a compressed form, restored when needed
+  virtual void compact() = 0;
+};
+
+/**
+ * Keeps the memory used by the commands of an undo stack below a budget.
+ *
+ * When the budget is exceeded, the oldest commands are compacted first
+ * (the most recent ones are left as is). If this is not enough, the
+ * history is collapsed: the commands older than the UNCOMPACTED_COMMANDS
+ * most recent ones are dropped, the mapfile as it was before the remaining
+ * ones becoming the starting point of the stack.
+ */
+class UndoBudget : public QObject {
+
+ Q_OBJECT
+
+ public:
+  UndoBudget(QUndoStack * stack, qint64 budget = DEFAULT_BUDGET, QObject * parent = 0);
+  ~UndoBudget();
+
+  qint64 getBudget() const;
+  void setBudget(qint64);
+
+  qint64 getMemoryUsage() const;
+  static qint64 getMemoryUsage(QUndoCommand const *);
+
+  // creates a command from its journal record (see createJournaledCommand())
+  typedef QUndoCommand * (* CommandFactory)(int commandId, QByteArray const & payload, MapfileParser *, MainWindow *);
+  // the recent commands are created again when collapsing the history, which
+  // is kept as is without a factory
+  void setCommandFactory(CommandFactory, MapfileParser *, MainWindow *);
+
+  // 64 MiB
+  static const qint64 DEFAULT_BUDGET = 64 * 1024 * 1024;
+  // number of recent commands which are never compacted nor dropped
+  static const int UNCOMPACTED_COMMANDS = 16;
+
+ signals:
+  // the given number of oldest commands have been dropped
+  void historyCollapsed(int commandCount);
+
+ public slots:
+  void enforce();
+
+ private slots:
+  void stackChanged();
+
+ private:
+  int collapse();
+
+  QUndoStack * stack;
+  qint64 budget;
+  CommandFactory factory;
+  MapfileParser * parser;
+  MainWindow * window;
+  // the commands below this index have been compacted already
+  int compactedCount;
+  bool enforcePending;
+};
+
+/**
+ * Shows the memory used by each command in a QUndoView (whose first row is
+ * the initial state of the stack).
+ */
+class UndoMemoryDelegate : public QStyledItemDelegate {
+
+ public:
+  UndoMemoryDelegate(QUndoStack * stack, QObject * parent = 0);
+
+  static QString formatSize(qint64 bytes);
+
+ protected:
+  void initStyleOption(QStyleOptionViewItem * option, QModelIndex const & index) const;
+
+ private:
+  QUndoStack * stack;
+};
+
+#endif // UNDOBUDGET_H
@@ -26,6 +26,9 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
  ****************************************************************************/
 
+#include <algorithm>
+#include <functional>
+
 #include "keyvaluemodel.h"
 
 
@@ -39,7 +42,7 @@ KeyValueModel::~KeyValueModel() {}
 
 int KeyValueModel::rowCount(const QModelIndex & parent) const {
   Q_UNUSED(parent);
-  return m_data.keys().size();
+  return m_keys.size();
 }
 
 int KeyValueModel::columnCount(const QModelIndex &parent) const {
@@ -70,6 +73,11 @@ void KeyValueModel::setData(QHash<QString,QString> const & kv) {
 
   beginResetModel();
   m_data = cop;
+  m_keys = cop.keys();
+  m_keys.sort();
+  m_rows.clear();
+  for (int i = 0; i < m_keys.size(); ++i)
+    m_rows.insert(m_keys.at(i), i);
   endResetModel();
 }
 
@@ -77,35 +85,71 @@ QHash<QString,QString> const & KeyValueModel::getData(void) const {
   return m_data;
 }
 
+QString const & KeyValueModel::keyAt(int row) const {
+  return m_keys.at(row);
+}
+
+int KeyValueModel::rowOf(QString const & key) const {
+  return m_rows.value(key, -1);
+}
+
+/**
+ * Adds a key (as a new last row) or updates its value (in place).
+ */
 void KeyValueModel::addData(QString const & k, QString const &v) {
   if (extra_filters.contains(k))
     return;
-  // It might appear overkill to reset entirely the model
-  // but the interface is not meant to contain hundreds of rows.
-  beginResetModel();
+
+  int row = m_rows.value(k, -1);
+  if (row != -1) {
+    m_data.insert(k,v);
+    emit dataChanged(index(row, KeyValueModel::Value), index(row, KeyValueModel::Value));
+    return;
+  }
+
+  row = m_keys.size();
+  beginInsertRows(QModelIndex(), row, row);
   m_data.insert(k,v);
-  endResetModel();
+  m_keys.append(k);
+  m_rows.insert(k, row);
+  endInsertRows();
 }
 
 void KeyValueModel::removeData(QString const &k) {
-  beginResetModel();
-  m_data.remove(k);
-  endResetModel();
+  int row = m_rows.value(k, -1);
+  if (row != -1)
+    removeRowRange(row, row);
 }
 
-
 void KeyValueModel::removeDataAt(QModelIndexList const & selection) {
-  QStringList toRemove = QStringList();
+  QList<int> rows;
   for (int i = 0; i < selection.size(); ++i) {
-    toRemove << m_data.keys().at(selection.at(i).row());
+    int row = selection.at(i).row();
+    if ((row >= 0) && (row < m_keys.size()) && (! rows.contains(row)))
+      rows << row;
   }
-  // Doing in 2 passes to avoid messing up with indices offsets
-  beginResetModel();
-  for (int i = 0; i < toRemove.size(); ++i) {
-    m_data.remove(toRemove.at(i));
+  // from the last row, so that the remaining ones keep their indices, and
+  // by ranges of consecutive rows
+  std::sort(rows.begin(), rows.end(), std::greater<int>());
+  for (int i = 0; i < rows.size();) {
+    int last = rows.at(i), first = last;
+    while ((++i < rows.size()) && (rows.at(i) == first - 1))
+      first--;
+    removeRowRange(first, last);
   }
-  endResetModel();
+}
 
+void KeyValueModel::removeRowRange(int first, int last) {
+  beginRemoveRows(QModelIndex(), first, last);
+  for (int i = first; i <= last; ++i) {
+    m_data.remove(m_keys.at(i));
+    m_rows.remove(m_keys.at(i));
+  }
+  m_keys.erase(m_keys.begin() + first, m_keys.begin() + last + 1);
+  // the following rows move up
+  for (int i = first; i < m_keys.size(); ++i)
+    m_rows.insert(m_keys.at(i), i);
+  endRemoveRows();
 }
 
 QVariant KeyValueModel::data(const QModelIndex &index, int role) const {
@@ -117,13 +161,13 @@ QVariant KeyValueModel::data(const QModelIndex &index, int role) const {
   if (role != Qt::DisplayRole)
     return QVariant();
 
-  if (index.row() >= m_data.keys().size())
+  if (index.row() >= m_keys.size())
     return QVariant();
 
   if (index.column() > KeyValueModel::Value)
     return QVariant();
 
-  QString key = m_data.keys().at(index.row());
+  QString const & key = m_keys.at(index.row());
 
   if (index.column() == KeyValueModel::Key) {
     return key;
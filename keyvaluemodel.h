@@ -32,9 +32,14 @@
 #include <QAbstractTableModel>
 #include <QHash>
 #include <QString>
+#include <QStringList>
 
 /*
  * Simple model to map Key/Value stores.
+ *
+ * The rows are kept in order (sorted keys when set, then the added ones
+ * appended), a key keeping its row as long as it is not removed. Additions
+ * and removals are notified as such instead of resetting the model.
  */
 class KeyValueModel : public QAbstractTableModel {
 
@@ -54,13 +59,21 @@ class KeyValueModel : public QAbstractTableModel {
     void removeDataAt(QModelIndexList const &);
     QHash<QString, QString> const & getData() const;
 
+    QString const & keyAt(int row) const;
+    int rowOf(QString const & key) const;
+
     void setExtraFilters(QStringList const &);
 
     enum Column { Key, Value };
   protected:
     QHash<QString, QString>  m_data;
+    // keys in the order of the rows, and the reverse lookup
+    QStringList m_keys;
+    QHash<QString, int> m_rows;
     QStringList extra_filters;
 
+    void removeRowRange(int first, int last);
+
 };
 
 #endif // KEYVALUEMODEL_H
@@ -32,7 +32,7 @@
 
 
 LayerSettings::LayerSettings(QWidget *parent, MapfileParser *p, Layer *l):
-   QTabWidget(parent), mapfile(p), layer(l) {};
+   QTabWidget(parent), mapfile(p), layer(l), liveEditIndex(-1) {};
 
 void LayerSettings::initStatusRadioButton(QRadioButton * on, QRadioButton * off, QRadioButton * defaultRadio) {
   if(layer->getStatus() == 1) {
@@ -137,8 +137,33 @@ void LayerSettings::accept() {
     ChangeLayerFooterCommand *fc = new ChangeLayerFooterCommand(layer, layer->getFooter(), this->getLayerFooter());
     stack->push(fc);
   }
-
+  this->liveEditIndex = -1;
 }
 
 void LayerSettings::reject() {
+  QDialog * ls = (QDialog *) parent();
+  MainWindow * mw = (MainWindow *) ls->parent();
+  QUndoStack * stack = mw->getUndoStack();
+
+  // the changes applied while editing are undone
+  while ((this->liveEditIndex != -1) && (stack->index() > this->liveEditIndex) &&
+         (stack->command(stack->index() - 1)->id() == CHANGE_LAYER_OPACITY_COMMAND)) {
+    stack->undo();
+  }
+  this->liveEditIndex = -1;
+}
+
+/**
+ * The preview follows the opacity while it is being changed (e.g. scrolling
+ * the spinbox), the steps being merged into one command.
+ */
+void LayerSettings::opacityChanged(int value) {
+  if (value == layer->getOpacity())
+    return;
+  QDialog * ls = (QDialog *) parent();
+  MainWindow * mw = (MainWindow *) ls->parent();
+  QUndoStack * stack = mw->getUndoStack();
+  if (this->liveEditIndex == -1)
+    this->liveEditIndex = stack->index();
+  stack->push(new ChangeLayerOpacityCommand(layer, layer->getOpacity(), value));
 }
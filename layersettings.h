@@ -16,6 +16,7 @@
 
 #include "keyvaluemodel.h"
 #include "commands/changemapnamecommand.h"
+#include "commands/commandids.h"
 #include "parser/mapfileparser.h"
 #include "parser/layer.h"
 
@@ -28,6 +29,9 @@ class LayerSettings : public QTabWidget {
     LayerSettings(QWidget *parent, MapfileParser *, Layer *);
     MapfileParser * mapfile;
     Layer *layer;
+    // index of the undo stack before the opacity changes applied while
+    // editing, -1 if none
+    int liveEditIndex;
 
     void initStatusRadioButton(QRadioButton *, QRadioButton *, QRadioButton *);
     void initRequiresMaskCombo(QComboBox *, QComboBox *);
@@ -50,6 +54,9 @@ class LayerSettings : public QTabWidget {
     virtual QString getLayerHeader() const = 0;
     virtual QString getLayerFooter() const = 0;
 
+  protected slots:
+    void opacityChanged(int);
+
 };
 
 
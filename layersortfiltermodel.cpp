@@ -0,0 +1,152 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#include <algorithm>
+
+#include "layersortfiltermodel.h"
+
+LayerSortFilterModel::LayerSortFilterModel(QObject * parent) : QSortFilterProxyModel(parent),
+    layers(NULL), rankedColumn(-1), filteredColumn(LayerModel::LAYER_NAME), acceptedValid(false) {
+  this->setDynamicSortFilter(true);
+}
+
+LayerSortFilterModel::~LayerSortFilterModel() {}
+
+/**
+ * Only LayerModels are supported. The precomputed ranks have to be dropped
+ * before the proxy reacts to a change, hence the connections made first.
+ */
+void LayerSortFilterModel::setSourceModel(QAbstractItemModel * model) {
+  if (model == this->sourceModel())
+    return;
+  if (this->layers) {
+    this->layers->disconnect(this);
+  }
+  this->layers = dynamic_cast<LayerModel *>(model);
+  sourceChanged();
+
+  if (this->layers) {
+    this->connect(layers, SIGNAL(dataChanged(QModelIndex, QModelIndex)), SLOT(sourceChanged()));
+    this->connect(layers, SIGNAL(rowsInserted(QModelIndex, int, int)), SLOT(sourceChanged()));
+    this->connect(layers, SIGNAL(rowsRemoved(QModelIndex, int, int)), SLOT(sourceChanged()));
+    this->connect(layers, SIGNAL(modelReset()), SLOT(sourceChanged()));
+    this->connect(layers, SIGNAL(layoutChanged()), SLOT(sourceChanged()));
+  }
+  QSortFilterProxyModel::setSourceModel(this->layers);
+}
+
+/**
+ * Keeps the rows whose value in the given column matches the pattern (all
+ * of them if the pattern is empty).
+ */
+void LayerSortFilterModel::setFilter(QRegExp const & pattern, int column) {
+  this->pattern = pattern;
+  this->filteredColumn = column;
+  this->acceptedValid = false;
+  this->invalidateFilter();
+}
+
+void LayerSortFilterModel::sourceChanged() {
+  this->ranks.clear();
+  this->rankedColumn = -1;
+  this->acceptedValid = false;
+}
+
+// compares the rows of a column through typed copies of its values
+class ColumnLess {
+ public:
+  ColumnLess(QVector<QVariant> const & values) : numeric(true) {
+    for (int i = 0; i < values.size() && numeric; ++i) {
+      QVariant::Type type = values.at(i).type();
+      numeric = (type == QVariant::Int) || (type == QVariant::Double) || (type == QVariant::Bool);
+    }
+    if (numeric) {
+      numbers.resize(values.size());
+      for (int i = 0; i < values.size(); ++i)
+        numbers[i] = values.at(i).toDouble();
+    } else {
+      texts.resize(values.size());
+      for (int i = 0; i < values.size(); ++i)
+        texts[i] = values.at(i).toString();
+    }
+  }
+
+  bool operator()(int a, int b) const {
+    if (numeric)
+      return numbers.at(a) < numbers.at(b);
+    return texts.at(a).compare(texts.at(b), Qt::CaseInsensitive) < 0;
+  }
+
+ private:
+  bool numeric;
+  QVector<double> numbers;
+  QVector<QString> texts;
+};
+
+void LayerSortFilterModel::computeRanks(int column) const {
+  QVector<QVariant> const & values = this->layers->getColumn(column);
+
+  QVector<int> order(values.size());
+  for (int i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), ColumnLess(values));
+
+  this->ranks.resize(order.size());
+  for (int i = 0; i < order.size(); ++i)
+    this->ranks[order.at(i)] = i;
+  this->rankedColumn = column;
+}
+
+void LayerSortFilterModel::computeAccepted() const {
+  this->accepted.clear();
+  if (this->layers && (! this->pattern.isEmpty())) {
+    QVector<QVariant> const & values = this->layers->getColumn(this->filteredColumn);
+    this->accepted.resize(values.size());
+    for (int i = 0; i < values.size(); ++i)
+      this->accepted[i] = (this->pattern.indexIn(values.at(i).toString()) != -1);
+  }
+  this->acceptedValid = true;
+}
+
+bool LayerSortFilterModel::lessThan(QModelIndex const & left, QModelIndex const & right) const {
+  if (! this->layers)
+    return false;
+  if ((this->rankedColumn != left.column()) || (this->ranks.size() != this->layers->rowCount()))
+    computeRanks(left.column());
+  if ((left.row() >= this->ranks.size()) || (right.row() >= this->ranks.size()))
+    return left.row() < right.row();
+  return this->ranks.at(left.row()) < this->ranks.at(right.row());
+}
+
+bool LayerSortFilterModel::filterAcceptsRow(int row, QModelIndex const & parent) const {
+  Q_UNUSED(parent);
+  if (this->pattern.isEmpty() || (! this->layers))
+    return true;
+  if ((! this->acceptedValid) || (this->accepted.size() != this->layers->rowCount()))
+    computeAccepted();
+  return (row < this->accepted.size()) ? this->accepted.at(row) : true;
+}
@@ -0,0 +1,81 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#ifndef LAYERSORTFILTERMODEL_H
+#define LAYERSORTFILTERMODEL_H
+
+#include <QRegExp>
+#include <QSortFilterProxyModel>
+#include <QVector>
+
+#include "parser/layer.h"
+
+/**
+ * Sorts and filters a LayerModel without calling data() for each
+ * comparison: the rank of every row in the sorted column is computed once
+ * from the cached column (see LayerModel::getColumn()), and so are the rows
+ * matching the filter. Both are computed again only when the source model
+ * changes.
+ *
+ * Numeric columns are compared as numbers, the other ones as text (case
+ * insensitive).
+ */
+class LayerSortFilterModel : public QSortFilterProxyModel {
+
+ Q_OBJECT
+
+ public:
+  LayerSortFilterModel(QObject * parent = 0);
+  ~LayerSortFilterModel();
+
+  void setSourceModel(QAbstractItemModel *);
+  void setFilter(QRegExp const &, int column);
+
+ protected:
+  bool lessThan(QModelIndex const &, QModelIndex const &) const;
+  bool filterAcceptsRow(int, QModelIndex const &) const;
+
+ private slots:
+  void sourceChanged();
+
+ private:
+  LayerModel * layers;
+
+  // rank of each source row in the sorted column
+  mutable QVector<int> ranks;
+  mutable int rankedColumn;
+
+  QRegExp pattern;
+  int filteredColumn;
+  mutable QVector<bool> accepted;
+  mutable bool acceptedValid;
+
+  void computeRanks(int column) const;
+  void computeAccepted() const;
+};
+
+#endif // LAYERSORTFILTERMODEL_H
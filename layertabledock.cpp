@@ -0,0 +1,106 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#include "layertabledock.h"
+
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+LayerTableDock::LayerTableDock(QWidget * parent) : QDockWidget(tr("Layer table"), parent), layers(NULL) {
+  this->setObjectName("layerTableDock");
+
+  QWidget * content = new QWidget(this);
+
+  this->filter = new QLineEdit(content);
+  this->filter->setPlaceholderText(tr("Filter (regular expression)"));
+  this->filterColumn = new QComboBox(content);
+
+  this->proxy = new LayerSortFilterModel(this);
+
+  this->view = new QTableView(content);
+  this->view->setModel(this->proxy);
+  this->view->setSortingEnabled(true);
+  this->view->sortByColumn(-1, Qt::AscendingOrder);
+  this->view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  this->view->setSelectionBehavior(QAbstractItemView::SelectRows);
+  this->view->verticalHeader()->hide();
+  this->view->horizontalHeader()->setStretchLastSection(true);
+
+  QHBoxLayout * filterLayout = new QHBoxLayout();
+  filterLayout->addWidget(this->filter);
+  filterLayout->addWidget(this->filterColumn);
+
+  QVBoxLayout * layout = new QVBoxLayout(content);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->addLayout(filterLayout);
+  layout->addWidget(this->view);
+  this->setWidget(content);
+
+  this->connect(this->filter, SIGNAL(textChanged(QString)), SLOT(filterChanged()));
+  this->connect(this->filterColumn, SIGNAL(currentIndexChanged(int)), SLOT(filterChanged()));
+}
+
+/**
+ * Shows the layers of the given model. As sorting needs every row, all of
+ * them are fetched at once.
+ */
+void LayerTableDock::setLayerModel(LayerModel * layers) {
+  if (this->layers) {
+    this->layers->disconnect(this);
+  }
+  this->layers = layers;
+  fetchAll();
+  this->proxy->setSourceModel(layers);
+  // after the proxy, so that it is done with the reset before the new rows come
+  if (layers) {
+    this->connect(layers, SIGNAL(modelReset()), SLOT(fetchAll()));
+  }
+
+  this->filterColumn->blockSignals(true);
+  this->filterColumn->clear();
+  if (layers) {
+    for (int i = 0; i < layers->columnCount(); ++i)
+      this->filterColumn->addItem(layers->headerData(i, Qt::Horizontal).toString(), i);
+  }
+  this->filterColumn->blockSignals(false);
+  filterChanged();
+}
+
+void LayerTableDock::fetchAll() {
+  if (! this->layers)
+    return;
+  while (this->layers->canFetchMore(QModelIndex()))
+    this->layers->fetchMore(QModelIndex());
+}
+
+void LayerTableDock::filterChanged() {
+  int column = this->filterColumn->itemData(this->filterColumn->currentIndex()).toInt();
+  this->proxy->setFilter(QRegExp(this->filter->text(), Qt::CaseInsensitive), column);
+}
+
+LayerTableDock::~LayerTableDock() {}
@@ -0,0 +1,64 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#ifndef LAYERTABLEDOCK_H
+#define LAYERTABLEDOCK_H
+
+#include <QComboBox>
+#include <QDockWidget>
+#include <QLineEdit>
+#include <QTableView>
+
+#include "layersortfiltermodel.h"
+
+/**
+ * Dock panel listing the layers of the mapfile as a table, sortable by any
+ * column and filtered by a regular expression on a chosen column.
+ */
+class LayerTableDock : public QDockWidget {
+
+ Q_OBJECT
+
+ public:
+  LayerTableDock(QWidget * parent = 0);
+  ~LayerTableDock();
+
+  void setLayerModel(LayerModel *);
+
+ private slots:
+  void fetchAll();
+  void filterChanged();
+
+ private:
+  LayerModel * layers;
+  LayerSortFilterModel * proxy;
+  QLineEdit * filter;
+  QComboBox * filterColumn;
+  QTableView * view;
+};
+
+#endif // LAYERTABLEDOCK_H
@@ -26,6 +26,11 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
  ****************************************************************************/
 
+#include <mapserver.h>
+
+#include <QApplication>
+#include <QDebug>
+
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
@@ -38,6 +43,15 @@ MainWindow::MainWindow(QWidget *parent) :
   this->setWindowIcon(QIcon(":/ui/images/icons/icon.png"));
 
   this->undoStack = new QUndoStack(this);
+  // the budget can be set in MiB from the environment
+  this->undoBudget = new UndoBudget(this->undoStack, UndoBudget::DEFAULT_BUDGET, this);
+  bool budgetSet = false;
+  qint64 budget = qgetenv("QME_UNDO_BUDGET").toLongLong(& budgetSet);
+  if (budgetSet) {
+    this->undoBudget->setBudget(budget * 1024 * 1024);
+  }
+  this->connect(this->undoBudget, SIGNAL(historyCollapsed(int)), SLOT(undoHistoryCollapsed(int)));
+  this->journal = new CommandJournal(this->undoStack, this);
 
   this->showInfo(tr("Initializing default mapfile"));
 
@@ -64,6 +78,39 @@ MainWindow::MainWindow(QWidget *parent) :
   this->connect(mapScene, SIGNAL(notifyAreaToZoomOut()), this, SLOT(zoomOutMapPreview()));
   this->connect(mapScene, SIGNAL(notifyAreaToPan(qreal, qreal)), this, SLOT(panPreview(qreal, qreal)));
 
+  // inits the background renderer
+  this->renderer = new MapRenderer(this);
+  this->rendererMapfileOutdated = true;
+  this->connect(renderer, SIGNAL(tileRendered(MapTile, QImage)), this, SLOT(tileRendered(MapTile, QImage)));
+
+  this->previewScheduler = new RefreshScheduler(this);
+  this->connect(previewScheduler, SIGNAL(refresh()), this, SLOT(updateMapPreview()));
+
+  // feedback of the background loading of the mapfiles
+  this->loadingProgress = new QProgressBar(this);
+  this->loadingProgress->setMaximumWidth(200);
+  this->loadingProgress->setTextVisible(false);
+  this->loadingProgress->hide();
+  this->loadingCancel = new QToolButton(this);
+  this->loadingCancel->setText(tr("Cancel"));
+  this->loadingCancel->hide();
+  this->connect(loadingCancel, SIGNAL(clicked()), SLOT(cancelMapfileLoading()));
+  ui->statusbar->addPermanentWidget(this->loadingProgress);
+  ui->statusbar->addPermanentWidget(this->loadingCancel);
+  // how many preview refreshes have been saved by coalescing them
+  this->refreshStats = new QLabel(this);
+  this->refreshStats->setToolTip(tr("Refreshes of the preview requested in a row are performed once"));
+  ui->statusbar->addPermanentWidget(this->refreshStats);
+  this->snapshotModel = new QStandardItemModel(this);
+
+  // tiles cost is expressed in KiB, keeping up to 128 MiB of tiles
+  this->tileCache.setMaxCost(128 * 1024);
+  // same for the layers drawings (blank ones cost almost nothing)
+  this->layerTileCache.setMaxCost(256 * 1024);
+  this->previewRevision = 0;
+  this->previewZoom = 0;
+  this->previewResolution = 0.0;
+
 
   // connects extra actions
   this->showInfo("Activate actions");
@@ -75,6 +122,8 @@ MainWindow::MainWindow(QWidget *parent) :
   this->connect(ui->actionFont,        SIGNAL(triggered()), SLOT(showFontSettings()));
   this->connect(ui->actionAbout,      SIGNAL(triggered()), SLOT(showAbout()));
   this->connect(ui->actionRefresh,    SIGNAL(triggered()), SLOT(updateMapPreview()));
+  this->connect(ui->actionProfilePreview, SIGNAL(triggered()), SLOT(profileMapPreview()));
+  this->connect(ui->actionLayerTable, SIGNAL(triggered()), SLOT(showLayerTable()));
 
   // edit menu
   this->connect(ui->actionUndo, SIGNAL(triggered()), undoStack, SLOT(undo()));
@@ -91,14 +140,12 @@ MainWindow::MainWindow(QWidget *parent) :
 
   //creates a default empty mapfileparser
   this->mapfile = new MapfileParser(QString());
+  this->undoBudget->setCommandFactory(createJournaledCommand, this->mapfile, this);
   this->showInfo(tr("Initialisation process: success !"));
 
   // creates a Layer model
-  this->layerModel = new LayerModel(this, this->mapfile->getLayers());
-  ui->mf_structure->setModel(layerModel);
-  for (int i = 1; i < layerModel->columnCount(); i++) {
-      ui->mf_structure->hideColumn(i);
-  }
+  this->layerModel = new LayerModel(this, this->mapfile);
+  this->showLayerModel();
 
   // menu for adding a new layer (vector/raster)
   QMenu * newLayerMenu = new QMenu(ui->mf_addlayer);
@@ -120,7 +167,18 @@ void MainWindow::handleUndoStackChanged(int i) {
   ui->actionUndo->setText(tr("Undo '%1'").arg(undoStack->undoText()));
   ui->actionRedo->setText(tr("Redo '%1'").arg(undoStack->redoText()));
 
-  this->updateMapPreview();
+  // the copy of the mapfile used by the renderer is no longer up-to-date,
+  // and the tiles drawn so far refer to the previous revision.
+  this->mapfile->bumpRevision();
+  this->rendererMapfileOutdated = true;
+  this->scheduleMapPreview();
+
+  // the layers modified by the command are read again
+  this->layerModel->refresh();
+
+  if (this->undoView && this->undoView->isVisible()) {
+    this->showUndoStack();
+  }
 }
 
 // TODO separation of concerns: maybe just a getter
@@ -136,12 +194,24 @@ void MainWindow::showUndoStack() {
   if (undoView == 0)
   {
     undoView = new QUndoView(undoStack);
-    undoView->setWindowTitle(tr("Undo stack"));
+    undoView->setItemDelegate(new UndoMemoryDelegate(undoStack, undoView));
     undoView->setAttribute(Qt::WA_QuitOnClose,false);
   }
+  undoView->setWindowTitle(tr("Undo stack (%1 of %2)")
+                           .arg(UndoMemoryDelegate::formatSize(this->undoBudget->getMemoryUsage()))
+                           .arg(UndoMemoryDelegate::formatSize(this->undoBudget->getBudget())));
   undoView->show();
 }
 
+void MainWindow::undoHistoryCollapsed(int commandCount) {
+  // the stack has been rebuilt, so is its journal
+  this->journal->reset();
+  if (this->savingIndex != -1) {
+    this->savingLost = true;
+  }
+  this->showInfo(tr("Oldest undo history dropped to fit in memory (%1 commands)").arg(commandCount));
+}
+
 // Zoom / Pan / ... map related methods
 
 void MainWindow::zoomOutMapPreview() {
@@ -173,8 +243,21 @@ void MainWindow::panPreview(qreal relatx, qreal relaty) {
   this->currentMapMaxX -= offsetx;
   this->currentMapMaxY -= offsety;
 
+  // the scene has already been shifted while dragging (see MapScene), what
+  // is displayed is kept until the newly exposed parts get drawn.
+  QRectF sceneRect = ui->mf_preview->sceneRect();
+  QPixmap backdrop(sceneRect.size().toSize());
+  backdrop.fill(Qt::transparent);
+  QPainter painter(& backdrop);
+  ui->mf_preview->scene()->render(& painter, QRectF(backdrop.rect()), sceneRect);
+  painter.end();
+
   this->updateMapPreview();
 
+  // over the coarser tiles and drafts, under the up-to-date tiles
+  QGraphicsPixmapItem * item = ui->mf_preview->scene()->addPixmap(backdrop);
+  item->setPos(sceneRect.topLeft());
+  item->setZValue(-0.5);
 }
 
 void MainWindow::zoomMapPreview(QRectF area) {
@@ -252,7 +335,11 @@ void MainWindow::panToggled(bool toggle) {
   }
 }
 
-void MainWindow::reinitMapfile() {
+/**
+ * Gives up what refers to the current mapfile (windows, renders, edits),
+ * which can be deleted afterwards.
+ */
+void MainWindow::closeMapfile() {
   // if a MapSettings window has been opened, closes and destroys it
   if (this->settings) {
     this->settings->close();
@@ -266,13 +353,27 @@ void MainWindow::reinitMapfile() {
     this->layerSettingsDialog = NULL;
   }
 
-  ((QStringListModel *) ui->mf_structure->model())->setStringList(QStringList());
-
   ui->mf_preview->scene()->clear();
 
+  // discards any render of the previous mapfile
+  this->renderer->cancel();
+  this->rendererMapfileOutdated = true;
+
+  // the edits are given up, the commands refer to the previous mapfile
+  this->journal->discard();
+  this->undoStack->clear();
+  this->savingIndex = -1;
+}
+
+void MainWindow::reinitMapfile() {
+  this->closeMapfile();
+
   // Creates a new mapfileparser from scratch
   delete this->mapfile;
   this->mapfile = new MapfileParser(QString());
+  this->undoBudget->setCommandFactory(createJournaledCommand, this->mapfile, this);
+  this->layerModel->setMapfile(this->mapfile);
+  this->resetPreviewTiles();
 
   // (re) init default extent
   this->currentMapMinX = this->mapfile->getMapExtentMinX();
@@ -327,18 +428,125 @@ void MainWindow::openMapfile()
   this->openMapfile(fileName);
 }
 
+/**
+ * Starts loading the given mapfile in background (see MapfileLoader). The
+ * current one is replaced once it is loaded, in mapfileLoaded().
+ */
 void MainWindow::openMapfile(const QString & mapfilePath) {
   if (mapfilePath.isEmpty()) {
     return;
   }
 
-  // Reinit / free objects if necessary
+  // a single loading at once, the previous one is given up
+  if (this->loader) {
+    this->loader->cancel();
+  }
+
+  this->loader = new MapfileLoader(mapfilePath, this);
+  this->connect(loader, SIGNAL(progress(qint64, int)), SLOT(mapfileLoadingProgress(qint64, int)));
+  this->connect(loader, SIGNAL(parsing()), SLOT(mapfileParsing()));
+  this->connect(loader, SIGNAL(snapshotLoaded(MapfileSnapshot)), SLOT(mapfileSnapshotLoaded(MapfileSnapshot)));
+  this->connect(loader, SIGNAL(finished()), SLOT(mapfileLoaded()));
+
+  this->loadingProgress->setRange(0, 0);
+  this->loadingProgress->show();
+  this->loadingCancel->show();
+  this->showInfo(tr("Loading %1...").arg(QFileInfo(mapfilePath).fileName()));
+
+  this->loader->start();
+}
+
+void MainWindow::mapfileLoadingProgress(qint64 bytesRead, int includesResolved) {
+  if (sender() != this->loader) {
+    return;
+  }
+  this->showInfo(tr("Loading %1: %2 KiB read, %3 included files")
+                 .arg(QFileInfo(this->loader->getFilename()).fileName())
+                 .arg(bytesRead / 1024).arg(includesResolved));
+}
+
+void MainWindow::mapfileParsing() {
+  if (sender() != this->loader) {
+    return;
+  }
+  this->showInfo(tr("Parsing %1...").arg(QFileInfo(this->loader->getFilename()).fileName()));
+}
+
+/**
+ * Displays the layers tree of the mapfile being loaded, as it was the last
+ * time it has been opened, until the mapfile is actually loaded.
+ */
+void MainWindow::mapfileSnapshotLoaded(MapfileSnapshot snapshot) {
+  if (sender() != this->loader) {
+    return;
+  }
+
+  this->snapshotModel->clear();
+  this->snapshotModel->setHorizontalHeaderLabels(QStringList(tr("Layers")));
+  for (int i = 0; i < snapshot.layers.size(); ++i) {
+    QStandardItem * item = new QStandardItem(snapshot.layers[i].name);
+    item->setEditable(false);
+    item->setEnabled(false);
+    this->snapshotModel->appendRow(item);
+  }
+  ui->mf_structure->setModel(this->snapshotModel);
+}
+
+/**
+ * Puts back the model of the layers into the layers tree, showing the
+ * names only.
+ */
+void MainWindow::showLayerModel() {
+  ui->mf_structure->setModel(this->layerModel);
+  for (int i = 1; i < this->layerModel->columnCount(); i++) {
+      ui->mf_structure->hideColumn(i);
+  }
+}
+
+void MainWindow::cancelMapfileLoading() {
+  if (this->loader) {
+    this->loader->cancel();
+    this->showInfo(tr("Cancelling the loading of the mapfile..."));
+  }
+}
+
+/**
+ * Swaps the mapfile being edited for the one which has just been loaded.
+ */
+void MainWindow::mapfileLoaded() {
+  MapfileLoader * finished = qobject_cast<MapfileLoader *>(sender());
+  if (! finished) {
+    return;
+  }
+  finished->deleteLater();
+  // superseded by a later loading
+  if (finished != this->loader) {
+    return;
+  }
+  this->loader = NULL;
+  this->loadingProgress->hide();
+  this->loadingCancel->hide();
+  if (ui->mf_structure->model() != this->layerModel) {
+    this->showLayerModel();
+    this->snapshotModel->clear();
+  }
+
+  if (finished->isCancelled()) {
+    this->showInfo(tr("Loading cancelled"));
+    return;
+  }
+
+  // Free objects if necessary
   if (this->mapfile) {
-    this->reinitMapfile();
+    this->closeMapfile();
+    delete this->mapfile;
   }
 
-  this->mapfile = new MapfileParser(mapfilePath);
-  this->layerModel->setLayers(this->mapfile->getLayers());
+  this->mapfile = finished->takeParser();
+  this->undoBudget->setCommandFactory(createJournaledCommand, this->mapfile, this);
+  this->rendererMapfileOutdated = true;
+  this->resetPreviewTiles();
+  this->layerModel->setMapfile(this->mapfile);
 
   if (! this->mapfile->isLoaded()) {
     QMessageBox::critical(
@@ -348,55 +556,446 @@ void MainWindow::openMapfile(const QString & mapfilePath) {
         );
     this->reinitMapfile();
     this->showInfo("");
-    this->layerModel->setLayers(this->mapfile->getLayers());
+    this->layerModel->setMapfile(this->mapfile);
     return;
   }
 
-  ui->mf_structure->setModel(layerModel);
+  this->showLayerModel();
   // inits the default extent
   this->currentMapMinX = this->mapfile->getMapExtentMinX();
   this->currentMapMinY = this->mapfile->getMapExtentMinY();
   this->currentMapMaxX = this->mapfile->getMapExtentMaxX();
   this->currentMapMaxY = this->mapfile->getMapExtentMaxY();
 
+  this->showInfo("");
+  this->recoverUnsavedEdits();
   this->updateMapPreview();
 
 }
 
+/**
+ * Replays the edits left in the journal of the mapfile just loaded, if the
+ * application crashed while editing it, then journals the new ones.
+ */
+void MainWindow::recoverUnsavedEdits() {
+  QString path = this->mapfile->getMapfileName();
+  QList<CommandJournal::Record> records;
+  bool recover = CommandJournal::read(path, records) &&
+    (QMessageBox::question(this, "QMapfileEditor",
+                           tr("%1 has unsaved changes, which have not been "
+                              "saved before QMapfileEditor stopped. Do you want "
+                              "to recover them ?").arg(QFileInfo(path).fileName()),
+                           QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes);
+
+  // the recovered edits are journaled again
+  this->journal->start(path);
+  if (! recover) {
+    return;
+  }
+
+  // the replayed commands are merged as recorded, whatever their timing
+  qint64 interval = ContinuousEdit::getInterval();
+  int replayed = 0;
+  for (; replayed < records.size(); ++replayed) {
+    CommandJournal::Record const & record = records.at(replayed);
+    if (record.kind == CommandJournal::SET_INDEX) {
+      if (record.index > this->undoStack->count()) {
+        break;
+      }
+      this->undoStack->setIndex(record.index);
+    } else if (record.kind == CommandJournal::CLEAR) {
+      this->undoStack->clear();
+    } else {
+      QUndoCommand * command = createJournaledCommand(record.commandId, record.payload, this->mapfile, this);
+      if (! command) {
+        break;
+      }
+      // the command has to be merged (or not) as it was when recorded
+      int index = this->undoStack->index();
+      ContinuousEdit::setInterval((record.kind == CommandJournal::MERGE) ? ContinuousEdit::ALWAYS : 0);
+      this->pushUndoStack(command);
+      if ((this->undoStack->index() == index) != (record.kind == CommandJournal::MERGE)) {
+        break;
+      }
+    }
+  }
+
+  ContinuousEdit::setInterval(interval);
+
+  if (replayed < records.size()) {
+    QMessageBox::warning(this, "QMapfileEditor",
+                         tr("Only part of the unsaved changes could be recovered."));
+  }
+  this->showInfo(tr("Unsaved changes recovered"));
+}
+
+
+/**
+ * Draws the current preview once more, layer by layer, and displays how
+ * long each of them took to be drawn.
+ */
+void MainWindow::profileMapPreview() {
+  if ((! this->mapfile) || (! this->mapfile->isLoaded())) {
+    return;
+  }
+
+  // profiles a copy, the preview extent being applied to it
+  MapfileParser profiled(* this->mapfile);
+  profiled.setMapExtent(this->currentMapMinX, this->currentMapMinY, this->currentMapMaxX, this->currentMapMaxY);
+
+  this->showInfo(tr("Profiling the map preview..."));
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  QList<LayerProfile> profile = profiled.profileCurrentMap(this->ui->mf_preview->viewport()->width(),
+                                                           this->ui->mf_preview->viewport()->height());
+  QApplication::restoreOverrideCursor();
+  this->showInfo("");
+
+  if (! this->profilerDock) {
+    this->profilerDock = new ProfilerDock(this);
+    this->addDockWidget(Qt::LeftDockWidgetArea, this->profilerDock);
+    this->tabifyDockWidget(ui->layersList, this->profilerDock);
+  }
+  this->profilerDock->setProfile(profile);
+  this->profilerDock->show();
+  this->profilerDock->raise();
+}
+
+void MainWindow::showLayerTable() {
+  if (! this->layerTableDock) {
+    this->layerTableDock = new LayerTableDock(this);
+    this->layerTableDock->setLayerModel(this->layerModel);
+    this->addDockWidget(Qt::LeftDockWidgetArea, this->layerTableDock);
+    this->tabifyDockWidget(ui->layersList, this->layerTableDock);
+  }
+  this->layerTableDock->show();
+  this->layerTableDock->raise();
+}
+
+/**
+ * Asks for the preview to be refreshed, along with the other requests made
+ * within the same frame (see RefreshScheduler).
+ */
+void MainWindow::scheduleMapPreview(void) {
+  this->previewScheduler->schedule();
+}
+
+RefreshScheduler * MainWindow::getPreviewScheduler() const {
+  return this->previewScheduler;
+}
 
 void MainWindow::updateMapPreview(void) {
+  // the pending refreshes are now useless
+  this->previewScheduler->performed();
+  this->refreshStats->setText(tr("Preview refreshes: %1 requested, %2 saved")
+                             .arg(this->previewScheduler->getRequestCount())
+                             .arg(this->previewScheduler->getSavedCount()));
+
   this->ui->mf_preview->setSceneRect(0,0,this->ui->mf_preview->viewport()->width(),
                                      this->ui->mf_preview->viewport()->height());
-  int w = this->ui->mf_preview->frameSize().width(),
-      h = this->ui->mf_preview->frameSize().height();
+  int w = this->ui->mf_preview->viewport()->width(),
+      h = this->ui->mf_preview->viewport()->height();
   this->updateMapPreview(w, h);
 }
 
 void MainWindow::updateMapPreview(const int & w, const int &h) {
-  // re-init map preview
+  if ((! this->mapfile) || (! this->mapfile->isLoaded()) || (w <= 0) || (h <= 0)) {
+    return;
+  }
+
+  // fits the current extent to the viewport (as msAdjustExtent() would do),
+  // so that the scene coordinates are linearly bound to the map ones.
+  double resolution = qMax((this->currentMapMaxX - this->currentMapMinX) / w,
+                           (this->currentMapMaxY - this->currentMapMinY) / h);
+  if (resolution <= 0) {
+    return;
+  }
+  double centerx = (this->currentMapMaxX + this->currentMapMinX) / 2,
+         centery = (this->currentMapMaxY + this->currentMapMinY) / 2;
+
+  this->currentMapMinX = centerx - w * resolution / 2;
+  this->currentMapMaxX = centerx + w * resolution / 2;
+  this->currentMapMinY = centery - h * resolution / 2;
+  this->currentMapMaxY = centery + h * resolution / 2;
+  this->previewResolution = resolution;
+
+  // the renderer works on its own copy of the mapfile, which has to be
+  // refreshed if the mapfile has been modified since the last render.
+  if (this->rendererMapfileOutdated) {
+    this->renderer->setMapfile(new MapfileParser(* this->mapfile));
+    this->rendererMapfileOutdated = false;
+  }
+
   this->ui->mf_preview->scene()->clear();
-  // rendering the map
-  QPixmap mapRepr = QPixmap();
 
-  // Temporarily hack the map extent
-  double tmpMinx, tmpMiny, tmpMaxx, tmpMaxy;
-  tmpMinx = this->mapfile->getMapExtentMinX();
-  tmpMiny = this->mapfile->getMapExtentMinY();
-  tmpMaxx = this->mapfile->getMapExtentMaxX();
-  tmpMaxy = this->mapfile->getMapExtentMaxY();
+  quint64 revision = this->mapfile->getRevision();
+  QList<MapTile> toRender;
+  bool labelsMissing = false;
+
+  if (this->mapfile->getAngle() != 0) {
+    // a rotated map cannot be stitched from tiles: the whole viewport is
+    // drawn at once instead (and not cached).
+    MapTile viewport;
+    viewport.key = TileKey(TileKey::VIEWPORT, 0, 0, revision);
+    viewport.minx = this->currentMapMinX;
+    viewport.miny = this->currentMapMinY;
+    viewport.maxx = this->currentMapMaxX;
+    viewport.maxy = this->currentMapMaxY;
+    viewport.width  = w;
+    viewport.height = h;
+    this->previewZoom = TileKey::VIEWPORT;
+    toRender << viewport;
+  } else {
+    this->previewZoom = this->tilePyramid.getZoomLevel(resolution);
+    this->updatePreviewLayers();
+    quint64 renderRevision = this->mapfile->getRenderRevision();
+    QSet<TileKey> coarserTiles;
+
+    QRect range = this->tilePyramid.getTileRange(this->previewZoom,
+                                                 this->currentMapMinX, this->currentMapMinY,
+                                                 this->currentMapMaxX, this->currentMapMaxY);
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+      for (int x = range.left(); x <= range.right(); ++x) {
+        MapTile tile = this->tilePyramid.getTile(this->previewZoom, x, y, this->previewRevision);
+        QPixmap * cached = this->tileCache.object(tile.key);
+        if (cached) {
+          this->addTileToScene(tile, * cached);
+          continue;
+        }
+        if (this->compositeTile(tile)) {
+          continue;
+        }
+        // meanwhile, shows a coarser tile drawn from the same mapfile, if any
+        for (int d = 1; d <= 3; ++d) {
+          MapTile coarser = this->tilePyramid.getTile(this->previewZoom - d,
+                                                      (int) std::floor(x / (double) (1 << d)),
+                                                      (int) std::floor(y / (double) (1 << d)),
+                                                      this->previewRevision);
+          if (coarserTiles.contains(coarser.key)) {
+            break;
+          }
+          QPixmap * coarserPixmap = this->tileCache.object(coarser.key);
+          if (coarserPixmap) {
+            this->addTileToScene(coarser, * coarserPixmap)->setZValue(-d);
+            coarserTiles.insert(coarser.key);
+            break;
+          }
+        }
+        // asks for the drawings of the layers which are still missing
+        for (int i = 0; i < this->previewLayers.size(); ++i) {
+          MapTile layerTile = this->tilePyramid.getTile(this->previewZoom, x, y, renderRevision);
+          if (this->layerTileCache.contains(LayerTileKey(layerTile.key, this->previewStamps[i]))) {
+            continue;
+          }
+          layerTile.layer = this->previewLayers[i];
+          layerTile.stamp = this->previewStamps[i];
+          toRender << layerTile;
+        }
+      }
+    }
+
+    // the labels depend on every layer, as well as on the view
+    if (this->mapfile->hasLabels()) {
+      MapTile labels;
+      labels.key = TileKey(TileKey::LABELS, 0, 0, revision);
+      labels.minx = this->currentMapMinX;
+      labels.miny = this->currentMapMinY;
+      labels.maxx = this->currentMapMaxX;
+      labels.maxy = this->currentMapMaxY;
+      labels.width  = w;
+      labels.height = h;
+      labels.layer  = MapTile::LABELS;
+      if ((! this->previewLabelsPixmap.isNull()) && (this->previewLabels.key == labels.key)
+          && (this->previewLabels.minx == labels.minx) && (this->previewLabels.maxy == labels.maxy)
+          && (this->previewLabels.width == w) && (this->previewLabels.height == h)) {
+        this->addTileToScene(labels, this->previewLabelsPixmap)->setZValue(1);
+      } else {
+        toRender << labels;
+        labelsMissing = true;
+      }
+    }
+  }
+
+  // progressive mode: a quick draft of the whole viewport is drawn first,
+  // then covered by the tiles as they come.
+  if ((toRender.size() > (labelsMissing ? 1 : 0)) && this->ui->actionProgressivePreview->isChecked()) {
+    MapTile draft;
+    draft.key = TileKey(TileKey::DRAFT, 0, 0, revision);
+    draft.minx = this->currentMapMinX;
+    draft.miny = this->currentMapMinY;
+    draft.maxx = this->currentMapMaxX;
+    draft.maxy = this->currentMapMaxY;
+    draft.width  = w;
+    draft.height = h;
+    toRender.prepend(draft);
+  }
+
+  // missing tiles are notified back by the renderer (see tileRendered())
+  this->renderer->render(toRender);
+}
+
+void MainWindow::tileRendered(MapTile tile, QImage image) {
+  if (tile.layer >= 0) {
+    // null images stand for blank drawings
+    this->layerTileCache.insert(LayerTileKey(tile.key, tile.stamp), new QImage(image),
+                                qMax(1, image.bytesPerLine() * image.height() / 1024));
+
+    // drawn from an outdated mapfile, or no longer part of the preview
+    if ((tile.key.revision != this->mapfile->getRenderRevision()) || (tile.key.zoom != this->previewZoom)
+        || (! this->previewStamps.contains(tile.stamp))) {
+      return;
+    }
+  } else if (image.isNull()) {
+    return;
+  }
+
+  // drawn from an outdated mapfile, or no longer in view
+  bool wholeViewport = (tile.key.zoom == TileKey::VIEWPORT) || (tile.key.zoom == TileKey::DRAFT)
+    || (tile.key.zoom == TileKey::LABELS);
+  if (wholeViewport && (tile.key.revision != this->mapfile->getRevision())) {
+    return;
+  }
+  if ((tile.key.zoom != this->previewZoom) && (tile.key.zoom != TileKey::DRAFT) && (tile.key.zoom != TileKey::LABELS)) {
+    return;
+  }
+  if ((tile.maxx <= this->currentMapMinX) || (tile.minx >= this->currentMapMaxX)
+      || (tile.maxy <= this->currentMapMinY) || (tile.miny >= this->currentMapMaxY)) {
+    return;
+  }
 
-  this->mapfile->setMapExtent(this->currentMapMinX, this->currentMapMinY, this->currentMapMaxX, this->currentMapMaxY);
+  if (wholeViewport) {
+    if ((tile.minx == this->currentMapMinX) && (tile.maxy == this->currentMapMaxY)) {
+      QPixmap pixmap = QPixmap::fromImage(image);
+      QGraphicsPixmapItem * item = this->addTileToScene(tile, pixmap);
+      // drafts are only visible where nothing better has been drawn yet
+      if (tile.key.zoom == TileKey::DRAFT) {
+        item->setZValue(-4);
+      } else if (tile.key.zoom == TileKey::LABELS) {
+        item->setZValue(1);
+        this->previewLabels = tile;
+        this->previewLabelsPixmap = pixmap;
+      }
+    }
+    return;
+  }
 
-  // it is mapfileparser's class role to manage the allocated
-  // memory
-  unsigned char * mapImage = this->mapfile->getCurrentMapImage(w, h);
-  int mapImageSize = this->mapfile->getCurrentMapImageSize();
+  // the tile is complete once all its layers have been drawn
+  MapTile composite = this->tilePyramid.getTile(tile.key.zoom, tile.key.x, tile.key.y, this->previewRevision);
+  if (! this->tileCache.contains(composite.key)) {
+    this->compositeTile(composite);
+  }
+}
 
-  // Then restores the original map extent
- this->mapfile->setMapExtent(tmpMinx, tmpMiny, tmpMaxx, tmpMaxy);
+/**
+ * Lists the layers of the preview (in drawing order, except the disabled
+ * ones), along with the stamps identifying their drawings, and computes the
+ * revision identifying the composited tiles.
+ */
+void MainWindow::updatePreviewLayers() {
+  QList<int> order = this->mapfile->getLayerOrder();
+
+  // the layers with REQUIRES / LABELREQUIRES expressions also depend on the
+  // status of the other ones, which only change through their (revisioned)
+  // wrappers.
+  quint64 layersRevision = this->mapfile->getLayersRevision();
+
+  this->previewLayers.clear();
+  this->previewStamps.clear();
+
+  // FNV-like mix of everything the composition depends on
+  const quint64 prime = Q_UINT64_C(0x100000001b3);
+  quint64 revision = (Q_UINT64_C(0xcbf29ce484222325) ^ this->mapfile->getRenderRevision()) * prime;
+  revision = (revision ^ this->mapfile->getImageColor().rgba()) * prime;
+
+  for (int i = 0; i < order.size(); ++i) {
+    int status = this->mapfile->getLayerStatus(order[i]);
+    if ((status == -1) || (status == MS_OFF)) {
+      continue;
+    }
+    quint64 stamp = this->mapfile->getLayerRenderStamp(order[i]);
+    if (this->mapfile->layerRequiresOthers(order[i])) {
+      stamp = (((Q_UINT64_C(0xcbf29ce484222325) ^ stamp) * prime) ^ layersRevision) * prime;
+    }
+    this->previewLayers << order[i];
+    this->previewStamps << stamp;
 
-  mapRepr.loadFromData(mapImage, mapImageSize);
-  this->ui->mf_preview->scene()->addPixmap(mapRepr);
+    revision = (revision ^ stamp) * prime;
+    revision = (revision ^ (quint64) this->mapfile->getLayerOpacity(order[i])) * prime;
+  }
+  this->previewRevision = revision;
+}
+
+/**
+ * Composites a tile of the preview from the drawings of its layers, then
+ * caches and displays it. Returns false if some of the drawings are still
+ * missing.
+ */
+bool MainWindow::compositeTile(MapTile const & tile) {
+  TileKey layerKey(tile.key.zoom, tile.key.x, tile.key.y, this->mapfile->getRenderRevision());
+  QList<QImage *> drawings;
+
+  for (int i = 0; i < this->previewStamps.size(); ++i) {
+    QImage * drawing = this->layerTileCache.object(LayerTileKey(layerKey, this->previewStamps[i]));
+    if (! drawing) {
+      return false;
+    }
+    drawings << drawing;
+  }
+
+  QImage composite(tile.width, tile.height, QImage::Format_ARGB32_Premultiplied);
+  QColor background = this->mapfile->getImageColor();
+
+  QPainter painter(& composite);
+  painter.setCompositionMode(QPainter::CompositionMode_Source);
+  painter.fillRect(composite.rect(), background.isValid() ? background : QColor(Qt::white));
+  painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+  for (int i = 0; i < drawings.size(); ++i) {
+    if (drawings[i]->isNull()) {
+      continue;
+    }
+    int opacity = this->mapfile->getLayerOpacity(this->previewLayers[i]);
+    painter.setOpacity(((opacity >= 0) && (opacity < 100)) ? opacity / 100.0 : 1.0);
+    painter.drawImage(0, 0, * drawings[i]);
+  }
+  painter.end();
+
+  QPixmap pixmap = QPixmap::fromImage(composite);
+  this->tileCache.insert(tile.key, new QPixmap(pixmap), pixmap.width() * pixmap.height() * 4 / 1024);
+  this->addTileToScene(tile, pixmap);
+
+  return true;
+}
+
+/**
+ * Places a tile into the scene, given the current preview extent (the pixmap
+ * is stretched over the extent of the tile if needed).
+ */
+QGraphicsPixmapItem * MainWindow::addTileToScene(MapTile const & tile, QPixmap const & pixmap) {
+  QGraphicsPixmapItem * item = this->ui->mf_preview->scene()->addPixmap(pixmap);
+
+  item->setPos((tile.minx - this->currentMapMinX) / this->previewResolution,
+               (this->currentMapMaxY - tile.maxy) / this->previewResolution);
+
+  double scale = ((tile.maxx - tile.minx) / pixmap.width()) / this->previewResolution;
+  if (scale != 1.0) {
+    item->setTransformationMode(Qt::SmoothTransformation);
+    item->setScale(scale);
+  }
+  return item;
+}
+
+/**
+ * Drops the tiles of the previous mapfile, and bases the pyramid on the
+ * extent of the current one.
+ */
+void MainWindow::resetPreviewTiles() {
+  this->tileCache.clear();
+  this->layerTileCache.clear();
+  this->previewLayers.clear();
+  this->previewStamps.clear();
+  this->previewLabelsPixmap = QPixmap();
+  this->tilePyramid = TilePyramid(this->mapfile->getMapExtentMinX(), this->mapfile->getMapExtentMinY(),
+                                  this->mapfile->getMapExtentMaxX(), this->mapfile->getMapExtentMaxY());
 }
 
 /**
@@ -458,11 +1057,10 @@ void MainWindow::addLayerTriggered(bool isRaster) {
   // the pivot used between our Qt model and Mapserver is the name (char *)
   // to create a new layer, we need to ensure the name is not taken yet.
 
-  this->undoStack->push(new AddLayerCommand(newLayerName, isRaster, this));
+  this->pushUndoStack(new AddLayerCommand(newLayerName, isRaster, this));
 
   // refreshes the layerModel
-  QList<Layer *> ls = this->mapfile->getLayers();
-  this->layerModel->setLayers(ls);
+  this->layerModel->setMapfile(this->mapfile);
 }
 
 void MainWindow::removeLayerTriggered() {
@@ -471,22 +1069,17 @@ void MainWindow::removeLayerTriggered() {
     return;
   }
   QModelIndex idx = this->ui->mf_structure->currentIndex();
-  if ((idx.row() > this->mapfile->getLayers().length()) || (idx.row() < 0)) {
-    return;
-  }
-
-  Layer * toRemove = this->mapfile->getLayers().at(idx.row());
+  Layer * toRemove = this->mapfile->getLayer(idx.row());
   if (! toRemove) {
     return;
   }
 
   //this->mapfile->removeLayer(toRemove);
-  this->undoStack->push(new RemoveLayerCommand(toRemove, this));
+  this->pushUndoStack(new RemoveLayerCommand(toRemove, this));
 
   //refresh
-  QList<Layer *> ls = this->mapfile->getLayers();
-  this->layerModel->setLayers(ls);
-  this->updateMapPreview();
+  this->layerModel->setMapfile(this->mapfile);
+  this->scheduleMapPreview();
 }
 
 void MainWindow::showLayerSettings(const QModelIndex &i) {
@@ -509,10 +1102,9 @@ void MainWindow::showLayerSettings(const QModelIndex &i) {
   //TODO: if layer is vector (ie TYPE = POINT, LINE or POLYGON and have no grid object) then:
   //this->showInfo(QString::number(i.model()->data(Qt::DisplayRole)));
   //qDebug() << i.row();
-  if ((i.row() > this->mapfile->getLayers().length()) || (i.row() < 0))
+  Layer * l = this->mapfile->getLayer(i.row());
+  if (! l)
     return;
-
-  Layer * l = this->mapfile->getLayers().at(i.row());
   LayerSettings * ls = NULL;
   if (l->getType() == "MS_LAYER_RASTER") {
     this->layerSettingsDialog->setWindowTitle(tr("Raster Layer Settings"));
@@ -560,11 +1152,32 @@ void MainWindow::saveMapfile()
     if (this->mapfile->isNew()) {
       this->saveAsMapfile();
     } else {
-      this->mapfile->saveMapfile(QString());
+      // the files are serialized right away, and written in background
+      QHash<QString, QByteArray> files;
+      bool preserveLayout = ui->actionPreserveLayout->isChecked();
+      if ((! preserveLayout) || (! this->mapfile->getPatchedFiles(files))) {
+        // the included files would be merged into the mapfile
+        if (preserveLayout && this->mapfile->hasIncludes() &&
+            (QMessageBox::question(this, "QMapfileEditor",
+                                   tr("These changes cannot be saved into the files they come "
+                                      "from. Do you want to save the whole mapfile into %1, "
+                                      "without its INCLUDEs ?").arg(QFileInfo(this->mapfile->getMapfileName()).fileName()),
+                                   QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes)) {
+          return;
+        }
+        if (! this->mapfile->getFilesToSave(files, false)) {
+          QMessageBox::critical(this, "QMapfileEditor", tr("Error occured while saving the mapfile."));
+          return;
+        }
+      }
+      // the saved state, from which the journal starts over once written
+      if (! files.isEmpty()) {
+        this->savingIndex = this->undoStack->index();
+        this->savingCommand = (this->savingIndex > 0) ? this->undoStack->command(this->savingIndex - 1) : NULL;
+        this->savingLost = false;
+      }
+      this->writeFiles(files);
     }
-    //we know the mapfile filename:
-    this->mapfile->saveMapfile(this->mapfiledir.path()+ "/" + this->mapfilename);
-    ui->actionSave->setEnabled(false);
   }
 }
 
@@ -577,11 +1190,88 @@ void MainWindow::saveAsMapfile()
     if (fileName.isEmpty()) {
       return;
     }
-    if (! this->mapfile->saveMapfile(fileName)) {
-      QMessageBox::critical(this, "QMapfileEditor", tr("Error occured while saving the mapfile."));
+    this->saveMapfileTo(fileName);
+    return;
+  }
+}
+
+/**
+ * The text is serialized right away, and written in background.
+ */
+void MainWindow::saveMapfileTo(QString const & path)
+{
+  QByteArray text = this->mapfile->getMapfileText();
+  if (text.isEmpty()) {
+    QMessageBox::critical(this, "QMapfileEditor", tr("Error occured while saving the mapfile."));
+    return;
+  }
+  QHash<QString, QByteArray> files;
+  files.insert(path, text);
+  this->writeFiles(files);
+}
+
+void MainWindow::writeFiles(QHash<QString, QByteArray> const & files)
+{
+  ui->actionSave->setEnabled(false);
+  if (files.isEmpty()) {
+    this->showInfo(tr("No changes to save"));
+    return;
+  }
+
+  if (! this->saver) {
+    this->saver = new MapfileSaver(this);
+    this->connect(this->saver, SIGNAL(saved(QString, bool)), SLOT(mapfileSaved(QString, bool)));
+  }
+  // a new batch, unless the previous one is still being written
+  if (this->saver->getPendingCount() == 0) {
+    this->batchFailed = false;
+  }
+  for (QHash<QString, QByteArray>::const_iterator it = files.constBegin(); it != files.constEnd(); ++it) {
+    this->saver->save(it.key(), it.value());
+  }
+  this->showInfo(tr("Saving %n file(s)...", "", files.size()));
+}
+
+void MainWindow::mapfileSaved(QString path, bool success)
+{
+  if (! success) {
+    // the other files of the batch may have been written: the files no
+    // longer match what the parser took as saved
+    this->batchFailed = true;
+    this->savingIndex = -1;
+    this->mapfile->setSaveFailed();
+    ui->actionSave->setEnabled(true);
+    QMessageBox::critical(this, "QMapfileEditor", tr("Error occured while saving the mapfile %1.").arg(path));
+    return;
+  }
+  if ((this->saver->getPendingCount() == 0) && (! this->batchFailed)) {
+    this->mapfile->setSaveSucceeded();
+    if (this->savingIndex != -1) {
+      this->markSaved();
     }
+  }
+  this->showInfo(tr("%1 saved").arg(QFileInfo(path).fileName()));
+}
+
+/**
+ * Marks the state of the undo stack the files have been written from as the
+ * clean one, and starts the journal over from there.
+ */
+void MainWindow::markSaved() {
+  int saved = this->savingIndex;
+  this->savingIndex = -1;
+  // the history may have been undone and branched off meanwhile, or rebuilt
+  if (this->savingLost || (saved > this->undoStack->count()) ||
+      (((saved > 0) ? this->undoStack->command(saved - 1) : NULL) != this->savingCommand)) {
+    this->journal->suspend();
     return;
   }
+  // around the edits made while writing
+  int index = this->undoStack->index();
+  this->undoStack->setIndex(saved);
+  this->undoStack->setClean();
+  this->undoStack->setIndex(index);
+  this->journal->reset();
 }
 
 void MainWindow::showInfo(const QString & message)
@@ -594,22 +1284,22 @@ void MainWindow::showInfo(const QString & message)
 // Layer-related commands
 void MainWindow::addLayer(const QString &layerName, bool isRaster) {
  mapfile->addLayer(layerName, isRaster);
- this->layerModel->setLayers(this->mapfile->getLayers());
+ this->layerModel->setMapfile(this->mapfile);
 }
 
 void MainWindow::addLayer(const Layer *l) {
   mapfile->addLayer(l);
-  this->layerModel->setLayers(this->mapfile->getLayers());
+  this->layerModel->setMapfile(this->mapfile);
 }
 
 void MainWindow::removeLayer(const QString &layerName) {
   mapfile->removeLayer(layerName);
-  this->layerModel->setLayers(this->mapfile->getLayers());
+  this->layerModel->setMapfile(this->mapfile);
 }
 
 void MainWindow::removeLayer(const Layer *l) {
   mapfile->removeLayer(l);
-  this->layerModel->setLayers(this->mapfile->getLayers());
+  this->layerModel->setMapfile(this->mapfile);
 }
 
 QUndoStack *  MainWindow::getUndoStack() const {
@@ -618,6 +1308,15 @@ QUndoStack *  MainWindow::getUndoStack() const {
 
 MainWindow::~MainWindow()
 {
+  // stops the renderer thread before releasing the mapfile
+  delete this->renderer;
+  // same for the loading one, if any
+  delete this->loader;
+  // waits for the pending saves
+  delete this->saver;
+  // the edits left unsaved are given up
+  this->journal->discard();
+
   if (this->mapfile) {
     delete this->mapfile;
   }
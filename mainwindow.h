@@ -32,27 +32,42 @@
 #include <iostream>
 #include <cmath>
 
+#include <QCache>
 #include <QDir>
 #include <QFileDialog>
+#include <QGraphicsPixmapItem>
 #include <QGraphicsScene>
 #include <QLabel>
 #include <QMainWindow>
 #include <QMessageBox>
+#include <QPainter>
 #include <QDialogButtonBox>
 #include <QPixmap>
+#include <QProgressBar>
 #include <QResizeEvent>
+#include <QSet>
 #include <QStandardItem>
 #include <QStandardItemModel>
 #include <QStringListModel>
+#include <QToolButton>
 #include <QUndoStack>
 #include <QUndoView>
 
+#include "mapfileloader.h"
+#include "mapfilesaver.h"
 #include "mapscene.h"
+#include "maprenderer.h"
+#include "refreshscheduler.h"
+#include "profilerdock.h"
+#include "layertabledock.h"
 #include "mapsettings.h"
 #include "fontsettings.h"
 #include "layersettingsvector.h"
 #include "layersettingsraster.h"
+#include "commands/commandjournal.h"
+#include "commands/continuousedit.h"
 #include "commands/layercommands.h"
+#include "commands/undobudget.h"
 #include "parser/mapfileparser.h"
 #include "parser/layer.h"
 
@@ -83,27 +98,39 @@ class MainWindow : public QMainWindow
       void addLayer(const Layer *);
 
       QUndoStack * getUndoStack() const;
+      RefreshScheduler * getPreviewScheduler() const;
 
       ~MainWindow();
 
  public slots:
       void addLayerVectorTriggered();
       void addLayerRasterTriggered();
+      void cancelMapfileLoading();
       void handleUndoStackChanged(int);
+      void mapfileLoaded();
+      void mapfileLoadingProgress(qint64, int);
+      void mapfileParsing();
+      void mapfileSaved(QString, bool);
+      void mapfileSnapshotLoaded(MapfileSnapshot);
+      void tileRendered(MapTile, QImage);
+      void scheduleMapPreview();
       void openMapfile();
       void newMapfile();
       void panPreview(qreal,qreal);
       void panToggled(bool);
+      void profileMapPreview();
       void removeLayerTriggered();
       void saveMapfile();
       void saveAsMapfile();
       void showAbout();
       void showInfo(const QString & message);
+      void showLayerTable();
       void showLayerSettings(const QModelIndex &);
       void showLayerSettings(void);
       void showMapSettings();
       void showFontSettings();
       void showUndoStack();
+      void undoHistoryCollapsed(int);
       void updateMapPreview(void);
       void zoomMapPreview(QRectF);
       void zoomOutMapPreview();
@@ -117,6 +144,71 @@ class MainWindow : public QMainWindow
 
       MapfileParser * mapfile = NULL;
 
+      // Loads the mapfile being opened in background, the current one
+      // remaining in place until it is done.
+      MapfileLoader * loader = NULL;
+      // writes the mapfiles in background
+      MapfileSaver * saver = NULL;
+      // some of the files being written could not be saved
+      bool batchFailed = false;
+      // state of the undo stack the files being written come from (index
+      // and command on top), marked clean once they all are written; -1 if
+      // none
+      int savingIndex = -1;
+      QUndoCommand const * savingCommand = NULL;
+      // the history has been rebuilt meanwhile, losing that state
+      bool savingLost = false;
+      void markSaved();
+      void saveMapfileTo(QString const &);
+      void writeFiles(QHash<QString, QByteArray> const &);
+      QProgressBar * loadingProgress;
+      QToolButton * loadingCancel;
+      // layers tree of the mapfile being loaded, from its cached snapshot
+      QStandardItemModel * snapshotModel;
+      void showLayerModel();
+
+      // Renders the map preview in background, using its own copy of
+      // the mapfile, which needs to be refreshed each time the mapfile
+      // is modified.
+      MapRenderer * renderer;
+      bool rendererMapfileOutdated;
+
+      // Coalesces the refreshes of the preview asked for in a row (e.g. by
+      // several commands being pushed at once).
+      RefreshScheduler * previewScheduler;
+      QLabel * refreshStats;
+
+      // The preview is made of tiles (see maptiles.h), which are kept
+      // in a LRU cache, so that only the tiles coming into view need
+      // to be drawn when panning.
+      TilePyramid tilePyramid;
+      QCache<TileKey, QPixmap> tileCache;
+      int previewZoom;
+      double previewResolution;
+
+      // Each layer is drawn separately, then the tiles are composited from
+      // these drawings, so that modifying a layer only requires to draw this
+      // one again (and changing its opacity or status, none of them).
+      QCache<LayerTileKey, QImage> layerTileCache;
+      QList<int> previewLayers;
+      QList<quint64> previewStamps;
+      quint64 previewRevision;
+      // the labels avoid each other over the whole view: they are drawn at
+      // once over the composited tiles, the last drawing being kept
+      MapTile previewLabels;
+      QPixmap previewLabelsPixmap;
+
+      QGraphicsPixmapItem * addTileToScene(MapTile const &, QPixmap const &);
+      bool compositeTile(MapTile const &);
+      void updatePreviewLayers();
+      void resetPreviewTiles();
+
+      // rendering statistics of the layers
+      ProfilerDock * profilerDock = NULL;
+
+      // sortable table of the layers
+      LayerTableDock * layerTableDock = NULL;
+
       // Dialog which handles the mapfile settings
       MapSettings * settings = NULL;
       FontSettings * fontSettings = NULL;
@@ -124,11 +216,17 @@ class MainWindow : public QMainWindow
       QDialogButtonBox *buttonBox;
 
       QUndoStack * undoStack;
+      // keeps the memory used by the undo stack bounded
+      UndoBudget * undoBudget;
+      // unsaved edits, recovered after a crash
+      CommandJournal * journal;
       QUndoView  * undoView = NULL;
 
       void addLayerTriggered(bool);
       // internal methods
+      void closeMapfile();
       void reinitMapfile();
+      void recoverUnsavedEdits();
       void updateMapPreview(const int &, const int &);
       QMessageBox::StandardButton warnIfActiveSession(void);
 
@@ -0,0 +1,162 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QSet>
+#include <QStringList>
+
+#include "mapfileloader.h"
+
+MapfileLoader::MapfileLoader(QString const & filename, QObject * parent) : QThread(parent),
+    filename(filename), cancelled(0), parser(NULL) {
+  qRegisterMetaType<MapfileSnapshot>("MapfileSnapshot");
+}
+
+MapfileLoader::~MapfileLoader() {
+  cancel();
+  wait();
+  delete parser;
+}
+
+QString const & MapfileLoader::getFilename() const {
+  return filename;
+}
+
+/**
+ * Gives the hash of the content of the include tree, once it is scanned.
+ */
+QByteArray const & MapfileLoader::getContentHash() const {
+  return contentHash;
+}
+
+void MapfileLoader::setSnapshotCache(SnapshotCache const & cache) {
+  snapshotCache = cache;
+}
+
+void MapfileLoader::cancel() {
+  cancelled.fetchAndStoreOrdered(1);
+}
+
+bool MapfileLoader::isCancelled() const {
+  return (int) cancelled != 0;
+}
+
+/**
+ * Gives the loaded parser (the caller takes its ownership), NULL if the
+ * loading has been cancelled. This waits for the thread to be finished.
+ */
+MapfileParser * MapfileLoader::takeParser() {
+  wait();
+  MapfileParser * ret = parser;
+  parser = NULL;
+  return ret;
+}
+
+QByteArray MapfileLoader::computeContentHash(QString const & filename) {
+  return scanIncludes(filename, NULL);
+}
+
+void MapfileLoader::run() {
+  contentHash = scanIncludes(filename, this);
+  if (isCancelled()) {
+    return;
+  }
+
+  MapfileSnapshot snapshot;
+  bool cached = snapshotCache.load(contentHash, snapshot);
+  if (cached) {
+    emit snapshotLoaded(snapshot);
+  }
+
+  emit parsing();
+  MapfileParser * loaded = new MapfileParser(filename);
+
+  if (isCancelled()) {
+    delete loaded;
+    return;
+  }
+  if ((! cached) && (loaded->isLoaded())) {
+    snapshotCache.store(contentHash, loaded->getSnapshot());
+  }
+  loaded->enableIncrementalSave();
+  parser = loaded;
+}
+
+/**
+ * Walks through the files referenced by the mapfile, hashing them. As in
+ * msLoadMap(), the relative paths are resolved from the directory of the
+ * mapfile. The progress is reported by the given loader, if any, which can
+ * also cancel the scan.
+ */
+QByteArray MapfileLoader::scanIncludes(QString const & filename, MapfileLoader * loader) {
+  QDir base = QFileInfo(filename).absoluteDir();
+  QRegExp reference("^\\s*(INCLUDE|SYMBOLSET|FONTSET)\\s+[\"']([^\"']+)[\"']", Qt::CaseInsensitive);
+
+  QStringList pending(QFileInfo(filename).absoluteFilePath());
+  QSet<QString> scanned;
+  qint64 bytesRead = 0;
+  int includesResolved = 0;
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+
+  while ((! pending.isEmpty()) && (! (loader && loader->isCancelled()))) {
+    QString path = QFileInfo(pending.takeFirst()).canonicalFilePath();
+    if (path.isEmpty() || scanned.contains(path)) {
+      continue;
+    }
+    scanned << path;
+
+    QFile file(path);
+    if (! file.open(QIODevice::ReadOnly)) {
+      continue;
+    }
+    if (scanned.size() > 1) {
+      ++includesResolved;
+    }
+    hash.addData(path.toUtf8());
+
+    int lines = 0;
+    while ((! file.atEnd()) && (! (loader && loader->isCancelled()))) {
+      QByteArray line = file.readLine();
+      bytesRead += line.size();
+      hash.addData(line);
+      if (reference.indexIn(QString::fromLocal8Bit(line)) != -1) {
+        pending << base.absoluteFilePath(reference.cap(2));
+      }
+      if (((++lines % 4096) == 0) && loader) {
+        emit loader->progress(bytesRead, includesResolved);
+      }
+    }
+    if (loader) {
+      emit loader->progress(bytesRead, includesResolved);
+    }
+  }
+  return hash.result();
+}
@@ -0,0 +1,106 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#ifndef MAPFILELOADER_H
+#define MAPFILELOADER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QMetaType>
+#include <QString>
+#include <QThread>
+
+#include "parser/mapfileparser.h"
+#include "parser/mapfilesnapshot.h"
+
+Q_DECLARE_METATYPE(MapfileSnapshot)
+
+/**
+ * Loads a mapfile into a worker thread, so that the GUI keeps on being
+ * responsive while msLoadMap() resolves the INCLUDEs and parses everything.
+ *
+ * The include tree (INCLUDE, SYMBOLSET and FONTSET files) is first scanned,
+ * reporting the progress along the way. Besides giving some feedback, this
+ * also brings the files into the system cache, which is what takes time on
+ * remote filesystems. The mapfile is then parsed by msLoadMap().
+ *
+ * The files of the include tree are hashed while scanned. If a snapshot of
+ * the same content is cached (see SnapshotCache), it is given right away by
+ * snapshotLoaded(), before the parsing starts; otherwise a snapshot of the
+ * parsed mapfile is cached for the next time.
+ *
+ * The parsed mapfile is made to track its changes, so that saving it only
+ * rewrites the modified blocks (see MapfileParser::enableIncrementalSave()).
+ *
+ * The loading can be cancelled at any time. msLoadMap() itself cannot be
+ * interrupted, though: a cancellation occuring while parsing only discards
+ * the result.
+ *
+ * Once the thread is finished, the parser is given by takeParser().
+ */
+class MapfileLoader : public QThread {
+
+ Q_OBJECT
+
+ public:
+  MapfileLoader(QString const & filename, QObject * parent = 0);
+  ~MapfileLoader();
+
+  QString const & getFilename() const;
+  QByteArray const & getContentHash() const;
+  void setSnapshotCache(SnapshotCache const &);
+  void cancel();
+  bool isCancelled() const;
+
+  MapfileParser * takeParser();
+
+  // hash of the files of the include tree, identifying the whole content of
+  // the mapfile (see getContentHash())
+  static QByteArray computeContentHash(QString const & filename);
+
+ signals:
+  // bytes of the include tree scanned so far, and included files found
+  void progress(qint64 bytesRead, int includesResolved);
+  // the scan is over, the mapfile is being parsed
+  void parsing();
+  // the mapfile has been opened before with the same content
+  void snapshotLoaded(MapfileSnapshot);
+
+ protected:
+  void run();
+
+ private:
+  static QByteArray scanIncludes(QString const & filename, MapfileLoader * loader);
+
+  QString filename;
+  QByteArray contentHash;
+  SnapshotCache snapshotCache;
+  QAtomicInt cancelled;
+  MapfileParser * parser;
+};
+
+#endif // MAPFILELOADER_H
@@ -0,0 +1,95 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "mapfilesaver.h"
+#include "parser/mapfileparser.h"
+
+MapfileSaver::MapfileSaver(QObject * parent) : QThread(parent), working(false), coalesced(0) {}
+
+// the pending saves are not given up
+MapfileSaver::~MapfileSaver() {
+  wait();
+}
+
+void MapfileSaver::save(QString const & path, QByteArray const & content) {
+  QString absolutePath = QFileInfo(path).absoluteFilePath();
+  QMutexLocker locker(& this->mutex);
+
+  if (this->pendingContents.contains(absolutePath)) {
+    ++this->coalesced;
+  } else {
+    this->pendingPaths << absolutePath;
+  }
+  this->pendingContents.insert(absolutePath, content);
+
+  if (! this->working) {
+    this->working = true;
+    // the thread may still be returning from run()
+    wait();
+    start();
+  }
+}
+
+// saves waiting to be written, including the one in progress if any
+int MapfileSaver::getPendingCount() const {
+  QMutexLocker locker(& this->mutex);
+  return this->pendingPaths.size() + (this->inFlight.isEmpty() ? 0 : 1);
+}
+
+int MapfileSaver::getCoalescedCount() const {
+  QMutexLocker locker(& this->mutex);
+  return this->coalesced;
+}
+
+void MapfileSaver::run() {
+  forever {
+    QString path;
+    QByteArray content;
+    {
+      QMutexLocker locker(& this->mutex);
+      if (this->pendingPaths.isEmpty()) {
+        this->working = false;
+        return;
+      }
+      // a save of the same file queued from now on is written afterwards
+      path = this->pendingPaths.takeFirst();
+      content = this->pendingContents.take(path);
+      this->inFlight = path;
+    }
+
+    bool success = MapfileParser::replaceFile(path, content);
+
+    {
+      QMutexLocker locker(& this->mutex);
+      this->inFlight.clear();
+    }
+    emit saved(path, success);
+  }
+}
@@ -0,0 +1,77 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#ifndef MAPFILESAVER_H
+#define MAPFILESAVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+/**
+ * Writes mapfiles into a worker thread, so that the GUI is not blocked by
+ * slow (e.g. network) filesystems.
+ *
+ * The text of the mapfile is given by the caller (see
+ * MapfileParser::getMapfileText()), which is fast and avoids sharing the map
+ * object with the worker. Each file is replaced atomically (see
+ * MapfileParser::replaceFile()).
+ *
+ * Saves are done in order. A file which is saved again while a previous
+ * save of it is still waiting is written only once, with the last content.
+ */
+class MapfileSaver : public QThread {
+
+ Q_OBJECT
+
+ public:
+  MapfileSaver(QObject * parent = 0);
+  ~MapfileSaver();
+
+  void save(QString const & path, QByteArray const & content);
+  int getPendingCount() const;
+  int getCoalescedCount() const;
+
+ signals:
+  void saved(QString path, bool success);
+
+ protected:
+  void run();
+
+ private:
+  mutable QMutex mutex;
+  QStringList pendingPaths;
+  QHash<QString, QByteArray> pendingContents;
+  QString inFlight;
+  bool working;
+  int coalesced;
+};
+
+#endif // MAPFILESAVER_H
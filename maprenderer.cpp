@@ -0,0 +1,187 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#include "maprenderer.h"
+
+#include <QMutexLocker>
+
+// tells whether an image is fully transparent (or null)
+static bool isBlank(QImage const & img) {
+  if ((img.format() != QImage::Format_ARGB32)
+      && (img.format() != QImage::Format_ARGB32_Premultiplied)) {
+    return img.isNull();
+  }
+  for (int y = 0; y < img.height(); ++y) {
+    const QRgb * line = (const QRgb *) img.constScanLine(y);
+    for (int x = 0; x < img.width(); ++x) {
+      if (qAlpha(line[x]) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+const int MapRenderer::DRAFT_REDUCTION;
+const int MapRenderer::DRAFT_MAX_FEATURES;
+
+MapRenderer::MapRenderer(QObject * parent, int threadCount): QObject(parent),
+    mapfileSerial(0),
+    abort(false)
+{
+  qRegisterMetaType<MapTile>("MapTile");
+
+  for (int i = 0; i < qMax(1, threadCount); ++i) {
+    MapRenderWorker * worker = new MapRenderWorker(this);
+    workers << worker;
+    worker->start(QThread::LowPriority);
+  }
+}
+
+int MapRenderer::getThreadCount() const {
+  return workers.size();
+}
+
+/**
+ * Gives a new copy of the mapfile to the renderer, which takes the ownership
+ * of it. Each worker clones it again before drawing its next tile.
+ */
+void MapRenderer::setMapfile(MapfileParser * snapshot) {
+  QMutexLocker locker(& mutex);
+  mapfile = QSharedPointer<MapfileParser>(snapshot);
+  ++mapfileSerial;
+}
+
+/**
+ * Asks for the rendering of the given tiles, replacing the ones which are
+ * still pending.
+ */
+void MapRenderer::render(QList<MapTile> const & tiles) {
+  QMutexLocker locker(& mutex);
+
+  pendingTiles = tiles;
+  condition.wakeAll();
+}
+
+/**
+ * Drops the tiles which are still pending.
+ */
+void MapRenderer::cancel() {
+  QMutexLocker locker(& mutex);
+  pendingTiles.clear();
+}
+
+/**
+ * Main loop of the workers: takes the next pending tile, and draws it
+ * using a clone of the mapfile private to the calling thread.
+ */
+void MapRenderer::processTiles() {
+  MapfileParser * clone = NULL;
+  quint64 cloneSerial = 0;
+
+  forever {
+    mutex.lock();
+    while (pendingTiles.isEmpty() && (! abort)) {
+      condition.wait(& mutex);
+    }
+    if (abort) {
+      mutex.unlock();
+      break;
+    }
+    MapTile tile = pendingTiles.takeFirst();
+    QSharedPointer<MapfileParser> source = mapfile;
+    quint64 serial = mapfileSerial;
+    mutex.unlock();
+
+    if (source.isNull()) {
+      continue;
+    }
+
+    // refreshes the private clone if the mapfile has been modified
+    if ((! clone) || (cloneSerial != serial)) {
+      delete clone;
+      QMutexLocker cloneLocker(& cloneMutex);
+      clone = new MapfileParser(* source);
+      cloneSerial = serial;
+    }
+    if (! clone->isLoaded()) {
+      continue;
+    }
+
+    int width = tile.width, height = tile.height;
+    if (tile.key.zoom == TileKey::DRAFT) {
+      width  = qMax(1, width / DRAFT_REDUCTION);
+      height = qMax(1, height / DRAFT_REDUCTION);
+    }
+
+    // mapserver considers the extent as the centers of the edge pixels
+    double resx = (tile.maxx - tile.minx) / width,
+           resy = (tile.maxy - tile.miny) / height;
+
+    clone->setMapExtent(tile.minx + resx / 2, tile.miny + resy / 2,
+                        tile.maxx - resx / 2, tile.maxy - resy / 2);
+
+    QImage img;
+    if (tile.key.zoom == TileKey::DRAFT) {
+      img = clone->getCurrentMapDraftImage(width, height, DRAFT_REDUCTION, DRAFT_MAX_FEATURES);
+    } else if (tile.layer == MapTile::WHOLE_MAP) {
+      img = clone->getCurrentMapRawImage(tile.width, tile.height);
+    } else if (tile.layer == MapTile::LABELS) {
+      img = clone->getLabelsRawImage(tile.width, tile.height);
+    } else {
+      img = clone->getLayerRawImage(tile.layer, tile.width, tile.height);
+      // most of the layers do not cover every tile, there is no need to
+      // keep (nor composite) blank images.
+      if (isBlank(img)) {
+        img = QImage();
+      }
+    }
+
+    emit tileRendered(tile, img);
+  }
+
+  delete clone;
+}
+
+MapRenderer::~MapRenderer() {
+  mutex.lock();
+  abort = true;
+  condition.wakeAll();
+  mutex.unlock();
+
+  for (int i = 0; i < workers.size(); ++i) {
+    workers[i]->wait();
+    delete workers[i];
+  }
+}
+
+MapRenderWorker::MapRenderWorker(MapRenderer * renderer) : renderer(renderer) {}
+
+void MapRenderWorker::run() {
+  renderer->processTiles();
+}
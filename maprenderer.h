@@ -0,0 +1,128 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#ifndef MAPRENDERER_H
+#define MAPRENDERER_H
+
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "maptiles.h"
+#include "parser/mapfileparser.h"
+
+class MapRenderWorker;
+
+/**
+ * Renders the map preview into a pool of worker threads, so that the GUI
+ * keeps on being responsive while msDrawMap() is running, and that the
+ * tiles of the preview are drawn in parallel.
+ *
+ * The renderer is given a copy of the mapfile (see setMapfile()), from which
+ * each worker makes its own private clone (msDrawMap() alters the map object
+ * it draws, so that it cannot be shared). Workers refresh their clone as soon
+ * as a newer copy is given.
+ *
+ * Tiles are drawn from a shared queue. Only the latest requested queue is
+ * taken into account: issuing a new request replaces the tiles which are
+ * still pending, hence the ones which went out of view are never drawn.
+ *
+ * Tiles are drawn either for the whole map, or for a single layer onto a
+ * transparent background (see MapTile), and notified back as soon as they
+ * are drawn. A blank layer drawing is notified as a null image.
+ *
+ * Tiles with a TileKey::DRAFT zoom are drawn as a quick preview, with
+ * DRAFT_REDUCTION times less pixels (and DPI) and a number of features capped
+ * to DRAFT_MAX_FEATURES per layer.
+ *
+ * The keys of the tiles are given by the caller, which is expected to
+ * refresh the copy of the mapfile before asking for tiles drawn from it.
+ *
+ * Note: msDrawMap() itself cannot be interrupted, and this requires a
+ * libmapserver built with thread-safety enabled.
+ */
+class MapRenderer : public QObject {
+
+ Q_OBJECT
+
+ public:
+  MapRenderer(QObject * parent = 0, int threadCount = QThread::idealThreadCount());
+  ~MapRenderer();
+
+  void setMapfile(MapfileParser *);
+  void render(QList<MapTile> const &);
+  void cancel();
+
+  int getThreadCount() const;
+
+  static const int DRAFT_REDUCTION = 4;
+  static const int DRAFT_MAX_FEATURES = 1000;
+
+ signals:
+  void tileRendered(MapTile, QImage);
+
+ private:
+  friend class MapRenderWorker;
+  void processTiles();
+
+  QMutex mutex;
+  QWaitCondition condition;
+
+  // serializes the cloning of the mapfile by the workers
+  QMutex cloneMutex;
+
+  // latest copy of the mapfile, and its serial number (a worker whose
+  // clone has a different serial number has to refresh it).
+  QSharedPointer<MapfileParser> mapfile;
+  quint64 mapfileSerial;
+
+  QList<MapTile> pendingTiles;
+  QList<MapRenderWorker *> workers;
+  bool abort;
+};
+
+/**
+ * Thread of the renderer pool, see MapRenderer::processTiles().
+ */
+class MapRenderWorker : public QThread {
+
+ public:
+  MapRenderWorker(MapRenderer * renderer);
+
+ protected:
+  void run();
+
+ private:
+  MapRenderer * renderer;
+};
+
+#endif // MAPRENDERER_H
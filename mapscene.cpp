@@ -73,6 +73,17 @@ void MapScene::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
                           newy > pointOrig.y() ? pointOrig.y() : newy,
                           nWidth, nHeight);
   }
+  else if ((panning) && (event->buttons() & Qt::LeftButton)) {
+    // moves what is already drawn along with the mouse, the preview is
+    // only updated once the button is released.
+    QPointF delta = event->scenePos() - event->lastScenePos();
+    QList<QGraphicsItem *> drawn = items();
+    for (int i = 0; i < drawn.size(); ++i) {
+      if (! drawn[i]->parentItem()) {
+        drawn[i]->moveBy(delta.x(), delta.y());
+      }
+    }
+  }
 }
 
 void MapScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event) {
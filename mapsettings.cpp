@@ -34,7 +34,7 @@
 #include <QDebug>
 
 MapSettings::MapSettings(MainWindow * parent, MapfileParser * mf) :
-  QDialog(parent), ui(new Ui::MapSettings), mapfile(mf)
+  QDialog(parent), ui(new Ui::MapSettings), mapfile(mf), liveEditIndex(-1)
 {
     ui->setupUi(this);
 
@@ -612,6 +612,14 @@ void MapSettings::enableDebugBox(bool checked) {
 
 void MapSettings::angleSliderChanged(int value) {
     ui->mf_map_angle->setValue(value);
+    // the preview follows the slider while it is dragged, the steps being
+    // merged into one command
+    if (ui->mf_map_angle_slider->isSliderDown() && (this->mapfile->getAngle() != value)) {
+      MainWindow * mw = (MainWindow *) parent();
+      if (this->liveEditIndex == -1)
+        this->liveEditIndex = mw->getUndoStack()->index();
+      mw->pushUndoStack(new SetAngleCommand(value, this->mapfile));
+    }
 }
 void MapSettings::angleSpinChanged(int value) {
     ui->mf_map_angle_slider->setValue(value);
@@ -815,10 +823,23 @@ void MapSettings::enableRelativePathShapepath() {
 
 void MapSettings::accept() {
     this->saveMapSettings();
+    this->liveEditIndex = -1;
     // Refreshes the map view
-    ((MainWindow *) parent())->updateMapPreview();
+    ((MainWindow *) parent())->scheduleMapPreview();
     QDialog::accept();
 }
+
+void MapSettings::reject() {
+    // the changes applied while editing are undone, unless some other
+    // command came on top of them meanwhile
+    QUndoStack * stack = ((MainWindow *) parent())->getUndoStack();
+    while ((this->liveEditIndex != -1) && (stack->index() > this->liveEditIndex) &&
+           (stack->command(stack->index() - 1)->id() == SET_ANGLE_COMMAND)) {
+      stack->undo();
+    }
+    this->liveEditIndex = -1;
+    QDialog::reject();
+}
 void MapSettings::refreshGdalOgrDriverCombo(const QString &s) {
     if ((s == "GDAL") || (s == "OGR")) {
       this->ui->gdaldriver_label->setEnabled(true);
@@ -44,6 +44,7 @@
 #include "keyvaluemodel.h"
 
 #include "commands/changemapnamecommand.h"
+#include "commands/commandids.h"
 #include "commands/changemapstatuscommand.h"
 #include "commands/outputformatcommands.h"
 #include "commands/setanglecommand.h"
@@ -84,6 +85,7 @@ class MapSettings : public QDialog
 
  public slots:
       void accept();
+      void reject();
       void addFormatOption();
       void addNewOutputFormat(void);
       void addOgcMetadata();
@@ -121,6 +123,10 @@ class MapSettings : public QDialog
 
       MapfileParser * mapfile;
 
+      // index of the undo stack before the angle changes applied while
+      // dragging the slider, -1 if none
+      int liveEditIndex;
+
       QDataWidgetMapper * outputFormatsMapper;
 
       void populateDefaultOutputFormatList(void);
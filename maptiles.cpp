@@ -0,0 +1,115 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#include "maptiles.h"
+
+#include <cmath>
+
+TileKey::TileKey(int zoom, int x, int y, quint64 revision) :
+    zoom(zoom), x(x), y(y), revision(revision) {}
+
+bool TileKey::operator==(TileKey const & other) const {
+  return (zoom == other.zoom) && (x == other.x) && (y == other.y)
+      && (revision == other.revision);
+}
+
+uint qHash(TileKey const & key) {
+  return qHash((((quint64) (quint32) key.x) << 32) | (quint32) key.y)
+      ^ qHash(key.zoom) ^ qHash(key.revision);
+}
+
+LayerTileKey::LayerTileKey(TileKey const & tile, quint64 stamp) :
+    tile(tile), stamp(stamp) {}
+
+bool LayerTileKey::operator==(LayerTileKey const & other) const {
+  return (tile == other.tile) && (stamp == other.stamp);
+}
+
+uint qHash(LayerTileKey const & key) {
+  return qHash(key.tile) ^ qHash(key.stamp);
+}
+
+MapTile::MapTile() :
+    minx(0.0), miny(0.0), maxx(0.0), maxy(0.0), width(0), height(0),
+    layer(WHOLE_MAP), stamp(0) {}
+
+TilePyramid::TilePyramid() :
+    originX(0.0), originY(0.0), baseResolution(1.0) {}
+
+TilePyramid::TilePyramid(double minx, double miny, double maxx, double maxy) :
+    originX(minx), originY(maxy)
+{
+  baseResolution = qMax(maxx - minx, maxy - miny) / TILE_SIZE;
+  // e.g. blank mapfile, whose extent is still undefined
+  if (baseResolution <= 0) {
+    originX = originY = 0.0;
+    baseResolution = 1.0;
+  }
+}
+
+/**
+ * Returns the level whose resolution is the closest to the given one
+ * (which might be negative when zooming out beyond the reference extent).
+ */
+int TilePyramid::getZoomLevel(double resolution) const {
+  return (int) std::floor(std::log(baseResolution / resolution) / std::log(2.0) + 0.5);
+}
+
+double TilePyramid::getResolution(int zoom) const {
+  return std::ldexp(baseResolution, -zoom);
+}
+
+/**
+ * Returns the indices of the tiles of a given level covering the extent.
+ */
+QRect TilePyramid::getTileRange(int zoom, double minx, double miny, double maxx, double maxy) const {
+  double tileSpan = TILE_SIZE * getResolution(zoom);
+
+  // upper bounds are exclusive: an edge falling exactly on a tile limit
+  // does not require the next tile.
+  int x1 = (int) std::floor((minx - originX) / tileSpan);
+  int x2 = (int) std::ceil((maxx - originX) / tileSpan) - 1;
+  int y1 = (int) std::floor((originY - maxy) / tileSpan);
+  int y2 = (int) std::ceil((originY - miny) / tileSpan) - 1;
+
+  return QRect(QPoint(x1, y1), QPoint(x2, y2));
+}
+
+MapTile TilePyramid::getTile(int zoom, int x, int y, quint64 revision) const {
+  double tileSpan = TILE_SIZE * getResolution(zoom);
+
+  MapTile ret;
+  ret.key    = TileKey(zoom, x, y, revision);
+  ret.minx   = originX + x * tileSpan;
+  ret.maxx   = ret.minx + tileSpan;
+  ret.maxy   = originY - y * tileSpan;
+  ret.miny   = ret.maxy - tileSpan;
+  ret.width  = TILE_SIZE;
+  ret.height = TILE_SIZE;
+  return ret;
+}
@@ -0,0 +1,125 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#ifndef MAPTILES_H
+#define MAPTILES_H
+
+#include <QHash>
+#include <QMetaType>
+#include <QRect>
+
+/**
+ * Address of a preview tile: position into the zoom pyramid, and revision
+ * of the mapfile (or of the composition of its layers) the tile has been
+ * (or has to be) drawn from.
+ */
+struct TileKey {
+  TileKey(int zoom = 0, int x = 0, int y = 0, quint64 revision = 0);
+
+  int zoom, x, y;
+  quint64 revision;
+
+  // zoom value used for an image which does not belong to the pyramid
+  // (i.e. the whole viewport rendered at once).
+  static const int VIEWPORT = -0x7fff;
+  // same, for a quick draft of the viewport (see MapRenderer)
+  static const int DRAFT = -0x7ffe;
+  // same, for the labels of the viewport, drawn over the tiles
+  static const int LABELS = -0x7ffd;
+
+  bool operator==(TileKey const &) const;
+};
+
+uint qHash(TileKey const &);
+
+/**
+ * Address of the drawing of a single layer onto a preview tile: the tile
+ * revision is the render revision of the mapfile, and the layer is
+ * identified by its render stamp (see Layer::getRenderStamp()).
+ */
+struct LayerTileKey {
+  LayerTileKey(TileKey const & tile = TileKey(), quint64 stamp = 0);
+
+  TileKey tile;
+  quint64 stamp;
+
+  bool operator==(LayerTileKey const &) const;
+};
+
+uint qHash(LayerTileKey const &);
+
+/**
+ * A piece of map to be drawn by the renderer. The extent covers the outer
+ * edges of the pixels (not their centers, as mapserver does).
+ *
+ * Either the whole map is drawn, or a single layer (given by its index
+ * into the mapfile layers, along with the stamp identifying its drawing).
+ */
+struct MapTile {
+  MapTile();
+
+  TileKey key;
+  double minx, miny, maxx, maxy;
+  int width, height;
+
+  int layer;
+  quint64 stamp;
+
+  static const int WHOLE_MAP = -1;
+  // the labels of all the layers (see MapfileParser::getLabelsRawImage())
+  static const int LABELS = -2;
+};
+
+Q_DECLARE_METATYPE(MapTile)
+
+/**
+ * Fixed-size tiles organized on a zoom pyramid: level 0 holds the
+ * reference extent into a single tile, and each level doubles the
+ * resolution of the previous one.
+ */
+class TilePyramid {
+
+ public:
+  TilePyramid();
+  TilePyramid(double minx, double miny, double maxx, double maxy);
+
+  static const int TILE_SIZE = 256;
+
+  int getZoomLevel(double resolution) const;
+  double getResolution(int zoom) const;
+  QRect getTileRange(int zoom, double minx, double miny, double maxx, double maxy) const;
+  MapTile getTile(int zoom, int x, int y, quint64 revision) const;
+
+ private:
+  // upper-left corner of tile (0, 0), whatever the zoom level
+  double originX, originY;
+  // resolution (map units per pixel) of level 0
+  double baseResolution;
+};
+
+#endif // MAPTILES_H
@@ -31,18 +31,99 @@
 #include "layer.h"
 #include "mapfileparser.h"
 
+#include <QAtomicInt>
 #include <QDebug>
 
-Layer::Layer(QString const & name, struct mapObj * map):
-map(map) {
+// render stamps are unique among all the layers (wrappers are also created
+// from the renderer threads, see MapfileParser copy constructor).
+static QAtomicInt lastRenderStamp;
+// same for the revisions
+static QAtomicInt lastRevision;
+
+LayerIndex::LayerIndex(struct mapObj * map) : map(map), generation(0) {
+  rebuild();
+}
+
+/**
+ * Returns the index of the first layer with the given name (as
+ * msGetLayerIndex() does), -1 if there is none.
+ */
+int LayerIndex::indexOf(QString const & name) const {
+  return indexes.value(name, -1);
+}
+
+struct mapObj * LayerIndex::getMap() const {
+  return map;
+}
+
+quint64 LayerIndex::getGeneration() const {
+  return generation;
+}
+
+void LayerIndex::rebuild() {
+  indexes.clear();
+  ++generation;
+  if (! map) {
+    return;
+  }
+  for (int i = 0; i < map->numlayers; ++i) {
+    QString name = GET_LAYER(map, i)->name;
+    if ((! name.isEmpty()) && (! indexes.contains(name))) {
+      indexes.insert(name, i);
+    }
+  }
+}
+
+void LayerIndex::detach() {
+  map = NULL;
+  rebuild();
+}
+
+Layer::Layer(QString const & name, struct mapObj * map, QSharedPointer<LayerIndex> const & index):
+map(map), index(index), cachedLayerObj(NULL), cachedGeneration(0), enabledRequestsParsed(false) {
   this->name = name;
+  this->bumpRenderStamp();
+  this->bumpRevision();
+}
+
+quint64 Layer::getRevision() const {
+  return revision;
+}
+
+void Layer::bumpRevision() {
+  revision = (uint) lastRevision.fetchAndAddOrdered(1) + 1;
+}
+
+quint64 Layer::getRenderStamp() const {
+  return renderStamp;
+}
+
+void Layer::bumpRenderStamp() {
+  renderStamp = (uint) lastRenderStamp.fetchAndAddOrdered(1) + 1;
 }
 
 QString const & Layer::getName() const {
   return name;
 }
 
+/**
+ * Returns the number of layers of the map with the given name.
+ */
+int Layer::getNameCount(QString const & name) const {
+  int count = 0;
+  // the map object may have gone away, see getInternalIndex()
+  if (this->map && ((! index) || (index->getMap() == this->map))) {
+    for (int i = 0; i < this->map->numlayers; ++i) {
+      if (name == GET_LAYER(this->map, i)->name) {
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
 void Layer::setName(QString const & newName) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (! l)
     return;
@@ -51,6 +132,10 @@ void Layer::setName(QString const & newName) {
   }
   l->name  = strdup(newName.toStdString().c_str());
   name = newName;
+  if (index) {
+    index->rebuild();
+  }
+  bumpRenderStamp();
 }
 
 double Layer::getMaxScaleDenomLabel() const {
@@ -77,6 +162,7 @@ int Layer::getStatus() const {
 }
 
 void Layer::setStatus(int const newStatus) {
+  bumpRevision();
   if (newStatus < 0 || newStatus > 2)
     return;
   layerObj * l = getInternalLayerObj();
@@ -92,8 +178,10 @@ QString Layer::getRequires() const {
 }
 
 void Layer::setRequires(QString const & newRequires) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (l) {
+    bumpRenderStamp();
     if (l->requires) {
       free(l->requires);
       l->requires = NULL;
@@ -114,8 +202,10 @@ QString Layer::getGroup() const {
 }
 
 void Layer::setGroup(QString const &newGroup) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (l) {
+    bumpRenderStamp();
     if (l->group) {
       free(l->group);
       l->group = NULL;
@@ -147,6 +237,7 @@ int Layer::getOpacity() const {
 }
 
 void Layer::setOpacity(int const newOpacity) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (l) {
     // No need for prepocessor magick here,
@@ -164,8 +255,10 @@ QString Layer::getMask() const {
 }
 
 void Layer::setMask(QString const &newMask) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (l) {
+    bumpRenderStamp();
     if (l->mask) {
       free(l->mask);
       l->mask = NULL;
@@ -227,10 +320,12 @@ double Layer::getMinScaleDenom() const {
   return -1.0;
 }
 void Layer::setMinScaleDenom(double const newMin) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (! l)
     return;
   l->minscaledenom = newMin;
+  bumpRenderStamp();
 }
 
 double Layer::getMaxScaleDenom() const {
@@ -241,10 +336,12 @@ double Layer::getMaxScaleDenom() const {
 }
 
 void Layer::setMaxScaleDenom(double const newMax) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (! l)
     return;
   l->maxscaledenom = newMax;
+  bumpRenderStamp();
 }
 
 QString Layer::getPlugin() const {
@@ -305,6 +402,7 @@ QString Layer::getTemplate() const {
 }
 
 void Layer::setTemplate(QString const & newTemplate) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (l) {
     if (l->_template) {
@@ -325,6 +423,7 @@ QString Layer::getHeader() const {
 }
 
 void Layer::setHeader(QString const & newHeader) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (l) {
     if (l->header) {
@@ -345,6 +444,7 @@ QString Layer::getFooter() const {
 }
 
 void Layer::setFooter(QString const & newFooter) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (l) {
     if (l->footer) {
@@ -414,6 +514,7 @@ int Layer::getDebugLevel() const {
 }
 
 void Layer::setDebugLevel(int const newLevel) {
+  bumpRevision();
   layerObj * l = getInternalLayerObj();
   if (l) {
     l->debug = newLevel;
@@ -421,6 +522,50 @@ void Layer::setDebugLevel(int const newLevel) {
   return;
 }
 
+QString Layer::getMetadata(QString const & name) const {
+  layerObj * l = getInternalLayerObj();
+  if (l)
+    return msLookupHashTable(& (l->metadata), name.toStdString().c_str());
+  return QString();
+}
+
+void Layer::setMetadata(QString const & name, QString const & value) {
+  bumpRevision();
+  layerObj * l = getInternalLayerObj();
+  if (l) {
+    msInsertHashTable(& (l->metadata), name.toStdString().c_str(), value.toStdString().c_str());
+    if (OgcRequests::isRequestKey(name)) {
+      enabledRequestsParsed = false;
+    }
+  }
+}
+
+void Layer::removeMetadata(QString const & name) {
+  bumpRevision();
+  layerObj * l = getInternalLayerObj();
+  if (l) {
+    msRemoveHashTable(& (l->metadata), name.toStdString().c_str());
+    if (OgcRequests::isRequestKey(name)) {
+      enabledRequestsParsed = false;
+    }
+  }
+}
+
+OgcRequests const & Layer::getEnabledRequests(OgcRequests::Service service) const {
+  if (! enabledRequestsParsed) {
+    QHash<QString, QString> requests;
+    requests.insert("ows_enable_request", getMetadata("ows_enable_request"));
+    requests.insert("wms_enable_request", getMetadata("wms_enable_request"));
+    requests.insert("wfs_enable_request", getMetadata("wfs_enable_request"));
+    requests.insert("wcs_enable_request", getMetadata("wcs_enable_request"));
+    for (int i = 0; i < OgcRequests::SERVICE_COUNT; ++i) {
+      enabledRequests[i] = OgcRequests::fromMetadata(requests, (OgcRequests::Service) i);
+    }
+    enabledRequestsParsed = true;
+  }
+  return enabledRequests[service];
+}
+
 QString Layer::getLabelRequires() const {
   layerObj * l = getInternalLayerObj();
   if (l)
@@ -436,17 +581,30 @@ int Layer::getInternalIndex(void) const {
     return -1;
   }
 
+  if (index) {
+    return (index->getMap() == this->map) ? index->indexOf(name) : -1;
+  }
   return msGetLayerIndex(this->map, (char *) name.toStdString().c_str());
 }
 
 layerObj * Layer::getInternalLayerObj(void) const {
-  int idx = getInternalIndex();
+  // still valid: the layers have not been modified since the lookup
+  if ((index) && (cachedGeneration == index->getGeneration())) {
+    return cachedLayerObj;
+  }
 
-  if ((idx < 0) || (idx > this->map->numlayers))
-   return NULL;
+  int idx = getInternalIndex();
+  layerObj * ret = NULL;
 
- return GET_LAYER(this->map, idx);
+  if ((idx >= 0) && (idx < this->map->numlayers)) {
+    ret = GET_LAYER(this->map, idx);
+  }
 
+  if (index) {
+    cachedLayerObj   = ret;
+    cachedGeneration = index->getGeneration();
+  }
+  return ret;
 }
 
 Layer::~Layer() {
@@ -461,64 +619,145 @@ QStringList Layer::layerType = QStringList() << "MS_LAYER_POINT" << "MS_LAYER_LI
 
 // Methods related to the Qt representation of the layers
 
-LayerModel::LayerModel(QObject * parent, QList<Layer *> const & l) : QAbstractListModel(parent), layers(l) {}
+const int LayerModel::FETCH_SIZE = 256;
+
+LayerModel::LayerModel(QObject * parent, MapfileParser * mapfile) :
+  QAbstractListModel(parent), mapfile(mapfile), fetchedRows(0) {}
 
 
 LayerModel::~LayerModel() {}
 
-void LayerModel::setLayers(QList<Layer *> const  & layers) {
+/**
+ * Resets the model onto the given mapfile. If it is the same as before (i.e.
+ * the layers have been modified), the rows already fetched remain so.
+ */
+void LayerModel::setMapfile(MapfileParser * mapfile) {
   beginResetModel();
-  this->layers = layers;
+  if (mapfile != this->mapfile) {
+    this->fetchedRows = 0;
+  }
+  this->mapfile = mapfile;
+  this->fetchedRows = this->mapfile ? qMin(this->fetchedRows, this->mapfile->getLayerCount()) : 0;
+  // the rows may have moved
+  this->cachedRevisions.fill(0);
+  this->resizeCache();
   endResetModel();
 }
 
 Layer * LayerModel::getLayer(const QModelIndex &m) const {
-  if ((m.row() < 0) || m.row() > layers.size())
+  if ((! mapfile) || (m.row() < 0) || (m.row() >= fetchedRows))
     return NULL;
-  return layers.at(m.row());
+  return mapfile->getLayer(m.row());
 }
 
 void LayerModel::removeLayer(const QModelIndex &m) {
-   if (m.row() < 0 || m.row() > layers.size())
+  Layer * toBeRemoved = getLayer(m);
+  if (! toBeRemoved)
     return;
 
-  beginResetModel();
+  beginRemoveRows(QModelIndex(), m.row(), m.row());
+  mapfile->removeLayer(toBeRemoved);
+  fetchedRows--;
+  cachedRevisions.remove(m.row());
+  for (int i = 0; i < columnCount(); ++i)
+    cachedColumns[i].remove(m.row());
+  endRemoveRows();
+}
 
-  Layer * toBeRemoved = layers.takeAt(m.row());
-  // TODO: We might need the same mechanism as on OutputFormats
-  // (i.e. state - ADDED ...)
-  //if ((toBeRemoved->getState() == OutputFormat::ADDED)
-  //    ||(toBeRemoved->getState() == OutputFormat::ADDED_SAVED)) {
-  //  delete toBeRemoved;
-  //} else {
-  removedLayers.append(toBeRemoved);
-  //}
-  endResetModel();
+int LayerModel::rowCount(const QModelIndex & parent) const {
+  if (parent.isValid())
+    return 0;
+  return fetchedRows;
+}
 
+bool LayerModel::canFetchMore(const QModelIndex & parent) const {
+  if ((parent.isValid()) || (! mapfile))
+    return false;
+  return fetchedRows < mapfile->getLayerCount();
 }
 
-int LayerModel::rowCount(const QModelIndex & parent) const {
-  Q_UNUSED(parent);
-  return layers.size();
+void LayerModel::fetchMore(const QModelIndex & parent) {
+  if (! canFetchMore(parent))
+    return;
+
+  int toFetch = qMin(FETCH_SIZE, mapfile->getLayerCount() - fetchedRows);
+  beginInsertRows(QModelIndex(), fetchedRows, fetchedRows + toFetch - 1);
+  fetchedRows += toFetch;
+  resizeCache();
+  endInsertRows();
+}
+
+void LayerModel::resizeCache() {
+  cachedRevisions.resize(fetchedRows);
+  for (int i = 0; i < columnCount(); ++i)
+    cachedColumns[i].resize(fetchedRows);
+}
+
+bool LayerModel::isCached(int row) const {
+  return cachedRevisions.at(row) == mapfile->getLayer(row)->getRevision();
+}
+
+/**
+ * Reads all the properties of the given rows which are not up-to-date, in a
+ * single pass.
+ */
+void LayerModel::cacheRows(int first, int last) const {
+  for (int row = first; row <= last; ++row) {
+    Layer * l = mapfile->getLayer(row);
+    if (cachedRevisions.at(row) == l->getRevision())
+      continue;
+    for (int column = 0; column < columnCount(); ++column)
+      cachedColumns[column][row] = readValue(l, column);
+    cachedRevisions[row] = l->getRevision();
+  }
+}
+
+/**
+ * Gives the value of a cell, from the cache.
+ */
+QVariant LayerModel::getValue(int row, int column) const {
+  if ((! mapfile) || (row < 0) || (row >= fetchedRows) || (column < 0) || (column >= columnCount()))
+    return QVariant();
+  cacheRows(row, row);
+  return cachedColumns[column].at(row);
+}
+
+/**
+ * Gives a whole column (for sorting or filtering), reading the layers
+ * modified since the last call.
+ */
+QVector<QVariant> const & LayerModel::getColumn(int column) const {
+  if (mapfile && (fetchedRows > 0))
+    cacheRows(0, fetchedRows - 1);
+  return cachedColumns[column];
+}
+
+/**
+ * Notifies the views of the rows whose layer has been modified since they
+ * were read.
+ */
+void LayerModel::refresh() {
+  if (! mapfile)
+    return;
+  for (int row = 0; row < fetchedRows; ++row) {
+    if ((cachedRevisions.at(row) != 0) && (! isCached(row)))
+      emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+  }
 }
 
 int LayerModel::columnCount(const QModelIndex &parent) const {
   Q_UNUSED(parent);
-  return LayerModel::LAYER_DEBUG_LEVEL + 1;
+  return LayerModel::LAYER_COLUMN_COUNT;
 }
 
 QVariant LayerModel::data(const QModelIndex &index, int role) const {
   if ((role != Qt::DisplayRole) && (role != Qt::EditRole))
     return QVariant();
-  if ((index.row() < 0) || (index.row() > layers.size()))
-    return QVariant();
-
-  Layer * l = layers.at(index.row());
-
-  if (l == NULL)
-    return QVariant();
+  return getValue(index.row(), index.column());
+}
 
-  switch (index.column()) {
+QVariant LayerModel::readValue(Layer const * l, int column) {
+  switch (column) {
     case LayerModel::LAYER_NAME:
       return QVariant(l->getName());
     case LayerModel::LAYER_STATUS:
@@ -569,6 +808,8 @@ QVariant LayerModel::data(const QModelIndex &index, int role) const {
       return QVariant(l->getLabelRequires());
     case LayerModel::LAYER_DEBUG_LEVEL:
       return QVariant(l->getDebugLevel());
+    case LayerModel::LAYER_GROUP:
+      return QVariant(l->getGroup());
     default:
       return QVariant();
   }
@@ -576,11 +817,41 @@ QVariant LayerModel::data(const QModelIndex &index, int role) const {
 
 
 QVariant LayerModel::headerData (int section, Qt::Orientation orientation, int role) const {
-  Q_UNUSED(section);
-  Q_UNUSED(orientation);
   if (role != Qt::DisplayRole)
     return QVariant();
-  return QVariant(QObject::tr("Layers"));
+  if (orientation == Qt::Vertical)
+    return QVariant(section + 1);
+
+  switch (section) {
+    case LayerModel::LAYER_NAME:                  return QVariant(QObject::tr("Layers"));
+    case LayerModel::LAYER_STATUS:                return QVariant(QObject::tr("Status"));
+    case LayerModel::LAYER_TYPE:                  return QVariant(QObject::tr("Type"));
+    case LayerModel::LAYER_OPACITY:               return QVariant(QObject::tr("Opacity"));
+    case LayerModel::LAYER_MASK:                  return QVariant(QObject::tr("Mask"));
+    case LayerModel::LAYER_MIN_X:                 return QVariant(QObject::tr("Min X"));
+    case LayerModel::LAYER_MAX_X:                 return QVariant(QObject::tr("Max X"));
+    case LayerModel::LAYER_MIN_Y:                 return QVariant(QObject::tr("Min Y"));
+    case LayerModel::LAYER_MAX_Y:                 return QVariant(QObject::tr("Max Y"));
+    case LayerModel::LAYER_MIN_SCALE:             return QVariant(QObject::tr("Min scale denom."));
+    case LayerModel::LAYER_MAX_SCALE:             return QVariant(QObject::tr("Max scale denom."));
+    case LayerModel::LAYER_TOLERANCE:             return QVariant(QObject::tr("Tolerance"));
+    case LayerModel::LAYER_MAX_FEATURES:          return QVariant(QObject::tr("Max features"));
+    case LayerModel::LAYER_MIN_GEO_WIDTH:         return QVariant(QObject::tr("Min geo width"));
+    case LayerModel::LAYER_MAX_GEO_WIDTH:         return QVariant(QObject::tr("Max geo width"));
+    case LayerModel::LAYER_HEADER:                return QVariant(QObject::tr("Header"));
+    case LayerModel::LAYER_FOOTER:                return QVariant(QObject::tr("Footer"));
+    case LayerModel::LAYER_LABEL_ITEM:            return QVariant(QObject::tr("Label item"));
+    case LayerModel::LAYER_SYMBOL_SCALE_DENOM:    return QVariant(QObject::tr("Symbol scale denom."));
+    case LayerModel::LAYER_MAX_SCALE_DENOM_LABEL: return QVariant(QObject::tr("Label max scale denom."));
+    case LayerModel::LAYER_MIN_SCALE_DENOM_LABEL: return QVariant(QObject::tr("Label min scale denom."));
+    case LayerModel::LAYER_LABEL_CACHE:           return QVariant(QObject::tr("Label cache"));
+    case LayerModel::LAYER_POST_LABEL_CACHE:      return QVariant(QObject::tr("Post label cache"));
+    case LayerModel::LAYER_LABEL_REQUIRES:        return QVariant(QObject::tr("Label requires"));
+    case LayerModel::LAYER_DEBUG_LEVEL:           return QVariant(QObject::tr("Debug level"));
+    case LayerModel::LAYER_GROUP:                 return QVariant(QObject::tr("Group"));
+    default:
+      return QVariant();
+  }
 }
 
 
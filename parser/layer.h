@@ -31,8 +31,42 @@
 
 #include <QHash>
 #include <QModelIndex>
+#include <QSharedPointer>
 #include <QString>
 #include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include "ogcrequests.h"
+
+class MapfileParser;
+
+/**
+ * Name to index lookup of the layers of a map object, replacing the linear
+ * scan of msGetLayerIndex().
+ *
+ * The index has to be rebuilt each time the layers array is modified
+ * (msGrowMapLayers(), msInsertLayer(), msRemoveLayer(), renaming), which also
+ * renews its generation, so that the layers pointers cached against the
+ * previous one are known to be outdated.
+ */
+class LayerIndex {
+  public:
+    LayerIndex(struct mapObj *);
+
+    int indexOf(QString const &) const;
+    struct mapObj * getMap() const;
+    quint64 getGeneration() const;
+
+    void rebuild();
+    // the map object is going away
+    void detach();
+
+  private:
+    struct mapObj * map;
+    QHash<QString, int> indexes;
+    quint64 generation;
+};
 
 /**
  * This class shall be considered as an interface
@@ -42,11 +76,13 @@
 
 class Layer {
   public:
-    Layer(QString const & name, struct mapObj *);
+    Layer(QString const & name, struct mapObj *,
+          QSharedPointer<LayerIndex> const & index = QSharedPointer<LayerIndex>());
     ~Layer();
 
     QString const & getName() const;
     void setName(QString const &);
+    int getNameCount(QString const &) const;
 
     int getStatus() const;
     void setStatus(int const);
@@ -81,6 +117,14 @@ class Layer {
     QString getFooter() const;
     void    setFooter(QString const &);
 
+    QString getMetadata(QString const &) const;
+    void    setMetadata(QString const &, QString const &);
+    void    removeMetadata(QString const &);
+
+    // requests enabled by the layer-level metadata (see
+    // MapfileParser::isRequestEnabled() for the effective ones)
+    OgcRequests const & getEnabledRequests(OgcRequests::Service) const;
+
     // static variables (from mapserver.h)
     static QStringList layerType;
 
@@ -111,6 +155,15 @@ class Layer {
     double getMaxScaleDenomLabel() const;
     double getMinScaleDenomLabel() const;
 
+    // identifies the drawing of the layer, renewed each time a property
+    // affecting it is modified (status and opacity are left to the
+    // compositing of the preview, and do not renew it).
+    quint64 getRenderStamp() const;
+    void bumpRenderStamp();
+
+    // identifies the state of the layer, renewed by each of its setters
+    // (i.e. by the layer commands), see LayerModel.
+    quint64 getRevision() const;
 
   private:
     // Note: in Mapserver, name is used as a primary key
@@ -125,6 +178,20 @@ class Layer {
     // internal layer object using the mapObj.
     struct mapObj * map;
 
+    quint64 renderStamp;
+    quint64 revision;
+    void bumpRevision();
+
+    // the layerObj is looked up from the index of its map (if any), and
+    // cached as long as the generation of the index remains the same.
+    QSharedPointer<LayerIndex> index;
+    mutable struct layerObj * cachedLayerObj;
+    mutable quint64 cachedGeneration;
+
+    // parsed on first use, and when the *_enable_request metadata change
+    mutable OgcRequests enabledRequests[OgcRequests::SERVICE_COUNT];
+    mutable bool enabledRequestsParsed;
+
     int getInternalIndex() const;
     struct layerObj * getInternalLayerObj() const;
 
@@ -143,32 +210,62 @@ class RasterLayer : public Layer {
 
 
 
+/**
+ * Model over the layers of a mapfile. The rows are fetched incrementally (see
+ * canFetchMore() / fetchMore()), so that the layers wrappers are only created
+ * as they get displayed.
+ *
+ * The cells are cached column by column: all the properties of a layer are
+ * read at once, and kept as long as the revision of the layer remains the
+ * same (see Layer::getRevision()), i.e. until a layer command modifies it.
+ */
 class LayerModel : public QAbstractListModel {
 
  public:
-  LayerModel(QObject *, QList<Layer *> const &);
+  LayerModel(QObject *, MapfileParser *);
   ~LayerModel();
 
-  void setLayers(QList<Layer *> const &);
+  void setMapfile(MapfileParser *);
   Layer * getLayer(const QModelIndex &) const;
   void removeLayer(const QModelIndex &);
 
   int rowCount(const QModelIndex &parent = QModelIndex()) const;
   int columnCount(const QModelIndex &parent = QModelIndex()) const;
 
+  bool canFetchMore(const QModelIndex &parent) const;
+  void fetchMore(const QModelIndex &parent);
+
   QVariant data(const QModelIndex &index, int role) const;
   QVariant headerData ( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const;
 
+  QVariant getValue(int row, int column) const;
+  QVector<QVariant> const & getColumn(int column) const;
+  void refresh();
+
   // TODO to be completed as long as new member variables are supported
   enum Column { LAYER_NAME, LAYER_STATUS, LAYER_TYPE, LAYER_OPACITY, LAYER_MASK, LAYER_MIN_X, LAYER_MAX_X, 
     LAYER_MIN_Y, LAYER_MAX_Y, LAYER_MIN_SCALE, LAYER_MAX_SCALE,
     LAYER_TOLERANCE, LAYER_MAX_FEATURES, LAYER_MIN_GEO_WIDTH, LAYER_MAX_GEO_WIDTH, LAYER_HEADER, LAYER_FOOTER, LAYER_LABEL_ITEM, 
     LAYER_SYMBOL_SCALE_DENOM, LAYER_MAX_SCALE_DENOM_LABEL,
-    LAYER_MIN_SCALE_DENOM_LABEL, LAYER_LABEL_CACHE, LAYER_POST_LABEL_CACHE, LAYER_LABEL_REQUIRES, LAYER_DEBUG_LEVEL };
+    LAYER_MIN_SCALE_DENOM_LABEL, LAYER_LABEL_CACHE, LAYER_POST_LABEL_CACHE, LAYER_LABEL_REQUIRES, LAYER_DEBUG_LEVEL,
+    LAYER_GROUP, LAYER_COLUMN_COUNT };
 
  private:
-  QList<Layer *> layers;
-  QList<Layer *> removedLayers;
+  MapfileParser * mapfile;
+  // number of rows exposed so far
+  int fetchedRows;
+
+  static const int FETCH_SIZE;
+
+  // one vector per column, and the revisions of the layers the rows were
+  // read from (0 for the rows not read yet).
+  mutable QVector<quint64> cachedRevisions;
+  mutable QVector<QVariant> cachedColumns[LAYER_COLUMN_COUNT];
+
+  bool isCached(int row) const;
+  void cacheRows(int first, int last) const;
+  void resizeCache();
+  static QVariant readValue(Layer const *, int column);
 
 };
 
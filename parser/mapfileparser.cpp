@@ -33,7 +33,22 @@
 #include <string>
 #include <iostream>
 
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <QBuffer>
 #include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#if QT_VERSION >= 0x050000
+#include <QSaveFile>
+#endif
+#include <QTemporaryFile>
 
 #include "mapfileparser.h"
 
@@ -74,14 +89,45 @@ extern "C" {
  *   mapfile.
  */
 MapfileParser::MapfileParser(const QString & fname) :
-    filename(fname), currentImageSize(0)
+    filename(fname), revision(0), renderRevision(0), currentImageSize(0)
 {
   this->map = umnms_new_map(fname.isEmpty() ? NULL :  (char *) filename.toStdString().c_str());
+  this->populateFromMs();
+}
 
+/**
+ * Creates a deep copy of another parser: the underlying mapObj is duplicated
+ * using msCopyMap(), so that the copy shares no memory with the original one.
+ *
+ * This is used to give the preview renderer its own private map object, which
+ * can then be drawn from another thread while the user keeps on editing the
+ * original one.
+ */
+MapfileParser::MapfileParser(MapfileParser const & other) :
+    filename(other.filename), revision(other.revision),
+    renderRevision(other.renderRevision), currentImageSize(0)
+{
+  if (other.map) {
+    this->map = umnms_new_map(NULL);
+    if ((this->map) && (msCopyMap(this->map, other.map) != MS_SUCCESS)) {
+      qDebug() << "Unable to copy the map object, this should not happen.";
+      msFreeMap(this->map);
+      this->map = NULL;
+    }
+  }
+  this->populateFromMs();
+}
+
+/**
+ * Builds the Qt-side objects (output formats, config options, metadatas and
+ * layers wrappers) from the mapserver map object.
+ */
+void MapfileParser::populateFromMs() {
   this->layers = QList<Layer *>();
   this->outputFormats = QList<OutputFormat *>();
   this->configOptions = QHash<QString,QString>();
   this->metadatas = QHash<QString,QString>();
+  this->layerIndex = QSharedPointer<LayerIndex>(new LayerIndex(this->map));
 
   if (this->map) {
     for (int i = 0; i < this->map->numoutputformats ; i++) {
@@ -104,13 +150,13 @@ MapfileParser::MapfileParser(const QString & fname) :
    this->configOptions = populateMapFromMs(& (this->map->configoptions));
    // metadatas
    this->metadatas = populateMapFromMs(& (this->map->web.metadata));
+   this->updateEnabledRequests();
 
-   // Layers
+   // Layers: the wrappers are only created when first accessed (see
+   // getLayer()), generated mapfiles can have tens of thousands of layers.
+   this->layers.reserve(this->map->numlayers);
    for (int i = 0; i < this->map->numlayers; ++i) {
-     // Since the name is a pivot, we consider it as a special
-     // variable (this is the only thing we can almost consider
-     // as stable across user modifications).
-     this->layers << new Layer(this->map->layers[i]->name, this->map);
+     this->layers << NULL;
    }
   }
 }
@@ -125,18 +171,12 @@ int const & MapfileParser::getCurrentMapImageSize() const {
   return this->currentImageSize;
 }
 
-unsigned char * MapfileParser::getCurrentMapImage(const int & width, const int & height) {
-  if (! this->map) {
-    return NULL;
-  }
-
-  // invalidates previous data
-  if (this->currentImageBuffer) {
-    free(this->currentImageBuffer);
-    this->currentImageBuffer = NULL;
-    this->currentImageSize = 0;
-  }
-
+/**
+ * Draws the map, with the given size if width and height are positive.
+ * The caller is responsible for freeing the returned image with
+ * msFreeImage().
+ */
+imageObj * MapfileParser::drawCurrentMap(const int & width, const int & height) {
   // issue #13 (https://github.com/QMapfileEditor/QMapfileEditor/issues/13)
   //
   // mapserver will internally adjust the extent when calling msDrawMap, since
@@ -166,6 +206,23 @@ unsigned char * MapfileParser::getCurrentMapImage(const int & width, const int &
   this->map->extent.maxy = tmpYMax;
   this->map->extent.miny = tmpYMin;
 
+  return img;
+}
+
+unsigned char * MapfileParser::getCurrentMapImage(const int & width, const int & height) {
+  if (! this->map) {
+    return NULL;
+  }
+
+  // invalidates previous data
+  if (this->currentImageBuffer) {
+    free(this->currentImageBuffer);
+    this->currentImageBuffer = NULL;
+    this->currentImageSize = 0;
+  }
+
+  imageObj * img = drawCurrentMap(width, height);
+
   if (img != NULL) {
     this->currentImageBuffer = msSaveImageBuffer(img, & this->currentImageSize, img->format);
     // we do not need img anymore
@@ -176,30 +233,568 @@ unsigned char * MapfileParser::getCurrentMapImage(const int & width, const int &
   return NULL;
 }
 
+#if QT_VERSION >= 0x050000
+// called by Qt when the last QImage referencing the renderer buffer is destroyed
+static void freeMapImage(void * img) {
+  msFreeImage((imageObj *) img);
+}
+#endif
+
+/**
+ * Same as getCurrentMapImage(), but gives back the raw raster drawn by the
+ * renderer instead of an image encoded in the mapfile output format, so that
+ * the preview does not have to go through a PNG / JPEG encoding then
+ * decoding.
+ *
+ * With the AGG / Cairo renderers, the pixels are laid out exactly like
+ * QImage::Format_ARGB32_Premultiplied, the returned QImage wraps the buffer
+ * without copying it (Qt >= 5, the buffer is freed along with the image).
+ * Other pixel layouts are converted, and renderers without access to their
+ * raster buffer fall back to the encoded image.
+ */
+QImage MapfileParser::getCurrentMapRawImage(const int & width, const int & height) {
+  if (! this->map) {
+    return QImage();
+  }
+
+  return toRawImage(drawCurrentMap(width, height));
+}
+
+/**
+ * Draws a quick and approximate version of the map, for the preview to be
+ * displayed before the full one is available:
+ *
+ * - the resolution (DPI) is divided by the given reduction, so that the
+ *   image keeps the same scale and proportions with less pixels (the
+ *   expected size is the reduced one);
+ * - the number of features read from each vector layer is capped.
+ */
+QImage MapfileParser::getCurrentMapDraftImage(const int & width, const int & height,
+                                              const int & reduction, const int & maxFeatures) {
+  if ((! this->map) || (reduction <= 0)) {
+    return QImage();
+  }
+
+  QList<int> layersMaxFeatures;
+  for (int i = 0; i < this->map->numlayers; ++i) {
+    layerObj * l = GET_LAYER(this->map, i);
+    layersMaxFeatures << l->maxfeatures;
+    if ((l->type != MS_LAYER_RASTER) && ((l->maxfeatures < 0) || (l->maxfeatures > maxFeatures))) {
+      l->maxfeatures = maxFeatures;
+    }
+  }
+  double resolution = this->map->resolution;
+  this->map->resolution = resolution / reduction;
+
+  QImage ret = toRawImage(drawCurrentMap(width, height));
+
+  this->map->resolution = resolution;
+  for (int i = 0; i < this->map->numlayers; ++i) {
+    GET_LAYER(this->map, i)->maxfeatures = layersMaxFeatures.at(i);
+  }
+  return ret;
+}
+
+// bytes read so far by the calling thread (Linux only), -1 if unknown
+static qint64 readThreadBytes() {
+  QFile io("/proc/thread-self/io");
+  if (! io.open(QIODevice::ReadOnly)) {
+    return -1;
+  }
+  QList<QByteArray> lines = io.readAll().split('\n');
+  for (int i = 0; i < lines.size(); ++i) {
+    if (lines[i].startsWith("rchar:")) {
+      return lines[i].mid(6).trimmed().toLongLong();
+    }
+  }
+  return -1;
+}
+
+// number of features of a layer within the map extent, -1 if unknown
+static int countLayerFeatures(mapObj * map, layerObj * layer) {
+  if ((layer->type == MS_LAYER_RASTER) || (! msLayerIsVisible(map, layer))) {
+    return 0;
+  }
+  if (msLayerOpen(layer) != MS_SUCCESS) {
+    return -1;
+  }
+
+  int count = -1;
+  if (msLayerWhichItems(layer, MS_FALSE, NULL) == MS_SUCCESS) {
+    rectObj searchrect = map->extent;
+    if ((layer->project) && (msProjectionsDiffer(& (map->projection), & (layer->projection)))) {
+      msProjectRect(& (map->projection), & (layer->projection), & searchrect);
+    }
+    int status = msLayerWhichShapes(layer, searchrect, MS_FALSE);
+    if (status == MS_DONE) {
+      count = 0;
+    } else if (status == MS_SUCCESS) {
+      shapeObj shape;
+      msInitShape(& shape);
+      count = 0;
+      while (msLayerNextShape(layer, & shape) == MS_SUCCESS) {
+        ++count;
+        msFreeShape(& shape);
+      }
+    }
+  }
+  msLayerClose(layer);
+  return count;
+}
+
+/**
+ * Draws the map as msDrawMap() would, layer by layer, measuring the time
+ * spent and the bytes read to draw each of them. The labels, drawn once all
+ * the layers are, are measured separately (last item of the list).
+ *
+ * The features are counted apart from the drawing, so that counting does
+ * not alter the measures.
+ */
+QList<LayerProfile> MapfileParser::profileCurrentMap(const int & width, const int & height) {
+  QList<LayerProfile> ret;
+  if (! this->map) {
+    return ret;
+  }
+
+  rectObj extent = this->map->extent;
+  int mapWidth = this->map->width, mapHeight = this->map->height;
+  this->map->width  = width;
+  this->map->height = height;
+
+  imageObj * img = msPrepareImage(this->map, MS_TRUE);
+  if (img) {
+    QElapsedTimer timer;
+    QList<int> order = this->getLayerOrder();
+
+    for (int i = 0; i < order.size(); ++i) {
+      layerObj * layer = GET_LAYER(this->map, order[i]);
+      LayerProfile profile;
+      profile.name   = layer->name;
+      profile.index  = order[i];
+      profile.labels = 0;
+
+      qint64 bytes = readThreadBytes();
+      timer.start();
+      msDrawLayer(this->map, layer, img);
+      profile.time = timer.nsecsElapsed() / 1000;
+      profile.bytesRead = (bytes >= 0) ? readThreadBytes() - bytes : -1;
+
+      profile.features = countLayerFeatures(this->map, layer);
+      ret << profile;
+    }
+
+    LayerProfile labels;
+    labels.name      = QObject::tr("Labels");
+    labels.index     = LayerProfile::LABELS;
+    labels.features  = 0;
+    labels.labels    = 0;
+
+    // labels per layer
+    for (int priority = 0; priority < MS_MAX_LABEL_PRIORITY; ++priority) {
+      labelCacheSlotObj * slot = & (this->map->labelcache.slots[priority]);
+      for (int j = 0; j < slot->numlabels; ++j) {
+        int layerIndex = slot->labels[j].layerindex;
+        for (int k = 0; k < ret.size(); ++k) {
+          if (ret[k].index == layerIndex) {
+            ++ret[k].labels;
+            break;
+          }
+        }
+        ++labels.labels;
+      }
+    }
+
+    qint64 bytes = readThreadBytes();
+    timer.start();
+#if MS_VERSION_MAJOR < 7
+    msDrawLabelCache(img, this->map);
+#else
+    msDrawLabelCache(this->map, img);
+#endif
+    labels.time = timer.nsecsElapsed() / 1000;
+    labels.bytesRead = (bytes >= 0) ? readThreadBytes() - bytes : -1;
+    ret << labels;
+
+    msFreeImage(img);
+  }
+
+  this->map->width  = mapWidth;
+  this->map->height = mapHeight;
+  this->map->extent = extent;
+
+  return ret;
+}
+
+/**
+ * Draws a single layer of the map onto a transparent image, so that the
+ * preview can be composited layer by layer.
+ *
+ * The opacity of the layer is not applied, it is left to the compositing.
+ * Neither are its labels drawn: they are placed over all the layers at once,
+ * avoiding the ones of the other layers (see getLabelsRawImage()).
+ */
+QImage MapfileParser::getLayerRawImage(const int & index, const int & width, const int & height) {
+  if (! this->map) {
+    return QImage();
+  }
+  return toRawImage(drawLayer(index, width, height));
+}
+
+/**
+ * Draws the labels of the map onto a transparent image, to be put over the
+ * drawings of its layers.
+ */
+QImage MapfileParser::getLabelsRawImage(const int & width, const int & height) {
+  if (! this->map) {
+    return QImage();
+  }
+  return toRawImage(drawLabels(width, height));
+}
+
+/**
+ * Tells whether some of the layers drawn have labels, in which case they
+ * have to be drawn over the layers (see getLabelsRawImage()).
+ */
+bool MapfileParser::hasLabels() const {
+  if (! this->map) {
+    return false;
+  }
+  for (int i = 0; i < this->map->numlayers; ++i) {
+    layerObj * layer = GET_LAYER(this->map, i);
+    if ((layer->status != MS_OFF) && hasLabels(layer)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MapfileParser::hasLabels(layerObj const * layer) {
+  // "class" is named "_class" when compiled as C++
+  for (int j = 0; j < layer->numclasses; ++j) {
+    if (layer->_class[j]->numlabels > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Switches the map to drawing onto a transparent image of the given size
+ * for as long as it lives. As for drawCurrentMap(), everything altered has to
+ * be restored afterwards (see msPrepareImage() in mapdraw.c).
+ */
+class TransparentDrawing {
+ public:
+  TransparentDrawing(mapObj * map, int width, int height) :
+      map(map), extent(map->extent), width(map->width), height(map->height),
+      format(map->outputformat) {
+    transparent = format ? format->transparent : MS_FALSE;
+    imagemode   = format ? format->imagemode : MS_IMAGEMODE_RGB;
+    if (format) {
+      format->transparent = MS_TRUE;
+      if (format->imagemode == MS_IMAGEMODE_RGB) {
+        format->imagemode = MS_IMAGEMODE_RGBA;
+      }
+    }
+    map->width  = width;
+    map->height = height;
+  }
+
+  ~TransparentDrawing() {
+    map->width  = width;
+    map->height = height;
+    map->extent = extent;
+    if (format) {
+      format->transparent = transparent;
+      format->imagemode   = imagemode;
+    }
+  }
+
+ private:
+  mapObj * map;
+  rectObj extent;
+  int width, height;
+  outputFormatObj * format;
+  int transparent, imagemode;
+};
+
+/**
+ * Draws the layer at the given index, alone, with the given size. The
+ * caller is responsible for freeing the returned image with msFreeImage().
+ */
+imageObj * MapfileParser::drawLayer(const int & index, const int & width, const int & height) {
+  if ((index < 0) || (index >= this->map->numlayers) || (index >= this->layers.size())) {
+    return NULL;
+  }
+
+  TransparentDrawing drawing(this->map, width, height);
+
+  Layer * layer = getLayer(index);
+  int opacity = layer->getOpacity();
+  if ((opacity >= 0) && (opacity != 100)) {
+    layer->setOpacity(100);
+  }
+
+  imageObj * img = msPrepareImage(this->map, MS_TRUE);
+  if (img) {
+    msDrawLayer(this->map, GET_LAYER(this->map, index), img);
+  }
+
+  if ((opacity >= 0) && (opacity != 100)) {
+    layer->setOpacity(opacity);
+  }
+
+  return img;
+}
+
+/**
+ * Draws the labels of all the layers, placed as msDrawMap() does, alone with
+ * the given size. The layers are drawn onto a scratch image to fill the
+ * label cache, only the cache is drawn onto the returned image (to be freed
+ * with msFreeImage()).
+ */
+imageObj * MapfileParser::drawLabels(const int & width, const int & height) {
+  TransparentDrawing drawing(this->map, width, height);
+
+  // clears the label cache, as well
+  imageObj * img = msPrepareImage(this->map, MS_TRUE);
+  if (! img) {
+    return NULL;
+  }
+  imageObj * scratch = msImageCreate(img->width, img->height, img->format, NULL, NULL,
+                                     this->map->resolution, this->map->defresolution, NULL);
+  if (! scratch) {
+    msFreeImage(img);
+    return NULL;
+  }
+  QList<int> order = getLayerOrder();
+  for (int i = 0; i < order.size(); ++i) {
+    layerObj * layer = GET_LAYER(this->map, order[i]);
+    if ((layer->status != MS_OFF) && hasLabels(layer)) {
+      msDrawLayer(this->map, layer, scratch);
+    }
+  }
+  msFreeImage(scratch);
+
+#if MS_VERSION_MAJOR < 7
+  msDrawLabelCache(img, this->map);
+#else
+  msDrawLabelCache(this->map, img);
+#endif
+  return img;
+}
+
+/**
+ * Wraps (or converts) the raster drawn by the renderer into a QImage, and
+ * takes the ownership of the given mapserver image.
+ */
+QImage MapfileParser::toRawImage(imageObj * img) {
+  if (img == NULL) {
+    return QImage();
+  }
+
+  rasterBufferObj rb;
+  rendererVTableObj * renderer = MS_RENDERER_PLUGIN(img->format) ? MS_IMAGE_RENDERER(img) : NULL;
+
+  if ((! renderer) || (! renderer->getRasterBufferHandle)
+      || (renderer->getRasterBufferHandle(img, & rb) != MS_SUCCESS)
+      || (rb.type != MS_BUFFER_BYTE_RGBA)) {
+    // no raw access, falling back on the encoded image
+    int size = 0;
+    unsigned char * buffer = msSaveImageBuffer(img, & size, img->format);
+    msFreeImage(img);
+    QImage ret;
+    if (buffer) {
+      ret.loadFromData(buffer, size);
+      free(buffer);
+    }
+    return ret;
+  }
+
+  unsigned char * pixels = rb.data.rgba.pixels;
+  int pixelStep = rb.data.rgba.pixel_step;
+
+  // premultiplied 0xAARRGGBB words, in the host byte order
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+  bool argb32Layout = (rb.data.rgba.b == pixels)     && (rb.data.rgba.g == pixels + 1)
+                   && (rb.data.rgba.r == pixels + 2) && (rb.data.rgba.a == pixels + 3);
+#else
+  bool argb32Layout = (rb.data.rgba.a == pixels)     && (rb.data.rgba.r == pixels + 1)
+                   && (rb.data.rgba.g == pixels + 2) && (rb.data.rgba.b == pixels + 3);
+#endif
+
+  if ((pixelStep == 4) && argb32Layout) {
+#if QT_VERSION >= 0x050000
+    return QImage(pixels, rb.width, rb.height, rb.data.rgba.row_step,
+                  QImage::Format_ARGB32_Premultiplied, freeMapImage, img);
+#else
+    QImage ret = QImage(pixels, rb.width, rb.height, rb.data.rgba.row_step,
+                        QImage::Format_ARGB32_Premultiplied).copy();
+    msFreeImage(img);
+    return ret;
+#endif
+  }
+
+  // unusual layout, converting pixel by pixel
+  QImage ret(rb.width, rb.height, QImage::Format_ARGB32_Premultiplied);
+  for (unsigned int y = 0; y < rb.height; ++y) {
+    QRgb * line = (QRgb *) ret.scanLine(y);
+    int offset = y * rb.data.rgba.row_step;
+    for (unsigned int x = 0; x < rb.width; ++x, offset += pixelStep) {
+      line[x] = qRgba(rb.data.rgba.r[offset], rb.data.rgba.g[offset], rb.data.rgba.b[offset],
+                      rb.data.rgba.a ? rb.data.rgba.a[offset] : 0xff);
+    }
+  }
+  msFreeImage(img);
+  return ret;
+}
 
 bool MapfileParser::isNew()    { return (this->filename.isEmpty()); }
 bool MapfileParser::isLoaded() { return (this->map != NULL); }
 
+quint64 MapfileParser::getRevision() const { return this->revision; }
+void MapfileParser::bumpRevision()         { ++this->revision; }
+
+quint64 MapfileParser::getRenderRevision() const { return this->renderRevision; }
+void MapfileParser::bumpRenderRevision()         { ++this->renderRevision; }
+
 
 // Layers-related methods
 
+/**
+ * Gives all the layers wrappers, creating the missing ones. Prefer
+ * getLayerCount() / getLayer() when only some of them are needed.
+ */
 QList<Layer *> const & MapfileParser::getLayers() const {
+  for (int i = 0; i < layers.size(); ++i) {
+    getLayer(i);
+  }
   return layers;
 }
 
+int MapfileParser::getLayerCount() const {
+  return layers.size();
+}
+
+/**
+ * Gives the wrapper of the layer at the given index, creating it on first
+ * access.
+ */
+Layer * MapfileParser::getLayer(int index) const {
+  if ((index < 0) || (index >= layers.size())) {
+    return NULL;
+  }
+  if (! layers.at(index)) {
+    // Since the name is a pivot, we consider it as a special
+    // variable (this is the only thing we can almost consider
+    // as stable across user modifications).
+    layers[index] = new Layer(GET_LAYER(this->map, index)->name, this->map, this->layerIndex);
+  }
+  return layers.at(index);
+}
+
 QStringList const MapfileParser::getLayerList() const {
   QStringList ret = QStringList();
   for (int i = 0; i < layers.size(); ++i) {
-    ret << layers.at(i)->getName();
+    ret << QString(GET_LAYER(this->map, i)->name);
+  }
+  return ret;
+}
+
+/**
+ * Gives the drawing order of the layers, as indexes into getLayers().
+ */
+QList<int> MapfileParser::getLayerOrder() const {
+  QList<int> ret;
+  if (! this->map) {
+    return ret;
+  }
+  for (int i = 0; i < this->map->numlayers; ++i) {
+    ret << (this->map->layerorder ? this->map->layerorder[i] : i);
+  }
+  return ret;
+}
+
+/**
+ * Gives the status of the layer at the given index, -1 if there is no such
+ * layer. Unlike getLayer(), this does not create the wrapper.
+ */
+int MapfileParser::getLayerStatus(int index) const {
+  if ((! this->map) || (index < 0) || (index >= this->map->numlayers)) {
+    return -1;
+  }
+  return GET_LAYER(this->map, index)->status;
+}
+
+/**
+ * Gives the opacity of the layer at the given index (see
+ * Layer::getOpacity()), without creating its wrapper.
+ */
+int MapfileParser::getLayerOpacity(int index) const {
+  if ((! this->map) || (index < 0) || (index >= this->map->numlayers)) {
+    return -1;
+  }
+  layerObj * l = GET_LAYER(this->map, index);
+#if MS_VERSION_MAJOR < 7
+  return l->opacity;
+#else
+  return l->compositer ? l->compositer->opacity : -1;
+#endif
+}
+
+/**
+ * Tells if the drawing of the layer at the given index depends on the status
+ * of the other layers (REQUIRES / LABELREQUIRES expressions).
+ */
+bool MapfileParser::layerRequiresOthers(int index) const {
+  if ((! this->map) || (index < 0) || (index >= this->map->numlayers)) {
+    return false;
+  }
+  layerObj * l = GET_LAYER(this->map, index);
+  return ((l->requires && * l->requires) || (l->labelrequires && * l->labelrequires));
+}
+
+/**
+ * Gives the stamp identifying the drawing of the layer at the given index
+ * (see Layer::getRenderStamp()), without creating its wrapper: the layers
+ * which were never wrapped have not been modified since the mapfile was
+ * loaded, so their index is enough within a render revision.
+ */
+quint64 MapfileParser::getLayerRenderStamp(int index) const {
+  if ((index < 0) || (index >= layers.size())) {
+    return 0;
+  }
+  if (layers.at(index)) {
+    return layers.at(index)->getRenderStamp();
+  }
+  // the stamps of the wrappers never reach the high bit
+  return (Q_UINT64_C(1) << 63) | (quint64) index;
+}
+
+/**
+ * Gives the latest revision among the layers, which changes whenever any of
+ * them is modified (see Layer::getRevision()).
+ */
+quint64 MapfileParser::getLayersRevision() const {
+  quint64 ret = 0;
+  for (int i = 0; i < layers.size(); ++i) {
+    if (layers.at(i)) {
+      ret = qMax(ret, layers.at(i)->getRevision());
+    }
   }
   return ret;
 }
 
 bool MapfileParser::layerExists(QString const & key) {
-  for (int i = 0; i < layers.size(); ++i)
-    if (layers[i]->getName() == key)
-      return true;
-  return false;
+  return (getLayerIndex(key) != -1);
+}
+
+/**
+ * Returns the index of the layer named after the given key, -1 if there is
+ * no such layer.
+ */
+int MapfileParser::getLayerIndex(QString const & key) const {
+  return this->layerIndex->indexOf(key);
 }
 
 // creates a completely blank layer from scratch
@@ -220,8 +815,11 @@ Layer * MapfileParser::addLayer(const QString & layerName, bool isRaster) {
   newL->type = isRaster ? MS_LAYER_RASTER : MS_LAYER_POINT;
   this->map->layerorder[map->numlayers] = map->numlayers;
   this->map->numlayers++;
+  this->layerIndex->rebuild();
+  // the unwrapped layers are identified by their index, see getLayerRenderStamp()
+  this->bumpRenderRevision();
 
-  Layer * newLayer = new Layer(newL->name, this->map);
+  Layer * newLayer = new Layer(newL->name, this->map, this->layerIndex);
   layers  << newLayer;
   return newLayer;
 }
@@ -257,6 +855,10 @@ void MapfileParser::addLayer(QString const & layerName, QString const & dataStr,
 
   // inserts the layer at the end
   msInsertLayer(this->map, newLayer, -1);
+  this->layerIndex->rebuild();
+  this->bumpRenderRevision();
+
+  layers << new Layer(layerName, this->map, this->layerIndex);
 }
 
 /**
@@ -265,12 +867,16 @@ void MapfileParser::addLayer(QString const & layerName, QString const & dataStr,
  * This method is called in case of undo.
  */
 void MapfileParser::addLayer(Layer const * newL) {
-  layers << new Layer(* newL);
+  // the layer object is a new one, its previous drawings do not apply
+  // (the constructor gives it a new render stamp)
+  layers << new Layer(newL->getName(), this->map, this->layerIndex);
 
   layerObj * newLayerObj = msGrowMapLayers(this->map);
   initLayer(newLayerObj, this->map);
   newLayerObj->name = strdup(newL->getName().toStdString().c_str());
   msInsertLayer(this->map, newLayerObj, -1);
+  this->layerIndex->rebuild();
+  this->bumpRenderRevision();
   // TODO: need to copy the fields from newL to newLayerObj
 
 }
@@ -280,39 +886,23 @@ void MapfileParser::addLayer(Layer const * newL) {
  * is the same as in this->map->layers (this should be the case).
  */
 void MapfileParser::removeLayer(Layer const * l) {
-  int index = -1;
-  for (int i = 0; i < layers.size(); ++i) {
-    if (layers[i]->getName() == l->getName()) {
-      Layer * toRem = layers.takeAt(i);
-      delete toRem;
-      index = i;
-      break;
-    }
-  }
-
-  if (index == -1) {
-    return;
-  }
-
-  msRemoveLayer(this->map, index);
+  // l may be one of the wrappers deleted below
+  removeLayer(QString(l->getName()));
 }
 
 void MapfileParser::removeLayer(QString const & name) {
-  int index = -1;
-  for (int i = 0; i < layers.size(); ++i) {
-    if (layers[i]->getName() == name) {
-      Layer * toRem = layers.takeAt(i);
-      delete toRem;
-      index = i;
-      break;
-    }
-  }
+  int index = getLayerIndex(name);
 
-  if (index == -1) {
+  if ((index == -1) || (index >= layers.size())) {
     return;
   }
 
+  delete layers.takeAt(index);
   msRemoveLayer(this->map, index);
+  // the remaining wrappers will look up their layerObj again
+  this->layerIndex->rebuild();
+  // shifts the indexes identifying the unwrapped layers
+  this->bumpRenderRevision();
 }
 
 
@@ -391,11 +981,13 @@ void MapfileParser::setMapUnits(const QString & units) {
   if (this->map) {
     this->map->units = (enum MS_UNITS) this->units.indexOf(units);
   }
+  this->bumpRenderRevision();
 }
 void MapfileParser::setMapUnits(int const & units) {
   if (this->map) {
     this->map->units = (enum MS_UNITS) units;
   }
+  this->bumpRenderRevision();
 }
 
 
@@ -413,6 +1005,7 @@ void MapfileParser::setMapImageType(const QString & imageType) {
     free(this->map->imagetype);
   }
   this->map->imagetype = (char *) strdup(imageType.toStdString().c_str());
+  this->bumpRenderRevision();
 }
 
 //projection parameters
@@ -431,6 +1024,7 @@ void MapfileParser::setMapProjection(const QString & projection) {
     if (this->map) {
       msLoadProjectionStringEPSG(& (this->map->projection), projection.toStdString().c_str());
     }
+  this->bumpRenderRevision();
 }
 
 // Extent object parameters
@@ -536,6 +1130,7 @@ void MapfileParser::setConfigOption(const QString & name, const QString & value)
 
   configOptions[name] = value;
   insertIntoMsMap(& (this->map->configoptions), name, value);
+  this->bumpRenderRevision();
 }
 
 void MapfileParser::removeConfigOption(const QString & name) {
@@ -543,6 +1138,7 @@ void MapfileParser::removeConfigOption(const QString & name) {
     return;
   configOptions.remove(name);
   removeFromMsMap(& (this->map->configoptions), name);
+  this->bumpRenderRevision();
 }
 
 /**
@@ -564,6 +1160,9 @@ void MapfileParser::setMetadata(const QString & name, const QString & value) {
     return;
   this->metadatas[name] = value;
   insertIntoMsMap(& (this->map->web.metadata), name, value);
+  if (OgcRequests::isRequestKey(name)) {
+    this->updateEnabledRequests();
+  }
 }
 
 void MapfileParser::removeMetadata(const QString & name) {
@@ -571,80 +1170,66 @@ void MapfileParser::removeMetadata(const QString & name) {
     return;
   this->metadatas.remove(name);
   removeFromMsMap(& (this->map->web.metadata), name);
+  if (OgcRequests::isRequestKey(name)) {
+    this->updateEnabledRequests();
+  }
+}
+
+/**
+ * Parses the *_enable_request metadata, only when they are modified.
+ */
+void MapfileParser::updateEnabledRequests() {
+  for (int i = 0; i < OgcRequests::SERVICE_COUNT; ++i) {
+    this->enabledRequests[i] = OgcRequests::fromMetadata(this->metadatas, (OgcRequests::Service) i);
+  }
+}
+
+OgcRequests const & MapfileParser::getEnabledRequests(OgcRequests::Service service) const {
+  return this->enabledRequests[service];
+}
+
+/**
+ * Tells whether a request is enabled, for the whole map or for a layer (its
+ * own metadata taking precedence over the map ones).
+ */
+bool MapfileParser::isRequestEnabled(OgcRequests::Service service, OgcRequests::Request request,
+                                     Layer const * layer) const {
+  if (layer) {
+    return layer->getEnabledRequests(service).fallback(this->enabledRequests[service]).isEnabled(request);
+  }
+  return this->enabledRequests[service].isEnabled(request);
 }
 
 // WFS operations
 
 bool MapfileParser::wfsGetCapabilitiesEnabled() {
-  return (((this->metadatas.value("wfs_enable_request").contains("*") ||
-       (this->metadatas.value("wfs_enable_request").contains("GetCapabilities")))
-      && (! this->metadatas.value("wfs_enable_request").contains("!GetCapabilities")))
-    ||
-    ((this->metadatas.value("ows_enable_request").contains("*") ||
-       (this->metadatas.value("ows_enable_request").contains("GetCapabilities")))
-      && (! this->metadatas.value("ows_enable_request").contains("!GetCapabilities"))));
+  return isRequestEnabled(OgcRequests::WFS, OgcRequests::GET_CAPABILITIES);
 }
 
 bool MapfileParser::wfsGetFeatureEnabled() {
-  return (((this->metadatas.value("wfs_enable_request").contains("*") ||
-       (this->metadatas.value("wfs_enable_request").contains("GetFeature")))
-      && (! this->metadatas.value("wfs_enable_request").contains("!GetFeature")))
-    ||
-    ((this->metadatas.value("ows_enable_request").contains("*") ||
-       (this->metadatas.value("ows_enable_request").contains("GetFeature")))
-      && (! this->metadatas.value("ows_enable_request").contains("!GetFeature"))));
+  return isRequestEnabled(OgcRequests::WFS, OgcRequests::GET_FEATURE);
 }
 
 bool MapfileParser::wfsDescribeFeatureTypeEnabled() {
-  return (((this->metadatas.value("wfs_enable_request").contains("*") ||
-       (this->metadatas.value("wfs_enable_request").contains("DescribeFeatureType")))
-      && (! this->metadatas.value("wfs_enable_request").contains("!DescribeFeatureType")))
-    ||
-    ((this->metadatas.value("ows_enable_request").contains("*") ||
-       (this->metadatas.value("ows_enable_request").contains("DescribeFeatureType")))
-      && (! this->metadatas.value("ows_enable_request").contains("!DescribeFeatureType"))));
+  return isRequestEnabled(OgcRequests::WFS, OgcRequests::DESCRIBE_FEATURE_TYPE);
 }
 
 // WMS operations
 
 bool MapfileParser::wmsGetMapEnabled() {
-  return (((this->metadatas.value("wms_enable_request").contains("*") ||
-       (this->metadatas.value("wms_enable_request").contains("GetMap")))
-      && (! this->metadatas.value("wms_enable_request").contains("!GetMap")))
-    ||
-    ((this->metadatas.value("ows_enable_request").contains("*") ||
-       (this->metadatas.value("ows_enable_request").contains("GetMap")))
-      && (! this->metadatas.value("ows_enable_request").contains("!GetMap"))));
+  return isRequestEnabled(OgcRequests::WMS, OgcRequests::GET_MAP);
 }
 
 bool MapfileParser::wmsGetLegendGraphicEnabled() {
-  return (((this->metadatas.value("wms_enable_request").contains("*") ||
-       (this->metadatas.value("wms_enable_request").contains("GetLegendGraphic")))
-      && (! this->metadatas.value("wms_enable_request").contains("!GetLegendGraphic")))
-    ||
-    ((this->metadatas.value("ows_enable_request").contains("*") ||
-       (this->metadatas.value("ows_enable_request").contains("GetLegendGraphic")))
-      && (! this->metadatas.value("ows_enable_request").contains("!GetLegendGraphic"))));
+  return isRequestEnabled(OgcRequests::WMS, OgcRequests::GET_LEGEND_GRAPHIC);
 }
 
 bool MapfileParser::wmsGetCapabilitiesEnabled() {
-  return (((this->metadatas.value("wms_enable_request").contains("*") ||
-       (this->metadatas.value("wms_enable_request").contains("GetCapabilities")))
-      && (! this->metadatas.value("wms_enable_request").contains("!GetCapabilities")))
-    ||
-    ((this->metadatas.value("ows_enable_request").contains("*") ||
-       (this->metadatas.value("ows_enable_request").contains("GetCapabilities")))
-      && (! this->metadatas.value("ows_enable_request").contains("!GetCapabilities"))));
+  return isRequestEnabled(OgcRequests::WMS, OgcRequests::GET_CAPABILITIES);
 }
 
 bool MapfileParser::wmsGetFeatureInfoEnabled() {
-  return (((this->metadatas.value("wms_enable_request").contains("*") ||
-       (this->metadatas.value("wms_enable_request").contains("GetFeatureInfo")))
-      && (! this->metadatas.value("wms_enable_request").contains("!GetFeatureInfo")))
-    ||
-    ((this->metadatas.value("ows_enable_request").contains("*") ||
-       (this->metadatas.value("ows_enable_request").contains("GetFeatureInfo")))
-      && (! this->metadatas.value("ows_enable_request").contains("!GetFeatureInfo"))));
+  return isRequestEnabled(OgcRequests::WMS, OgcRequests::GET_FEATURE_INFO);
 }
 
 QString MapfileParser::getMetadataWmsTitle() {
@@ -710,6 +1295,7 @@ void MapfileParser::setShapepath(const QString & shapepath) {
         }
         this->map->shapepath = (char *) strdup(shapepath.toStdString().c_str());
     }
+  this->bumpRenderRevision();
 }
 
 QString const MapfileParser::getSymbolSet() const {
@@ -725,6 +1311,7 @@ void MapfileParser::setSymbolSet(const QString & symbolset) {
         }
         this->map->symbolset.filename = (char *) strdup(symbolset.toStdString().c_str());
     }
+  this->bumpRenderRevision();
 }
 
 QString const MapfileParser::getFontSet() const {
@@ -740,6 +1327,7 @@ void MapfileParser::setFontSet(const QString & fontset) {
         }
         this->map->fontset.filename = (char *) strdup(fontset.toStdString().c_str());
     }
+  this->bumpRenderRevision();
 }
 
 
@@ -753,6 +1341,7 @@ void MapfileParser::setResolution(const double & resolution) {
   if (this->map) {
     this->map->resolution = resolution;
   }
+  this->bumpRenderRevision();
 }
 
 double MapfileParser::getDefResolution() const {
@@ -765,6 +1354,7 @@ void MapfileParser::setDefResolution(const double & resolution) {
     if (this->map) {
         this->map->defresolution = resolution;
     }
+  this->bumpRenderRevision();
 }
 
 float MapfileParser::getAngle() const {
@@ -778,6 +1368,7 @@ void MapfileParser::setAngle(const float & angle) {
   if (this->map) {
     this->map->gt.rotation_angle = angle;
   }
+  this->bumpRenderRevision();
 }
 
 QString const MapfileParser::getTemplatePattern() const {
@@ -906,6 +1497,7 @@ void MapfileParser::removeOutputFormat(OutputFormat * const of) {
     }
   }
   msRemoveOutputFormat(this->map, of->getName().toStdString().c_str());
+  this->bumpRenderRevision();
 }
 
 void MapfileParser::updateOutputFormat(OutputFormat * const of) {
@@ -973,7 +1565,7 @@ void MapfileParser::updateOutputFormat(OutputFormat * const of) {
     msSetOutputFormatOption(msOf, fmtKeys[i].toStdString().c_str(),
                             fmtOpts[fmtKeys[i]].toStdString().c_str());
   }
-
+  this->bumpRenderRevision();
 }
 
 void MapfileParser::addOutputFormat(OutputFormat * const of) {
@@ -1012,6 +1604,7 @@ void MapfileParser::addOutputFormat(OutputFormat * const of) {
   // No idea why, but when calling msCreateDefaultOutputFormat(), the
   // created output format is considered "outside" of the mapfile.
   newMsOf->inmapfile = MS_TRUE;
+  this->bumpRenderRevision();
 }
 
 QString const MapfileParser::getDefaultOutputFormat() const {
@@ -1027,26 +1620,298 @@ void MapfileParser::setDefaultOutputFormat(QString const & of) {
     free(this->map->imagetype);
   }
   this->map->imagetype = strdup(of.toStdString().c_str());
+  this->bumpRenderRevision();
 }
 
+/**
+ * Saves the mapfile, replacing the destination file only once the whole
+ * text is written (see replaceFile()).
+ */
 bool MapfileParser::saveMapfile(const QString & filename) {
-  int ret = -1;
-  if (this->map) {
-    // mapfile is a new one ("create mapfile" action)
-    // filename argument should be "valid"  then
-    if (! filename.isEmpty()) {
-      ret = msSaveMap(this->map, (char *) filename.toStdString().c_str());
-    }
-    // using existing file (already existing mapfile loaded)
-    // ("save" action)
-    else if (! this->filename.isEmpty()) {
-      ret = msSaveMap(this->map, (char *) filename.toStdString().c_str());
+  if (! this->map)
+    return false;
+
+  // mapfile is a new one ("create mapfile" action)
+  // filename argument should be "valid"  then
+  QString path = filename;
+  // using existing file (already existing mapfile loaded)
+  // ("save" action)
+  if (path.isEmpty())
+    path = this->filename;
+  if (path.isEmpty())
+    return false;
+
+  // in place, the files of the mapfile may only need to be patched
+  if (path == this->filename) {
+    QHash<QString, QByteArray> files;
+    bool ret = getFilesToSave(files);
+    for (QHash<QString, QByteArray>::const_iterator it = files.constBegin(); ret && (it != files.constEnd()); ++it) {
+      ret = replaceFile(it.key(), it.value());
     }
+    if (ret)
+      setSaveSucceeded();
+    else
+      setSaveFailed();
+    return ret;
+  }
+
+  QByteArray text = getMapfileText();
+  if (text.isEmpty())
+    return false;
+  return replaceFile(path, text);
+}
+
+/**
+ * Keeps track of the items of the mapfile which are modified from now on,
+ * so that they are the only ones written when saving in place (see
+ * MapfilePatcher). To be called right after loading.
+ */
+bool MapfileParser::enableIncrementalSave() {
+  if ((! this->map) || this->filename.isEmpty())
+    return false;
+  delete this->patcher;
+  this->patcher = new MapfilePatcher(this->filename);
+  if (! this->patcher->setBaseline(getMapfileText())) {
+    qDebug() << "The layout of" << this->filename << "cannot be kept when saving";
+    delete this->patcher;
+    this->patcher = NULL;
+    return false;
+  }
+  return true;
+}
+
+bool MapfileParser::isIncrementalSaveEnabled() const {
+  return this->patcher && this->patcher->isValid();
+}
+
+/**
+ * Gives the content of the files to write to save the mapfile in place: the
+ * files where some items of the map changed (none if nothing changed).
+ * Returns false if the changes cannot be saved this way.
+ *
+ * The files are assumed to be written afterwards (see setSaveSucceeded()).
+ */
+bool MapfileParser::getPatchedFiles(QHash<QString, QByteArray> & files) {
+  files.clear();
+  if (! isIncrementalSaveEnabled())
+    return false;
+  QByteArray text = getMapfileText();
+  if (text.isEmpty())
+    return false;
+  return this->patcher->getPatches(text, files);
+}
+
+/**
+ * Gives the content of the files to write to save the mapfile in place: the
+ * patched files if possible (see getPatchedFiles()), the whole mapfile
+ * otherwise.
+ */
+bool MapfileParser::getFilesToSave(QHash<QString, QByteArray> & files, bool incremental) {
+  if (incremental && getPatchedFiles(files))
+    return true;
+  files.clear();
+  if (this->filename.isEmpty())
+    return false;
+  QByteArray text = getMapfileText();
+  if (text.isEmpty())
+    return false;
+  files.insert(this->filename, text);
+  if (this->patcher) {
+    this->patcher->setSaved(text);
+  }
+  return true;
+}
+
+/**
+ * Whether the mapfile is split into several files, which saving the whole
+ * mapfile would merge.
+ */
+bool MapfileParser::hasIncludes() const {
+  return this->patcher && this->patcher->hasIncludes();
+}
+
+/**
+ * All of the files given by getFilesToSave() are written.
+ */
+void MapfileParser::setSaveSucceeded() {
+  if (this->patcher) {
+    this->patcher->setWritten();
   }
-  return (ret == 0);
+}
+
+/**
+ * Some of the files given by getFilesToSave() could not be written: the
+ * changes since the last successful save are looked for again, in the files
+ * as they are on disk.
+ */
+void MapfileParser::setSaveFailed() {
+  if (this->patcher) {
+    this->patcher->setWriteFailed();
+  }
+}
+
+/**
+ * Replaces a file with the given content. The content is written into a
+ * temporary file of the same directory, synced and then renamed over the
+ * file, so that a crash leaves either the previous file or the new one.
+ */
+bool MapfileParser::replaceFile(QString const & path, QByteArray const & content) {
+#if QT_VERSION >= 0x050000
+  // QSaveFile syncs the data before renaming
+  QSaveFile file(path);
+  if (! file.open(QIODevice::WriteOnly))
+    return false;
+  if (file.write(content) != content.size()) {
+    file.cancelWriting();
+    return false;
+  }
+  if (! file.commit())
+    return false;
+#else
+  QFileInfo info(path);
+  QTemporaryFile file(info.absoluteDir().filePath(info.fileName() + ".XXXXXX"));
+  if (! file.open())
+    return false;
+  file.setPermissions(info.exists() ? info.permissions() :
+                      (QFile::ReadOwner | QFile::WriteOwner | QFile::ReadGroup | QFile::ReadOther));
+  if ((file.write(content) != content.size()) || (! file.flush()) || (fsync(file.handle()) != 0))
+    return false;
+  if (::rename(QFile::encodeName(file.fileName()).constData(), QFile::encodeName(path).constData()) != 0)
+    return false;
+  file.setAutoRemove(false);
+#endif
+
+  // the rename itself is durable once the directory is synced
+  int dir = open(QFile::encodeName(QFileInfo(path).absolutePath()).constData(), O_RDONLY);
+  if (dir != -1) {
+    fsync(dir);
+    close(dir);
+  }
+  return true;
+}
+
+// an anonymous file living in memory (Linux only), -1 if not available
+static int createMemoryFile() {
+#ifdef SYS_memfd_create
+  // MFD_CLOEXEC, not defined by the older C libraries
+  return syscall(SYS_memfd_create, "qmapfileeditor", 1);
+#else
+  return -1;
+#endif
+}
+
+// copies what remains of an opened file into a device
+static bool copyToDevice(int fd, QIODevice * out) {
+  char buffer[65536];
+  ssize_t n;
+  while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+    if (out->write(buffer, n) != n)
+      return false;
+  }
+  return (n == 0);
+}
+
+/**
+ * Writes the mapfile text into a device, e.g. a QBuffer.
+ *
+ * msWriteMapToString() redirects the standard output, which is not safe as
+ * soon as another thread writes to it, so msSaveMap() is given the path of
+ * an anonymous in-memory file instead (a temporary file where not
+ * available). The map object must not be modified meanwhile.
+ */
+bool MapfileParser::writeMapfile(QIODevice * out) const {
+  if ((! this->map) || (! out) || (! out->isWritable()))
+    return false;
+
+  // the errors of msSaveMap() are not thread-local with every Mapserver build
+  static QMutex saving;
+  QMutexLocker locker(& saving);
+
+  int fd = createMemoryFile();
+  if (fd != -1) {
+    QString path = QString("/proc/self/fd/%1").arg(fd);
+    bool ret = (msSaveMap(this->map, (char *) path.toStdString().c_str()) == 0)
+      && (lseek(fd, 0, SEEK_SET) == 0) && copyToDevice(fd, out);
+    close(fd);
+    return ret;
+  }
+
+  QTemporaryFile file;
+  if (! file.open())
+    return false;
+  if (msSaveMap(this->map, (char *) file.fileName().toStdString().c_str()) != 0)
+    return false;
+  // the file was written through another descriptor
+  return (lseek(file.handle(), 0, SEEK_SET) == 0) && copyToDevice(file.handle(), out);
+}
+
+/**
+ * Gives the mapfile text, e.g. for a preview, hashing or diffing. An empty
+ * array is returned on error.
+ */
+QByteArray MapfileParser::getMapfileText() const {
+  QByteArray ret;
+  QBuffer buffer(& ret);
+  buffer.open(QIODevice::WriteOnly);
+  if (! writeMapfile(& buffer))
+    return QByteArray();
+  return ret;
+}
+
+/**
+ * Gives a pre-parsed representation of the mapfile (see MapfileSnapshot).
+ * The layers are read from the map object, without creating their wrappers.
+ */
+MapfileSnapshot MapfileParser::getSnapshot() const {
+  MapfileSnapshot ret;
+  if (! this->map) {
+    return ret;
+  }
+
+  ret.mapName = getMapName();
+  ret.units = getMapUnits();
+  ret.minx = getMapExtentMinX();
+  ret.miny = getMapExtentMinY();
+  ret.maxx = getMapExtentMaxX();
+  ret.maxy = getMapExtentMaxY();
+  ret.projection = getMapProjection();
+  ret.metadatas = this->metadatas;
+
+  for (int i = 0; i < this->outputFormats.size(); ++i) {
+    OutputFormat * of = this->outputFormats.at(i);
+    OutputFormatSnapshot item;
+    item.name = of->getName();
+    item.mimeType = of->getMimeType();
+    item.driver = of->getDriver();
+    item.extension = of->getExtension();
+    item.imageMode = of->getImageMode();
+    item.transparent = of->getTransparent();
+    item.formatOptions = of->getFormatOptions();
+    ret.outputFormats << item;
+  }
+
+  for (int i = 0; i < this->map->numlayers; ++i) {
+    layerObj * l = GET_LAYER(this->map, i);
+    LayerSnapshot item;
+    item.name = l->name;
+    item.type = l->type;
+    item.status = l->status;
+    item.minx = l->extent.minx;
+    item.miny = l->extent.miny;
+    item.maxx = l->extent.maxx;
+    item.maxy = l->extent.maxy;
+    char * tmp = msGetProjectionString(& (l->projection));
+    item.projection = QString(tmp);
+    free(tmp);
+    ret.layers << item;
+  }
+  return ret;
 }
 
 MapfileParser::~MapfileParser() {
+  // copies of the layers wrappers may outlive the map object
+  this->layerIndex->detach();
+  delete this->patcher;
   if (this->map) {
     msFreeMap(this->map);
   }
@@ -31,6 +31,8 @@
 
 #include <QColor>
 #include <QHash>
+#include <QIODevice>
+#include <QImage>
 #include <QList>
 #include <QStringList>
 
@@ -39,11 +41,34 @@
 
 #include "outputformat.h"
 #include "layer.h"
+#include "mapfilepatcher.h"
+#include "mapfilesnapshot.h"
+#include "ogcrequests.h"
+
+/**
+ * Rendering statistics of a layer, see MapfileParser::profileCurrentMap().
+ */
+struct LayerProfile {
+  QString name;
+  // index into MapfileParser::getLayers(), LABELS for the labels drawing
+  int index;
+  // wall time, in microseconds
+  qint64 time;
+  // features read from the datasource, -1 if unknown
+  int features;
+  // bytes read by the drawing thread, -1 if unknown
+  qint64 bytesRead;
+  // labels put into the label cache
+  int labels;
+
+  static const int LABELS = -1;
+};
 
 class MapfileParser
 {
  public:
   MapfileParser(const QString & filename = "");
+  MapfileParser(MapfileParser const &);
   ~MapfileParser();
 
   QString const getMapName() const;
@@ -54,12 +79,21 @@ class MapfileParser
 
 
   QList<Layer *> const & getLayers(void) const;
+  int getLayerCount(void) const;
+  Layer * getLayer(int) const;
   QList<OutputFormat *> const & getOutputFormats(void) const;
   void addOutputFormat(OutputFormat * const of);
   void removeOutputFormat(OutputFormat * const of);
   void updateOutputFormat(OutputFormat * const of);
   OutputFormat * getOutputFormat(const QString &);
   QStringList const getLayerList() const;
+  QList<int> getLayerOrder() const;
+  // read from the mapserver layers, without creating the wrappers
+  int getLayerStatus(int) const;
+  int getLayerOpacity(int) const;
+  bool layerRequiresOthers(int) const;
+  quint64 getLayerRenderStamp(int) const;
+  quint64 getLayersRevision() const;
 
   QString const getDefaultOutputFormat(void) const;
   void setDefaultOutputFormat(QString const &);
@@ -92,8 +126,27 @@ class MapfileParser
 
   unsigned char * getCurrentMapImage(const int & width = -1, const int & height = -1);
   int const & getCurrentMapImageSize() const;
+  QImage getCurrentMapRawImage(const int & width = -1, const int & height = -1);
+  QImage getLayerRawImage(const int & index, const int & width, const int & height);
+  QImage getLabelsRawImage(const int & width, const int & height);
+  bool hasLabels() const;
+  QImage getCurrentMapDraftImage(const int & width, const int & height,
+                                 const int & reduction, const int & maxFeatures);
+  QList<LayerProfile> profileCurrentMap(const int & width, const int & height);
 
   bool saveMapfile(const QString & filename);
+  static bool replaceFile(QString const & path, QByteArray const & content);
+  bool writeMapfile(QIODevice * out) const;
+  QByteArray getMapfileText() const;
+  bool enableIncrementalSave();
+  bool isIncrementalSaveEnabled() const;
+  bool getPatchedFiles(QHash<QString, QByteArray> & files);
+  bool getFilesToSave(QHash<QString, QByteArray> & files, bool incremental = true);
+  bool hasIncludes() const;
+  void setSaveSucceeded();
+  void setSaveFailed();
+
+  MapfileSnapshot getSnapshot() const;
 
   int getDebug() const;
   void setDebug(const int & debug);
@@ -128,6 +181,9 @@ class MapfileParser
   bool wmsGetCapabilitiesEnabled();
   bool wmsGetFeatureInfoEnabled();
 
+  OgcRequests const & getEnabledRequests(OgcRequests::Service) const;
+  bool isRequestEnabled(OgcRequests::Service, OgcRequests::Request, Layer const * layer = NULL) const;
+
   QHash<QString, QString> const & getConfigOptions(void) const;
   QString const getConfigOption(const QString &) const;
   void setConfigOption(const QString & name, const QString & value);
@@ -153,6 +209,15 @@ class MapfileParser
   bool isLoaded();
   bool isNew();
 
+  // revision of the mapfile, incremented on each modification
+  // (undo / redo), used to identify the rendered previews.
+  quint64 getRevision() const;
+  void bumpRevision();
+
+  // revision of the map-level settings which affect the rendering of every
+  // layer (projection, symbolset, ...), see also Layer::getRenderStamp().
+  quint64 getRenderRevision() const;
+
   // Layer related methods
   // needed by the interface (+) on mainwindow
   Layer * addLayer(const QString &, bool);
@@ -161,6 +226,7 @@ class MapfileParser
   // needed by the QUndo Layer commands framework
   void addLayer(Layer const *);
   bool layerExists(QString const &);
+  int getLayerIndex(QString const &) const;
   void removeLayer(Layer const *);
   void removeLayer(QString const &);
   void updateLayer(Layer const &);
@@ -179,13 +245,30 @@ class MapfileParser
   static QStringList IMGdal;
 
  private:
+  // copies are made explicitly through the copy constructor only
+  MapfileParser & operator=(MapfileParser const &);
+
   // plain mapserver object
   struct mapObj * map = NULL;
 
   QString filename;
+  quint64 revision;
+  quint64 renderRevision;
   unsigned char * currentImageBuffer = NULL;
   int currentImageSize;
 
+  // locates the changes in the files of the mapfile, if enabled
+  MapfilePatcher * patcher = NULL;
+
+  struct imageObj * drawCurrentMap(const int & width, const int & height);
+  struct imageObj * drawLayer(const int & index, const int & width, const int & height);
+  struct imageObj * drawLabels(const int & width, const int & height);
+  static bool hasLabels(struct layerObj const *);
+  static QImage toRawImage(struct imageObj *);
+
+  void bumpRenderRevision();
+
+  void populateFromMs(void);
   QHash<QString, QString> populateMapFromMs(void *);
   void insertIntoMsMap(void *, const QString &, const QString &);
   void removeFromMsMap(void *, const QString &);
@@ -198,9 +281,13 @@ class MapfileParser
 
   // metadata
   QHash<QString,QString> metadatas;
+  // parsed *_enable_request metadata, per service
+  OgcRequests enabledRequests[OgcRequests::SERVICE_COUNT];
+  void updateEnabledRequests();
 
-  // Layers
-  QList<Layer *> layers;
+  // Layers (NULL until first accessed)
+  mutable QList<Layer *> layers;
+  QSharedPointer<LayerIndex> layerIndex;
 
 };
 
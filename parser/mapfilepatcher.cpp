@@ -0,0 +1,628 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QSet>
+
+#include <algorithm>
+
+#include "mapfilepatcher.h"
+
+namespace {
+
+struct Token {
+  int begin, end;
+  // upper-cased unquoted word, empty for strings, regexes and expressions
+  QByteArray word;
+};
+
+// splits a mapfile into tokens, skipping the comments
+class Tokenizer {
+ public:
+  Tokenizer(QByteArray const & data) : data(data), pos(0) {}
+
+  bool next(Token & t) {
+    int n = data.size();
+    while (pos < n) {
+      char c = data.at(pos);
+      if (isSpace(c)) {
+        ++pos;
+      } else if (c == '#') {
+        int eol = data.indexOf('\n', pos);
+        pos = (eol == -1) ? n : eol + 1;
+      } else if ((c == '/') && (pos + 1 < n) && (data.at(pos + 1) == '*')) {
+        int end = data.indexOf("*/", pos + 2);
+        pos = (end == -1) ? n : end + 2;
+      } else {
+        break;
+      }
+    }
+    if (pos >= n)
+      return false;
+
+    t.begin = pos;
+    t.word.clear();
+    char c = data.at(pos);
+    if ((c == '"') || (c == '\'') || (c == '/')) {
+      pos = skipQuoted(pos);
+      // case insensitive strings and regexes
+      if ((pos < n) && (data.at(pos) == 'i'))
+        ++pos;
+    } else if ((c == '(') || (c == '{') || (c == '[')) {
+      pos = skipBrackets(pos);
+    } else {
+      while ((pos < n) && (! isSpace(data.at(pos))) && (data.at(pos) != '"') && (data.at(pos) != '\'') && (data.at(pos) != '#'))
+        ++pos;
+      t.word = data.mid(t.begin, pos - t.begin).toUpper();
+    }
+    t.end = pos;
+    return true;
+  }
+
+  QByteArray text(Token const & t) const {
+    return data.mid(t.begin, t.end - t.begin);
+  }
+
+ private:
+  QByteArray const & data;
+  int pos;
+
+  static bool isSpace(char c) {
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+  }
+
+  // position following the closing delimiter
+  int skipQuoted(int from) const {
+    char delimiter = data.at(from);
+    int i = from + 1;
+    while (i < data.size()) {
+      if (data.at(i) == '\\')
+        i += 2;
+      else if (data.at(i++) == delimiter)
+        break;
+    }
+    return qMin(i, data.size());
+  }
+
+  int skipBrackets(int from) const {
+    char open = data.at(from);
+    char close = (open == '(') ? ')' : ((open == '{') ? '}' : ']');
+    int depth = 0, i = from;
+    while (i < data.size()) {
+      char c = data.at(i);
+      if ((c == '"') || (c == '\'')) {
+        i = skipQuoted(i);
+        continue;
+      }
+      ++i;
+      if (c == open)
+        ++depth;
+      else if ((c == close) && (--depth == 0))
+        break;
+    }
+    return i;
+  }
+};
+
+enum BlockKind { NO_BLOCK, BLOCK, OPAQUE_BLOCK };
+
+// whether a keyword opens a block, given the blocks it is in
+BlockKind blockKind(QByteArray const & word, QList<QByteArray> const & stack) {
+  static QSet<QByteArray> blocks = QSet<QByteArray>()
+    << "LAYER" << "CLASS" << "LABEL" << "WEB" << "OUTPUTFORMAT" << "LEGEND"
+    << "SCALEBAR" << "QUERYMAP" << "REFERENCE" << "FEATURE" << "JOIN" << "GRID"
+    << "CLUSTER" << "COMPOSITE" << "LEADER" << "SCALETOKEN";
+  // their content is not made of keywords
+  static QSet<QByteArray> opaque = QSet<QByteArray>()
+    << "METADATA" << "VALIDATION" << "PROJECTION" << "POINTS" << "PATTERN" << "VALUES";
+
+  if (stack.isEmpty())
+    return (word == "MAP") ? BLOCK : NO_BLOCK;
+  QByteArray const & parent = stack.last();
+  // STYLE and SYMBOL are also values
+  if (word == "STYLE")
+    return ((parent == "SCALEBAR") || (parent == "QUERYMAP")) ? NO_BLOCK : BLOCK;
+  if (word == "SYMBOL")
+    return (parent == "MAP") ? BLOCK : NO_BLOCK;
+  if (blocks.contains(word))
+    return BLOCK;
+  if (opaque.contains(word))
+    return OPAQUE_BLOCK;
+  return NO_BLOCK;
+}
+
+QByteArray unquote(QByteArray const & s) {
+  if ((s.size() >= 2) && ((s.at(0) == '"') || (s.at(0) == '\'')))
+    return s.mid(1, s.size() - 2);
+  return s;
+}
+
+// the keywords of the map, which end the values of the previous one
+bool isMapKeyword(QByteArray const & word) {
+  static QSet<QByteArray> keywords = QSet<QByteArray>()
+    << "NAME" << "STATUS" << "EXTENT" << "SIZE" << "MAXSIZE" << "UNITS" << "ANGLE"
+    << "RESOLUTION" << "DEFRESOLUTION" << "IMAGECOLOR" << "IMAGETYPE" << "IMAGEQUALITY"
+    << "INTERLACE" << "TRANSPARENT" << "SHAPEPATH" << "SYMBOLSET" << "FONTSET"
+    << "TEMPLATEPATTERN" << "DATAPATTERN" << "DEBUG" << "CONFIG";
+  return keywords.contains(word);
+}
+
+// walks through a mapfile and its includes, collecting the items of the map
+class Scanner {
+ public:
+  Scanner(QString const & mapfileDir, QList<MapfilePatcher::Item> & items, QHash<QString, QByteArray> * sources)
+    : mapfileDir(mapfileDir), items(items), sources(sources), depth(0), opened(false), statement(false) {}
+
+  bool scan(QString const & file, QByteArray const & data) {
+    // same limit as Mapserver
+    if (++depth > 5)
+      return false;
+
+    Tokenizer tokenizer(data);
+    Token t;
+    bool expectName = false, expectInclude = false;
+    while (tokenizer.next(t)) {
+      if (expectInclude) {
+        expectInclude = false;
+        if ((! t.word.isEmpty()) || (! include(tokenizer.text(t))))
+          return false;
+        continue;
+      }
+      // the values of a keyword are on its line
+      if (statement) {
+        if ((data.lastIndexOf('\n', t.begin) < current.begin) && (! endsStatement(t.word))) {
+          if (current.key == "CONFIG")
+            current.key += " " + QString::fromUtf8(unquote(tokenizer.text(t)));
+          current.end = t.end;
+          continue;
+        }
+        statement = false;
+        items << current;
+      }
+      if (expectName) {
+        expectName = false;
+        current.key += " " + QString::fromUtf8(unquote(tokenizer.text(t)));
+        continue;
+      }
+      if (t.word.isEmpty())
+        continue;
+
+      // opaque blocks only end
+      if ((! stack.isEmpty()) && (blockKind(stack.last(), stack.mid(0, stack.size() - 1)) == OPAQUE_BLOCK)) {
+        if (t.word == "END")
+          end(file, t);
+        continue;
+      }
+
+      if (t.word == "INCLUDE") {
+        expectInclude = true;
+      } else if (t.word == "END") {
+        if (stack.isEmpty())
+          return false;
+        end(file, t);
+      } else if (blockKind(t.word, stack) != NO_BLOCK) {
+        if (stack.size() == 1) {
+          opened = true;
+          start(file, t, true);
+        }
+        stack << t.word;
+      } else if (stack.size() == 1) {
+        statement = true;
+        start(file, t, false);
+      } else if (opened && (stack.size() == 2) && (t.word == "NAME") && (stack.last() != "WEB")) {
+        expectName = true;
+      }
+    }
+    // a keyword does not go on in the file including this one
+    if (statement) {
+      statement = false;
+      items << current;
+    }
+    --depth;
+    return true;
+  }
+
+  bool isComplete() const {
+    return stack.isEmpty() && (! opened);
+  }
+
+ private:
+  QString mapfileDir;
+  QList<MapfilePatcher::Item> & items;
+  QHash<QString, QByteArray> * sources;
+  int depth;
+  QList<QByteArray> stack;
+  // a block or a keyword of the map is being read
+  bool opened, statement;
+  MapfilePatcher::Item current;
+
+  bool endsStatement(QByteArray const & word) const {
+    return (! word.isEmpty()) && ((word == "END") || (word == "INCLUDE") || isMapKeyword(word)
+                                  || (blockKind(word, stack) != NO_BLOCK));
+  }
+
+  void start(QString const & file, Token const & t, bool block) {
+    current.key = QString::fromLatin1(t.word);
+    current.file = file;
+    current.begin = t.begin;
+    current.end = t.end;
+    current.block = block;
+  }
+
+  void end(QString const & file, Token const & t) {
+    stack.removeLast();
+    if (opened && (stack.size() == 1)) {
+      opened = false;
+      current.end = t.end;
+      if (current.file != file)
+        current.file.clear();
+      items << current;
+    }
+  }
+
+  // as in msLoadMap(), relative to the directory of the mapfile
+  bool include(QByteArray const & name) {
+    if (! sources)
+      return false;
+    QString path = QFileInfo(QDir(mapfileDir), QString::fromUtf8(unquote(name))).absoluteFilePath();
+    if (! sources->contains(path)) {
+      QFile f(path);
+      if (! f.open(QIODevice::ReadOnly))
+        return false;
+      sources->insert(path, f.readAll());
+    }
+    return scan(path, sources->value(path));
+  }
+};
+
+int lineStart(QByteArray const & data, int pos) {
+  return (pos > 0) ? data.lastIndexOf('\n', pos - 1) + 1 : 0;
+}
+
+// leading whitespace of the line where a position is, if nothing else
+QByteArray indentationAt(QByteArray const & data, int pos) {
+  int start = lineStart(data, pos);
+  QByteArray ret = data.mid(start, pos - start);
+  return (ret.trimmed().isEmpty()) ? ret : QByteArray();
+}
+
+// gives the lines following the first one another indentation
+QByteArray reindent(QByteArray const & item, QByteArray const & from, QByteArray const & to,
+                    QByteArray const & eol) {
+  QList<QByteArray> lines = item.split('\n');
+  for (int i = 1; i < lines.size(); ++i) {
+    if (lines.at(i).startsWith(from))
+      lines[i] = to + lines.at(i).mid(from.size());
+    else
+      lines[i] = to + lines.at(i);
+  }
+  return lines.join(eol);
+}
+
+QByteArray removeItems(QByteArray const & text, QList<MapfilePatcher::Item> const & items) {
+  QByteArray ret;
+  int pos = 0;
+  for (int i = 0; i < items.size(); ++i) {
+    ret += text.mid(pos, items.at(i).begin - pos);
+    pos = items.at(i).end;
+  }
+  ret += text.mid(pos);
+  return ret.simplified();
+}
+
+QByteArray eolOf(QByteArray const & data) {
+  return data.contains("\r\n") ? "\r\n" : "\n";
+}
+
+// "LAYER" for "LAYER roads#2"
+QString kindOf(MapfilePatcher::Item const & item) {
+  int n = item.key.indexOf(QRegExp("[ #]"));
+  return (n == -1) ? item.key : item.key.left(n);
+}
+
+// the items located in the files closest to an item, before and after it,
+// of the given kind if any
+void neighbours(QList<MapfilePatcher::Item> const & items, QList<int> const & located,
+                QList<MapfilePatcher::Item> const & sourceItems, int item, QString const & kind,
+                int & previous, int & next) {
+  previous = next = -1;
+  for (int i = item - 1; (previous == -1) && (i >= 0); --i) {
+    if ((located.at(i) != -1) && (! sourceItems.at(located.at(i)).file.isEmpty())
+        && (kind.isEmpty() || (kindOf(items.at(i)) == kind)))
+      previous = located.at(i);
+  }
+  for (int i = item + 1; (next == -1) && (i < items.size()); ++i) {
+    if ((located.at(i) != -1) && (! sourceItems.at(located.at(i)).file.isEmpty())
+        && (kind.isEmpty() || (kindOf(items.at(i)) == kind)))
+      next = located.at(i);
+  }
+}
+
+// a part of a file replaced by a text
+struct Edit {
+  int begin, end;
+  QByteArray text;
+};
+
+Edit makeEdit(int begin, int end, QByteArray const & text) {
+  Edit e;
+  e.begin = begin;
+  e.end = end;
+  e.text = text;
+  return e;
+}
+
+} // namespace
+
+MapfilePatcher::MapfilePatcher(QString const & mapfilePath) :
+    mapfilePath(QFileInfo(mapfilePath).absoluteFilePath()), valid(false), reread(false) {}
+
+/**
+ * Scans a mapfile for the items of the map. The files included are read into
+ * sources, unless already there; without sources, INCLUDEs are not allowed.
+ *
+ * An item found several times is told apart by its rank ("LAYER roads#2"), a
+ * keyword repeated cannot be located at all (the last one wins).
+ */
+bool MapfilePatcher::scan(QString const & file, QByteArray const & data, QList<Item> & items,
+                          QHash<QString, QByteArray> * sources) {
+  items.clear();
+  Scanner scanner(QFileInfo(file).absolutePath(), items, sources);
+  if (! (scanner.scan(file, data) && scanner.isComplete()))
+    return false;
+
+  QHash<QString, int> count;
+  for (int i = 0; i < items.size(); ++i)
+    ++count[items.at(i).key];
+  QHash<QString, int> rank;
+  for (int i = 0; i < items.size(); ++i) {
+    Item & item = items[i];
+    if (count.value(item.key) == 1)
+      continue;
+    if (! item.block)
+      item.file.clear();
+    int n = ++rank[item.key];
+    if (n > 1)
+      item.key += QString("#%1").arg(n);
+  }
+  return true;
+}
+
+/**
+ * Records the text of the mapfile as read from its files (see
+ * MapfileParser::enableIncrementalSave()).
+ */
+bool MapfilePatcher::setBaseline(QByteArray const & text) {
+  QList<Item> items;
+  this->baseline = this->written = text;
+  this->reread = false;
+  this->valid = scan(QString(), text, items) && readSources();
+  return this->valid;
+}
+
+/**
+ * The whole text is being written into the mapfile, which has no INCLUDE
+ * anymore.
+ */
+void MapfilePatcher::setSaved(QByteArray const & text) {
+  this->sources.clear();
+  this->sources.insert(this->mapfilePath, text);
+
+  QList<Item> items;
+  this->baseline = text;
+  this->reread = false;
+  this->valid = scan(QString(), text, items) && rescanSources();
+}
+
+/**
+ * The files given by the last patches (or setSaved()) are all written.
+ */
+void MapfilePatcher::setWritten() {
+  this->written = this->baseline;
+}
+
+/**
+ * Some of the files could not be written: the changes since the last write
+ * are looked for again, in the files as they are then.
+ */
+void MapfilePatcher::setWriteFailed() {
+  this->baseline = this->written;
+  this->reread = true;
+}
+
+bool MapfilePatcher::isValid() const {
+  return this->valid;
+}
+
+bool MapfilePatcher::hasIncludes() const {
+  return this->sources.size() > 1;
+}
+
+bool MapfilePatcher::readSources() {
+  this->sources.clear();
+  QFile f(this->mapfilePath);
+  if (! f.open(QIODevice::ReadOnly))
+    return false;
+  this->sources.insert(this->mapfilePath, f.readAll());
+  return rescanSources();
+}
+
+bool MapfilePatcher::rescanSources() {
+  this->sourceIndex.clear();
+  if (! scan(this->mapfilePath, this->sources.value(this->mapfilePath), this->sourceItems, & this->sources))
+    return false;
+  for (int i = 0; i < this->sourceItems.size(); ++i)
+    this->sourceIndex.insert(this->sourceItems.at(i).key, i);
+  return true;
+}
+
+/**
+ * Gives the new content of the files to write for the mapfile to match the
+ * given text (none if nothing changed), and takes it as the new baseline.
+ *
+ * Returns false, leaving everything as is, if some changes cannot be located
+ * in the files, or would move items around.
+ */
+bool MapfilePatcher::getPatches(QByteArray const & text, QHash<QString, QByteArray> & patches) {
+  patches.clear();
+  if (this->reread) {
+    this->reread = false;
+    this->valid = readSources();
+  }
+  if (! this->valid)
+    return false;
+
+  QList<Item> items, baselineItems;
+  if ((! scan(QString(), text, items)) || (! scan(QString(), this->baseline, baselineItems)))
+    return false;
+  if (removeItems(text, items) != removeItems(this->baseline, baselineItems))
+    return false;
+
+  QHash<QString, QByteArray> before;
+  for (int i = 0; i < baselineItems.size(); ++i) {
+    Item const & b = baselineItems.at(i);
+    before.insert(b.key, this->baseline.mid(b.begin, b.end - b.begin));
+  }
+
+  // where the items are in the files, if they are
+  QList<int> located;
+  QSet<QString> keys;
+  for (int i = 0; i < items.size(); ++i) {
+    located << this->sourceIndex.value(items.at(i).key, -1);
+    keys << items.at(i).key;
+  }
+  // the blocks of a kind stay in the same order (e.g. the layers)
+  QHash<QString, int> last;
+  for (int i = 0; i < items.size(); ++i) {
+    int index = located.at(i);
+    if ((index == -1) || (! items.at(i).block) || this->sourceItems.at(index).file.isEmpty())
+      continue;
+    QString kind = kindOf(items.at(i));
+    if (last.value(kind, -1) > index)
+      return false;
+    last.insert(kind, index);
+  }
+
+  // edits of each file, in the order of the items
+  QHash<QString, QList<Edit> > edits;
+  for (int i = 0; i < items.size(); ++i) {
+    Item const & item = items.at(i);
+    QByteArray content = text.mid(item.begin, item.end - item.begin);
+    QByteArray from = indentationAt(text, item.begin);
+    bool changed = (! before.contains(item.key)) || (before.value(item.key) != content);
+
+    if (located.at(i) != -1) {
+      Item const & source = this->sourceItems.at(located.at(i));
+      if (source.file.isEmpty()) {
+        if (changed)
+          return false;
+        continue;
+      }
+      // the item is given the indentation of the one it replaces
+      if (changed) {
+        QByteArray const & data = this->sources[source.file];
+        edits[source.file] << makeEdit(source.begin, source.end,
+            reindent(content, from, indentationAt(data, source.begin), eolOf(data)));
+      }
+      continue;
+    }
+    // unchanged, hence not in the files on purpose (e.g. a default value)
+    if (! changed)
+      continue;
+
+    // a new block goes next to the others of its kind, a new item next to
+    // any other
+    int previous = -1, next = -1;
+    if (item.block)
+      neighbours(items, located, this->sourceItems, i, kindOf(item), previous, next);
+    if ((previous == -1) && (next == -1))
+      neighbours(items, located, this->sourceItems, i, QString(), previous, next);
+    if (previous != -1) {
+      Item const & source = this->sourceItems.at(previous);
+      QByteArray const & data = this->sources[source.file];
+      QByteArray eol = eolOf(data), indentation = indentationAt(data, source.begin);
+      edits[source.file] << makeEdit(source.end, source.end,
+          eol + indentation + reindent(content, from, indentation, eol));
+    } else if (next != -1) {
+      Item const & source = this->sourceItems.at(next);
+      QByteArray const & data = this->sources[source.file];
+      QByteArray eol = eolOf(data), indentation = indentationAt(data, source.begin);
+      edits[source.file] << makeEdit(source.begin, source.begin,
+          reindent(content, from, indentation, eol) + eol + indentation);
+    } else {
+      return false;
+    }
+  }
+
+  // the items removed, with their lines if nothing else is on them
+  for (int i = 0; i < baselineItems.size(); ++i) {
+    QString const & key = baselineItems.at(i).key;
+    int index = this->sourceIndex.value(key, -1);
+    if (keys.contains(key) || (index == -1))
+      continue;
+    Item const & removed = this->sourceItems.at(index);
+    if (removed.file.isEmpty())
+      return false;
+    QByteArray const & data = this->sources[removed.file];
+    int begin = lineStart(data, removed.begin);
+    int end = data.indexOf('\n', removed.end);
+    end = (end == -1) ? data.size() : end + 1;
+    if ((! data.mid(begin, removed.begin - begin).trimmed().isEmpty())
+        || (! data.mid(removed.end, end - removed.end).trimmed().isEmpty())) {
+      begin = removed.begin;
+      end = removed.end;
+    }
+    edits[removed.file] << makeEdit(begin, end, QByteArray());
+  }
+
+  // from the end of each file, so that the positions stay valid
+  QHash<QString, QByteArray> patched = this->sources;
+  foreach (QString const & file, edits.keys()) {
+    QList<Edit> const & list = edits[file];
+    QList<QPair<int, int> > order;
+    for (int i = 0; i < list.size(); ++i)
+      order << qMakePair(list.at(i).begin, i);
+    std::sort(order.begin(), order.end());
+    QByteArray content = patched.value(file);
+    for (int i = order.size() - 1; i >= 0; --i) {
+      Edit const & e = list.at(order.at(i).second);
+      if ((i > 0) && (list.at(order.at(i - 1).second).end > e.begin))
+        return false;
+      content.replace(e.begin, e.end - e.begin, e.text);
+    }
+    patched.insert(file, content);
+    patches.insert(file, content);
+  }
+
+  this->sources = patched;
+  this->baseline = text;
+  this->valid = rescanSources();
+  return true;
+}
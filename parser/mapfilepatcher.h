@@ -0,0 +1,98 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#ifndef MAPFILEPATCHER_H
+#define MAPFILEPATCHER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+/**
+ * Saves the changes of a mapfile by rewriting only the items of the map which
+ * changed in the files they come from: its blocks (LAYER, OUTPUTFORMAT, WEB,
+ * ...) and its keywords with their values (NAME, EXTENT, SIZE, ...). The
+ * INCLUDE structure, the comments and the layout of everything else are left
+ * untouched.
+ *
+ * The items which changed are found by comparing the text written by
+ * msSaveMap() (see MapfileParser::getMapfileText()) with the one of the
+ * mapfile as it was read, the baseline. A new item is inserted after the one
+ * preceding it, a removed one is deleted. Other changes (e.g. layers moved
+ * around) cannot be saved this way: the whole mapfile has to be written then.
+ */
+class MapfilePatcher {
+
+ public:
+  MapfilePatcher(QString const & mapfilePath);
+
+  bool setBaseline(QByteArray const & text);
+  void setSaved(QByteArray const & text);
+  void setWritten();
+  void setWriteFailed();
+  bool isValid() const;
+  bool hasIncludes() const;
+
+  bool getPatches(QByteArray const & text, QHash<QString, QByteArray> & patches);
+
+  // an item of the map: a block, e.g. "LAYER countries" or "WEB", or a
+  // keyword with its values, e.g. "EXTENT" or "CONFIG MS_ERRORFILE"
+  struct Item {
+    QString key;
+    // empty if the item does not start and end in the same file, or is
+    // repeated
+    QString file;
+    int begin, end;
+    bool block;
+  };
+
+  static bool scan(QString const & file, QByteArray const & data, QList<Item> & items,
+                   QHash<QString, QByteArray> * sources = NULL);
+
+ private:
+  QString mapfilePath;
+  bool valid;
+  // the files are to be read again before being patched
+  bool reread;
+
+  // content of the files of the mapfile, as last read or written
+  QHash<QString, QByteArray> sources;
+  // their items, in the order of the mapfile
+  QList<Item> sourceItems;
+  QHash<QString, int> sourceIndex;
+
+  // the text the files match, and the one they are known to match once
+  // written
+  QByteArray baseline;
+  QByteArray written;
+
+  bool readSources();
+  bool rescanSources();
+};
+
+#endif // MAPFILEPATCHER_H
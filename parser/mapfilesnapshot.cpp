@@ -0,0 +1,194 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+
+#include "mapfilesnapshot.h"
+
+// "QMES", identifies the snapshot files
+static const quint32 SNAPSHOT_MAGIC = 0x514d4553;
+
+const quint32 MapfileSnapshot::VERSION = 1;
+
+MapfileSnapshot::MapfileSnapshot() : units(-1), minx(0), miny(0), maxx(0), maxy(0) {}
+
+bool MapfileSnapshot::isValid() const {
+  return (! mapName.isNull()) || (! layers.isEmpty());
+}
+
+QDataStream & operator<<(QDataStream & out, LayerSnapshot const & l) {
+  out << l.name << (qint32) l.type << (qint32) l.status
+      << l.minx << l.miny << l.maxx << l.maxy << l.projection;
+  return out;
+}
+
+QDataStream & operator>>(QDataStream & in, LayerSnapshot & l) {
+  qint32 type, status;
+  in >> l.name >> type >> status
+     >> l.minx >> l.miny >> l.maxx >> l.maxy >> l.projection;
+  l.type = type;
+  l.status = status;
+  return in;
+}
+
+QDataStream & operator<<(QDataStream & out, OutputFormatSnapshot const & of) {
+  out << of.name << of.mimeType << of.driver << of.extension
+      << (qint32) of.imageMode << of.transparent << of.formatOptions;
+  return out;
+}
+
+QDataStream & operator>>(QDataStream & in, OutputFormatSnapshot & of) {
+  qint32 imageMode;
+  in >> of.name >> of.mimeType >> of.driver >> of.extension
+     >> imageMode >> of.transparent >> of.formatOptions;
+  of.imageMode = imageMode;
+  return in;
+}
+
+QDataStream & operator<<(QDataStream & out, MapfileSnapshot const & s) {
+  out << s.mapName << (qint32) s.units << s.minx << s.miny << s.maxx << s.maxy
+      << s.projection << s.metadatas << s.outputFormats << s.layers;
+  return out;
+}
+
+QDataStream & operator>>(QDataStream & in, MapfileSnapshot & s) {
+  qint32 units;
+  in >> s.mapName >> units >> s.minx >> s.miny >> s.maxx >> s.maxy
+     >> s.projection >> s.metadatas >> s.outputFormats >> s.layers;
+  s.units = units;
+  return in;
+}
+
+SnapshotCache::SnapshotCache(QString const & directory, int maxEntries) :
+  directory(directory), maxEntries(qMax(maxEntries, 1)) {}
+
+QString const & SnapshotCache::getDirectory() const {
+  return directory;
+}
+
+int SnapshotCache::getMaxEntries() const {
+  return maxEntries;
+}
+
+QString SnapshotCache::defaultDirectory() {
+#if QT_VERSION >= 0x050000
+  QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+  QString base = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+  return QDir(base).absoluteFilePath("snapshots");
+}
+
+QString SnapshotCache::entryPath(QByteArray const & key) const {
+  return QDir(directory).absoluteFilePath(QString::fromLatin1(key.toHex()) + ".snapshot");
+}
+
+bool SnapshotCache::load(QByteArray const & key, MapfileSnapshot & snapshot) const {
+  QFile file(entryPath(key));
+  if (! file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  QDataStream in(& file);
+  quint32 magic, version;
+  in >> magic >> version;
+  if ((magic != SNAPSHOT_MAGIC) || (version != MapfileSnapshot::VERSION)) {
+    return false;
+  }
+  in.setVersion(QDataStream::Qt_4_6);
+
+  MapfileSnapshot read;
+  in >> read;
+  if (in.status() != QDataStream::Ok) {
+    return false;
+  }
+  snapshot = read;
+  return true;
+}
+
+/**
+ * Stores the snapshot, replacing the previous entry. It is written aside
+ * then renamed, so that a reader never sees a partially written one.
+ */
+bool SnapshotCache::store(QByteArray const & key, MapfileSnapshot const & snapshot) const {
+  if (! QDir().mkpath(directory)) {
+    return false;
+  }
+
+  QTemporaryFile file(QDir(directory).absoluteFilePath("XXXXXX.tmp"));
+  if (! file.open()) {
+    return false;
+  }
+
+  QDataStream out(& file);
+  out << SNAPSHOT_MAGIC << MapfileSnapshot::VERSION;
+  out.setVersion(QDataStream::Qt_4_6);
+  out << snapshot;
+  if ((out.status() != QDataStream::Ok) || (! file.flush())) {
+    return false;
+  }
+
+  QString path = entryPath(key);
+  QFile::remove(path);
+  if (! file.rename(path)) {
+    return false;
+  }
+  file.setAutoRemove(false);
+  evict(path);
+  return true;
+}
+
+/**
+ * Removes the entries written the longest ago beyond maxEntries, the one
+ * just stored being kept whatever the resolution of the file times.
+ */
+void SnapshotCache::evict(QString const & kept) const {
+  // the most recent first
+  QFileInfoList entries = QDir(directory).entryInfoList(QStringList() << "*.snapshot",
+                                                        QDir::Files, QDir::Time);
+  int count = 1;
+  for (int i = 0; i < entries.size(); ++i) {
+    QString path = entries.at(i).absoluteFilePath();
+    if (path == kept) {
+      continue;
+    }
+    if (count < maxEntries) {
+      ++count;
+    } else {
+      QFile::remove(path);
+    }
+  }
+}
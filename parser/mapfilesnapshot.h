@@ -0,0 +1,112 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#ifndef MAPFILESNAPSHOT_H
+#define MAPFILESNAPSHOT_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+/**
+ * Compact, pre-parsed representation of a mapfile: what is needed to display
+ * its structure (layers tree, main settings) without waiting for msLoadMap().
+ *
+ * Snapshots are stored on disk by SnapshotCache, keyed by the content hash of
+ * the mapfile and of every file it includes (see MapfileLoader).
+ */
+struct LayerSnapshot {
+  QString name;
+  int type;
+  int status;
+  double minx, miny, maxx, maxy;
+  QString projection;
+};
+
+struct OutputFormatSnapshot {
+  QString name;
+  QString mimeType;
+  QString driver;
+  QString extension;
+  int imageMode;
+  bool transparent;
+  QHash<QString, QString> formatOptions;
+};
+
+struct MapfileSnapshot {
+  MapfileSnapshot();
+
+  bool isValid() const;
+
+  QString mapName;
+  int units;
+  double minx, miny, maxx, maxy;
+  QString projection;
+  QHash<QString, QString> metadatas;
+  QList<OutputFormatSnapshot> outputFormats;
+  QList<LayerSnapshot> layers;
+
+  // bumped each time the stream format changes
+  static const quint32 VERSION;
+};
+
+QDataStream & operator<<(QDataStream &, LayerSnapshot const &);
+QDataStream & operator>>(QDataStream &, LayerSnapshot &);
+QDataStream & operator<<(QDataStream &, OutputFormatSnapshot const &);
+QDataStream & operator>>(QDataStream &, OutputFormatSnapshot &);
+QDataStream & operator<<(QDataStream &, MapfileSnapshot const &);
+QDataStream & operator>>(QDataStream &, MapfileSnapshot &);
+
+/**
+ * Directory of snapshots, one file per key (the hex encoded content hash).
+ * Unreadable, outdated or corrupted entries are simply considered missing.
+ * At most maxEntries are kept, the oldest ones being removed on store().
+ */
+class SnapshotCache {
+  public:
+    SnapshotCache(QString const & directory = defaultDirectory(), int maxEntries = DEFAULT_MAX_ENTRIES);
+
+    bool load(QByteArray const & key, MapfileSnapshot &) const;
+    bool store(QByteArray const & key, MapfileSnapshot const &) const;
+
+    QString const & getDirectory() const;
+    int getMaxEntries() const;
+    static QString defaultDirectory();
+
+    static const int DEFAULT_MAX_ENTRIES = 64;
+
+  private:
+    QString entryPath(QByteArray const & key) const;
+    void evict(QString const & kept) const;
+
+    QString directory;
+    int maxEntries;
+};
+
+#endif // MAPFILESNAPSHOT_H
@@ -0,0 +1,110 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#include <QStringList>
+
+#include "ogcrequests.h"
+
+OgcRequests::OgcRequests() : enabled(0), specified(0) {}
+
+static QHash<QString, quint32> requestMasks() {
+  QHash<QString, quint32> ret;
+  ret.insert("getcapabilities",     OgcRequests::GET_CAPABILITIES);
+  ret.insert("getmap",              OgcRequests::GET_MAP);
+  ret.insert("getfeatureinfo",      OgcRequests::GET_FEATURE_INFO);
+  ret.insert("getlegendgraphic",    OgcRequests::GET_LEGEND_GRAPHIC);
+  ret.insert("getstyles",           OgcRequests::GET_STYLES);
+  ret.insert("describelayer",       OgcRequests::DESCRIBE_LAYER);
+  ret.insert("getfeature",          OgcRequests::GET_FEATURE);
+  ret.insert("describefeaturetype", OgcRequests::DESCRIBE_FEATURE_TYPE);
+  ret.insert("getcoverage",         OgcRequests::GET_COVERAGE);
+  ret.insert("describecoverage",    OgcRequests::DESCRIBE_COVERAGE);
+  ret.insert("*",                   OgcRequests::ALL_REQUESTS);
+  return ret;
+}
+
+/**
+ * Gives the bit of a request name (case-insensitive), all of them for "*",
+ * none if the request is unknown.
+ */
+quint32 OgcRequests::requestMask(QString const & name) {
+  // parsers are also created from the renderer threads
+  static const QHash<QString, quint32> masks = requestMasks();
+  return masks.value(name.toLower(), 0);
+}
+
+OgcRequests OgcRequests::parse(QString const & value) {
+  OgcRequests ret;
+#if QT_VERSION >= 0x050e00
+  QStringList tokens = value.split(' ', Qt::SkipEmptyParts);
+#else
+  QStringList tokens = value.split(' ', QString::SkipEmptyParts);
+#endif
+
+  for (int i = 0; i < tokens.size(); ++i) {
+    bool disabling = tokens[i].startsWith('!');
+    quint32 mask = requestMask(disabling ? tokens[i].mid(1) : tokens[i]);
+
+    ret.specified |= mask;
+    if (disabling) {
+      ret.enabled &= ~mask;
+    } else {
+      ret.enabled |= mask;
+    }
+  }
+  return ret;
+}
+
+OgcRequests OgcRequests::fromMetadata(QHash<QString, QString> const & metadatas, Service service) {
+  static const char * prefixes[SERVICE_COUNT] = { "wms", "wfs", "wcs" };
+
+  OgcRequests own = parse(metadatas.value(QString(prefixes[service]) + "_enable_request"));
+  return own.fallback(parse(metadatas.value("ows_enable_request")));
+}
+
+bool OgcRequests::isRequestKey(QString const & metadataName) {
+  return metadataName.endsWith("_enable_request", Qt::CaseInsensitive);
+}
+
+/**
+ * Completes these requests with the ones of another set, for the requests
+ * these do not mention.
+ */
+OgcRequests OgcRequests::fallback(OgcRequests const & other) const {
+  OgcRequests ret;
+  ret.enabled   = enabled | (other.enabled & ~specified);
+  ret.specified = specified | other.specified;
+  return ret;
+}
+
+bool OgcRequests::isEnabled(Request request) const {
+  return (enabled & request) != 0;
+}
+
+bool OgcRequests::isSpecified(Request request) const {
+  return (specified & request) != 0;
+}
@@ -0,0 +1,82 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+#ifndef OGCREQUESTS_H
+#define OGCREQUESTS_H
+
+#include <QHash>
+#include <QString>
+
+/**
+ * Set of the OGC requests enabled for a service, parsed once from the
+ * "<service>_enable_request" and "ows_enable_request" metadata.
+ *
+ * The metadata are space-separated lists of request names, "*" standing
+ * for all of them and "!" disabling the request instead, the last matching
+ * token winning (e.g. "* !GetFeatureInfo"). As in msOWSRequestIsEnabled(),
+ * the service-specific metadata takes precedence over the OWS one for the
+ * requests it mentions, and the layer-level metadata over the map-level one
+ * (see fallback()).
+ */
+class OgcRequests {
+  public:
+    enum Service { WMS, WFS, WCS, SERVICE_COUNT };
+
+    enum Request {
+      GET_CAPABILITIES      = 0x0001,
+      GET_MAP               = 0x0002,
+      GET_FEATURE_INFO      = 0x0004,
+      GET_LEGEND_GRAPHIC    = 0x0008,
+      GET_STYLES            = 0x0010,
+      DESCRIBE_LAYER        = 0x0020,
+      GET_FEATURE           = 0x0040,
+      DESCRIBE_FEATURE_TYPE = 0x0080,
+      GET_COVERAGE          = 0x0100,
+      DESCRIBE_COVERAGE     = 0x0200,
+      ALL_REQUESTS          = 0x03ff
+    };
+
+    OgcRequests();
+
+    static OgcRequests parse(QString const & value);
+    static OgcRequests fromMetadata(QHash<QString, QString> const &, Service);
+    static bool isRequestKey(QString const & metadataName);
+
+    OgcRequests fallback(OgcRequests const & other) const;
+
+    bool isEnabled(Request) const;
+    bool isSpecified(Request) const;
+
+  private:
+    // requests enabled, and requests mentioned (enabled or disabled)
+    quint32 enabled;
+    quint32 specified;
+
+    static quint32 requestMask(QString const & name);
+};
+
+#endif // OGCREQUESTS_H
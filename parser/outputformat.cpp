@@ -105,6 +105,37 @@ void OutputFormat::setImageMode(int const &v)     { imageMode   = v; }
 void OutputFormat::setTransparent(bool const &v)  { transparent = v; }
 void OutputFormat::setState(enum State const &v)  { state       = v; }
 
+static qint64 stringUsage(QString const & s) {
+  return s.capacity() * sizeof(QChar);
+}
+
+qint64 OutputFormat::getMemoryUsage() const {
+  qint64 usage = sizeof(OutputFormat)
+    + stringUsage(name) + stringUsage(originalName) + stringUsage(mimeType)
+    + stringUsage(driver) + stringUsage(gdalDriver) + stringUsage(extension);
+  for (QHash<QString, QString>::const_iterator it = formatOptions.constBegin(); it != formatOptions.constEnd(); ++it) {
+    usage += stringUsage(it.key()) + stringUsage(it.value()) + 2 * sizeof(QString);
+  }
+  return usage;
+}
+
+/** Serialization (e.g. to keep a compressed copy of an outputformat) */
+
+QDataStream & operator<<(QDataStream & out, OutputFormat const & of) {
+  out << of.name << of.originalName << of.mimeType << of.driver << of.gdalDriver << of.extension
+      << (qint32) of.imageMode << of.transparent << of.formatOptions << (qint32) of.state;
+  return out;
+}
+
+QDataStream & operator>>(QDataStream & in, OutputFormat & of) {
+  qint32 imageMode, state;
+  in >> of.name >> of.originalName >> of.mimeType >> of.driver >> of.gdalDriver >> of.extension
+     >> imageMode >> of.transparent >> of.formatOptions >> state;
+  of.imageMode = imageMode;
+  of.state = (OutputFormat::State) state;
+  return in;
+}
+
 /** OutputFormat Model (representation into the UI) */
 
 OutputFormatsModel::OutputFormatsModel(QObject * parent) : QAbstractListModel(parent) {}
@@ -29,6 +29,7 @@
 #ifndef OUTPUTFORMAT_H
 #define OUTPUTFORMAT_H
 
+#include <QDataStream>
 #include <QHash>
 #include <QModelIndex>
 #include <QString>
@@ -81,6 +82,9 @@ class OutputFormat {
 
    bool isEmpty();
 
+   // approximate size of the object and of its strings, in bytes
+   qint64 getMemoryUsage() const;
+
    /** setters */
    void setFormatOptions(QHash<QString,QString> const &);
    void setName(QString const &);
@@ -106,8 +110,13 @@ class OutputFormat {
    QHash<QString,QString> formatOptions;
    enum State state;
 
+   friend QDataStream & operator<<(QDataStream &, OutputFormat const &);
+   friend QDataStream & operator>>(QDataStream &, OutputFormat &);
 };
 
+QDataStream & operator<<(QDataStream &, OutputFormat const &);
+QDataStream & operator>>(QDataStream &, OutputFormat &);
+
 // The class defining a model to wire onto the Qt interface
 class OutputFormatsModel : public QAbstractListModel {
   public:
@@ -0,0 +1,93 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#include "profilerdock.h"
+
+#include <QHeaderView>
+
+ProfilerDock::ProfilerDock(QWidget * parent) : QDockWidget(tr("Profiler"), parent) {
+  this->setObjectName("profilerDock");
+
+  this->model = new QStandardItemModel(0, PROFILE_COLUMN_COUNT, this);
+  this->model->setHorizontalHeaderItem(PROFILE_LAYER, new QStandardItem(tr("Layer")));
+  this->model->setHorizontalHeaderItem(PROFILE_TIME, new QStandardItem(tr("Time (ms)")));
+  this->model->setHorizontalHeaderItem(PROFILE_FEATURES, new QStandardItem(tr("Features")));
+  this->model->setHorizontalHeaderItem(PROFILE_BYTES_READ, new QStandardItem(tr("Bytes read")));
+  this->model->setHorizontalHeaderItem(PROFILE_LABELS, new QStandardItem(tr("Labels")));
+
+  this->view = new QTableView(this);
+  this->view->setModel(this->model);
+  this->view->setSortingEnabled(true);
+  this->view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  this->view->setSelectionBehavior(QAbstractItemView::SelectRows);
+  this->view->verticalHeader()->hide();
+  this->view->horizontalHeader()->setStretchLastSection(true);
+  // the slowest layers first
+  this->view->sortByColumn(PROFILE_TIME, Qt::DescendingOrder);
+
+  this->setWidget(this->view);
+}
+
+// unknown values are left blank, so that they are sorted apart
+static QStandardItem * numericItem(double value, bool known = true) {
+  QStandardItem * item = new QStandardItem();
+  if (known) {
+    item->setData(value, Qt::DisplayRole);
+  }
+  item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+  return item;
+}
+
+void ProfilerDock::setProfile(QList<LayerProfile> const & profile) {
+  this->model->removeRows(0, this->model->rowCount());
+
+  for (int i = 0; i < profile.size(); ++i) {
+    LayerProfile const & p = profile.at(i);
+
+    QStandardItem * name = new QStandardItem(p.name);
+    if (p.index == LayerProfile::LABELS) {
+      QFont font = name->font();
+      font.setItalic(true);
+      name->setFont(font);
+    }
+    this->model->setItem(i, PROFILE_LAYER, name);
+    this->model->setItem(i, PROFILE_TIME, numericItem(p.time / 1000.0));
+    this->model->setItem(i, PROFILE_FEATURES, numericItem(p.features, p.features >= 0));
+    this->model->setItem(i, PROFILE_BYTES_READ, numericItem(p.bytesRead, p.bytesRead >= 0));
+    this->model->setItem(i, PROFILE_LABELS, numericItem(p.labels));
+  }
+
+  // keeps the current sort order, if any
+  int column = this->view->horizontalHeader()->sortIndicatorSection();
+  if ((column >= 0) && (column < this->model->columnCount())) {
+    this->model->sort(column, this->view->horizontalHeader()->sortIndicatorOrder());
+  }
+  this->view->resizeColumnsToContents();
+}
+
+ProfilerDock::~ProfilerDock() {}
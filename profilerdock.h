@@ -0,0 +1,60 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#ifndef PROFILERDOCK_H
+#define PROFILERDOCK_H
+
+#include <QDockWidget>
+#include <QStandardItemModel>
+#include <QTableView>
+
+#include "parser/mapfileparser.h"
+
+/**
+ * Dock panel displaying the rendering statistics of the layers (see
+ * MapfileParser::profileCurrentMap()), sortable by any column.
+ */
+class ProfilerDock : public QDockWidget {
+
+ Q_OBJECT
+
+ public:
+  ProfilerDock(QWidget * parent = 0);
+  ~ProfilerDock();
+
+  void setProfile(QList<LayerProfile> const &);
+
+  enum Column { PROFILE_LAYER, PROFILE_TIME, PROFILE_FEATURES, PROFILE_BYTES_READ, PROFILE_LABELS,
+                PROFILE_COLUMN_COUNT };
+
+ private:
+  QTableView * view;
+  QStandardItemModel * model;
+};
+
+#endif // PROFILERDOCK_H
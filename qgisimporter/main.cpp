@@ -26,12 +26,9 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
  ****************************************************************************/
 
-#include <unistd.h>
-
 #include <QApplication>
 #include <QtCore/QDebug>
-#include <QTemporaryFile>
-#include <QTextStream>
+#include <QFile>
 
 #include "ogrsf_frmts.h"
 
@@ -65,35 +62,20 @@ int main(int argc, char ** argv) {
       delete imp;
     return 1;
    }
-   // Touch'ing a temporary file
-   //
-   // Doing so, because the Mapserver API to save a mapfile into a char * is
-   // fiddling with stdout, I don't feel it very secure in term of race
-   // condition, if another thread ever pollutes the standard output during
-   // dumping the memory object.
-   //
-   // See mapfile.c: char* msWriteMapToString(mapObj *map)
-   //
-   QTemporaryFile * f = new QTemporaryFile();
-   f->open();
-   f->close();
+   // Not using msWriteMapToString(), which is fiddling with stdout (see
+   // MapfileParser::writeMapfile())
+   QByteArray text = p->getMapfileText();
    qDebug() << "";
-
-   p->saveMapfile(f->fileName());
-
-   // reopens the file
-   f->open();
-   QTextStream in(f);
-   qDebug() << in.readAll().toStdString().c_str();
-   f->close();
+   qDebug() << text.constData();
 
    if (argc > 2) {
-     unlink(argv[2]);
-     f->copy(argv[2]);
+     QFile out(argv[2]);
+     if ((! out.open(QIODevice::WriteOnly | QIODevice::Truncate)) || (out.write(text) != text.size())) {
+       qDebug() << "Unable to write" << argv[2];
+     }
    }
 
-   if (f)
-     delete f;
+   delete p;
    if (imp)
      delete imp;
 
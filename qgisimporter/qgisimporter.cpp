@@ -100,6 +100,11 @@ int QGisImporter::getGeometryType(QString const & path) {
 }
 
 
+/**
+ * Reads the project in a single pass: the map settings are taken from the
+ * first element of each kind found outside of the layers (as the map canvas
+ * comes first), each layer is added as soon as it has been read.
+ */
 MapfileParser * QGisImporter::importMapFile() {
 
   QFile f(qgsPath);
@@ -109,75 +114,147 @@ MapfileParser * QGisImporter::importMapFile() {
     return NULL;
   }
 
-  QDomDocument doc("QGisImporterXmlDoc");
-  if (!doc.setContent(&f)) {
-    f.close();
-    return NULL;
-  }
-
-  qDebug() << "QGIS project XML loaded, parsing ...";
-
+  QXmlStreamReader xml(& f);
   MapfileParser * mf = new MapfileParser();
 
-  // gets the title
-  QDomNode titleNode = doc.elementsByTagName("title").at(0);
-  mf->setMapName(titleNode.toElement().text());
+  QString title, units, proj4Str;
+  float xmin = 0, ymin = 0, xmax = 0, ymax = 0;
+  bool titleFound = false, extentFound = false, srsFound = false, mapcanvasFound = false;
+  int layerCount = 0;
+  // depth of the current element, and of the map canvas while in it
+  int depth = 0, mapcanvasDepth = -1;
+
+  while (! xml.atEnd()) {
+    xml.readNext();
+    if (xml.isEndElement()) {
+      --depth;
+      if (depth == mapcanvasDepth) {
+        mapcanvasDepth = -1;
+      }
+      continue;
+    }
+    if (! xml.isStartElement()) {
+      continue;
+    }
+
+    // the elements read below are consumed up to their end
+    if (xml.name() == "maplayer") {
+      this->readMapLayer(xml, mf);
+      ++layerCount;
+    } else if ((xml.name() == "title") && (! titleFound)) {
+      title = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+      titleFound = true;
+    } else if ((xml.name() == "extent") && (! extentFound)) {
+      this->readExtent(xml, xmin, ymin, xmax, ymax);
+      extentFound = true;
+    } else if ((xml.name() == "units") && (mapcanvasDepth >= 0) && (depth == mapcanvasDepth + 1)) {
+      // TODO: check possible values for units QGis-side
+      units = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+    } else if ((xml.name() == "destinationsrs") && (! srsFound)) {
+      proj4Str = this->readProj4(xml);
+      srsFound = true;
+    } else {
+      if ((xml.name() == "mapcanvas") && (! mapcanvasFound)) {
+        mapcanvasFound = true;
+        mapcanvasDepth = depth;
+      }
+      ++depth;
+    }
+  }
 
+  f.close();
 
-  // gets the extent
-  float xmin, ymin, xmax, ymax;
-  QDomNode extent = doc.elementsByTagName("extent").at(0);
+  if (xml.hasError()) {
+    qDebug() << "Unable to parse" << qgsPath << ":" << xml.errorString();
+    delete mf;
+    return NULL;
+  }
 
-  xmin = extent.firstChildElement("xmin").text().toFloat();
-  xmax = extent.firstChildElement("xmax").text().toFloat();
-  ymin = extent.firstChildElement("ymin").text().toFloat();
-  ymax = extent.firstChildElement("ymax").text().toFloat();
+  qDebug() << layerCount << " layers parsed";
 
+  mf->setMapName(title);
   mf->setMapExtent(xmin, ymin, xmax, ymax);
-
-  // units
-  QDomNode mapcanvasNode = doc.elementsByTagName("mapcanvas").at(0);
-  QString units = mapcanvasNode.firstChildElement("units").text();
-  // TODO: check possible values for units QGis-side
   mf->setMapUnits(units == "degrees" ? "dd" : units);
-
   // TODO: setting default width / height ? (the information is not
   // available into QGis XML format)
+  mf->setMapProjection(proj4Str);
 
-  // gets the projection
-  QDomNode destinationSrsNode = doc.elementsByTagName("destinationsrs").at(0);
+  return mf;
+}
 
-  QString proj4Str = destinationSrsNode.firstChildElement("spatialrefsys").firstChildElement("proj4").text();
-  mf->setMapProjection(proj4Str);
+void QGisImporter::readExtent(QXmlStreamReader & xml, float & xmin, float & ymin, float & xmax, float & ymax) {
+  while (xml.readNextStartElement()) {
+    if (xml.name() == "xmin") {
+      xmin = xml.readElementText(QXmlStreamReader::IncludeChildElements).toFloat();
+    } else if (xml.name() == "ymin") {
+      ymin = xml.readElementText(QXmlStreamReader::IncludeChildElements).toFloat();
+    } else if (xml.name() == "xmax") {
+      xmax = xml.readElementText(QXmlStreamReader::IncludeChildElements).toFloat();
+    } else if (xml.name() == "ymax") {
+      ymax = xml.readElementText(QXmlStreamReader::IncludeChildElements).toFloat();
+    } else {
+      xml.skipCurrentElement();
+    }
+  }
+}
 
-  // Layers
-  QDomNodeList layersNodes = doc.elementsByTagName("maplayer");
-
-  qDebug() << layersNodes.size() << " layers to parse";
-
-  for (int i = 0 ; i < layersNodes.size(); ++i) {
-    QString layerName = layersNodes.at(i).firstChildElement("layername").text();
-    QString dataStr = layersNodes.at(i).firstChildElement("datasource").text();
-    QString typeStr =  layersNodes.at(i).firstChildElement("provider").text();
-    QString projStr =  layersNodes.at(i).firstChildElement("srs").firstChildElement("spatialrefsys").firstChildElement("proj4").text();
-    qDebug() <<  layerName << dataStr << typeStr << projStr;
-    /* data is a file - need to check if relative or absolute, if it exists ... */
-    QFileInfo dataFinfo = QFileInfo(dataStr);
-    if (dataFinfo.isRelative()) {
-      dataStr = QFileInfo(qgsPath).dir().absolutePath() + "/" + dataStr;
+/**
+ * Gives the proj4 definition of the spatialrefsys element in the current
+ * one (srs or destinationsrs).
+ */
+QString QGisImporter::readProj4(QXmlStreamReader & xml) {
+  QString proj4;
+  bool srsFound = false;
+  while (xml.readNextStartElement()) {
+    if ((xml.name() != "spatialrefsys") || srsFound) {
+      xml.skipCurrentElement();
+      continue;
     }
-    // data is ogr, call the underlying library to determine the type
-    int geomType = MS_LAYER_RASTER;
-    if (typeStr == "ogr") {
-      geomType = getGeometryType(dataStr);
+    srsFound = true;
+    while (xml.readNextStartElement()) {
+      if ((xml.name() == "proj4") && proj4.isNull()) {
+        proj4 = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+      } else {
+        xml.skipCurrentElement();
+      }
     }
-
-    mf->addLayer(layerName, dataStr, projStr, geomType);
   }
+  return proj4;
+}
 
+// the styles (renderer, labeling, ...) are skipped
+void QGisImporter::readMapLayer(QXmlStreamReader & xml, MapfileParser * mf) {
+  QString layerName, dataStr, typeStr, projStr;
+  bool srsFound = false;
+  while (xml.readNextStartElement()) {
+    if (xml.name() == "layername") {
+      layerName = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+    } else if (xml.name() == "datasource") {
+      dataStr = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+    } else if (xml.name() == "provider") {
+      typeStr = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+    } else if ((xml.name() == "srs") && (! srsFound)) {
+      projStr = this->readProj4(xml);
+      srsFound = true;
+    } else {
+      xml.skipCurrentElement();
+    }
+  }
+  if (xml.hasError()) {
+    return;
+  }
 
+  qDebug() <<  layerName << dataStr << typeStr << projStr;
+  /* data is a file - need to check if relative or absolute, if it exists ... */
+  QFileInfo dataFinfo = QFileInfo(dataStr);
+  if (dataFinfo.isRelative()) {
+    dataStr = QFileInfo(qgsPath).dir().absolutePath() + "/" + dataStr;
+  }
+  // data is ogr, call the underlying library to determine the type
+  int geomType = MS_LAYER_RASTER;
+  if (typeStr == "ogr") {
+    geomType = getGeometryType(dataStr);
+  }
 
-  f.close();
-
-  return mf;
+  mf->addLayer(layerName, dataStr, projStr, geomType);
 }
@@ -30,16 +30,21 @@
 #define QGISIMPORTER_H
 
 #include <QDir>
-#include <QDomDocument>
-#include <QDomNode>
-#include <QDomNodeList>
 #include <QFile>
 #include <QFileInfo>
 #include <QString>
+#include <QXmlStreamReader>
 
 #include "../parser/mapfileparser.h"
 
 
+/**
+ * Imports a QGIS project (.qgs) into a new mapfile.
+ *
+ * The project is read in a single forward pass, the styles and other parts
+ * of the layers which are not imported being skipped as they go, so that
+ * the memory used does not depend on the size of the project.
+ */
 class QGisImporter  : QObject {
 
  Q_OBJECT
@@ -56,6 +61,11 @@ class QGisImporter  : QObject {
 
   // defined in mapserver.h
   int getGeometryType(QString const &);
+
+  // the following read the element the reader is at, up to its end
+  void readExtent(QXmlStreamReader &, float & xmin, float & ymin, float & xmax, float & ymax);
+  void readMapLayer(QXmlStreamReader &, MapfileParser *);
+  QString readProj4(QXmlStreamReader &);
 };
 
 
@@ -13,9 +13,8 @@ CONFIG += console debug_and_release
 
 QMAKE_CLEAN += $(TARGET)
 
-QT += xml
 # Input
-HEADERS += qgisimporter.h ../parser/mapfileparser.h ../parser/outputformat.h ../parser/layer.h
-SOURCES += main.cpp qgisimporter.cpp ../parser/mapfileparser.cpp ../parser/outputformat.cpp ../parser/layer.cpp
+HEADERS += qgisimporter.h ../parser/mapfileparser.h ../parser/mapfilepatcher.h ../parser/mapfilesnapshot.h ../parser/ogcrequests.h ../parser/outputformat.h ../parser/layer.h
+SOURCES += main.cpp qgisimporter.cpp ../parser/mapfileparser.cpp ../parser/mapfilepatcher.cpp ../parser/mapfilesnapshot.cpp ../parser/ogcrequests.cpp ../parser/outputformat.cpp ../parser/layer.cpp
 
 
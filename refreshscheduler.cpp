@@ -0,0 +1,66 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#include "refreshscheduler.h"
+
+RefreshScheduler::RefreshScheduler(QObject * parent, int window) : QObject(parent),
+    requestCount(0),
+    refreshCount(0)
+{
+  timer.setSingleShot(true);
+  timer.setInterval(window);
+  this->connect(& timer, SIGNAL(timeout()), SLOT(windowElapsed()));
+}
+
+/**
+ * Asks for a refresh. The window is not extended by the subsequent
+ * requests, so that a steady flow of them still leads to regular refreshes.
+ */
+void RefreshScheduler::schedule() {
+  ++requestCount;
+  if (! timer.isActive()) {
+    timer.start();
+  }
+}
+
+/**
+ * Notifies that the preview has just been refreshed, dropping the pending
+ * requests.
+ */
+void RefreshScheduler::performed() {
+  timer.stop();
+}
+
+void RefreshScheduler::windowElapsed() {
+  ++refreshCount;
+  emit refresh();
+}
+
+int RefreshScheduler::getRequestCount() const { return requestCount; }
+int RefreshScheduler::getRefreshCount() const { return refreshCount; }
+int RefreshScheduler::getSavedCount() const   { return requestCount - refreshCount; }
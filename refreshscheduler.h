@@ -0,0 +1,71 @@
+/**********************************************************************
+ * $Id$
+ *
+ * Project: QMapfileEditor
+ * Purpose: 
+ * Author: Pierre Mauduit
+ *
+ **********************************************************************
+ * Copyright (c) 2014, Pierre Mauduit
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies of this Software or works derived from this Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ ****************************************************************************/
+
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+
+/**
+ * Coalesces the requests for refreshing the map preview: every request
+ * made within the same time window (a frame, by default) leads to a single
+ * refresh() signal, emitted at the end of the window.
+ *
+ * A refresh performed directly (e.g. when zooming) makes the pending
+ * requests redundant, they are then dropped (see performed()).
+ */
+class RefreshScheduler : public QObject {
+
+ Q_OBJECT
+
+ public:
+  RefreshScheduler(QObject * parent = 0, int window = 16);
+
+  void schedule();
+  void performed();
+
+  // statistics: requests received, refreshes actually emitted, and
+  // refreshes saved by coalescing them.
+  int getRequestCount() const;
+  int getRefreshCount() const;
+  int getSavedCount() const;
+
+ signals:
+  void refresh();
+
+ private slots:
+  void windowElapsed();
+
+ private:
+  QTimer timer;
+  int requestCount;
+  int refreshCount;
+};
+
+#endif // REFRESHSCHEDULER_H
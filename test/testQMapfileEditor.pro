@@ -23,8 +23,29 @@ QMAKE_CLEAN += $(TARGET)
 
 LIBS += ../debug/mapfileparser.o            \
         ../debug/outputformat.o             \
+        ../debug/mapfilepatcher.o           \
+        ../debug/mapfilesnapshot.o          \
+        ../debug/ogcrequests.o              \
         ../debug/changemapnamecommand.o     \
+        ../debug/commandjournal.o           \
+        ../debug/moc_commandjournal.o       \
+        ../debug/continuousedit.o           \
+        ../debug/setanglecommand.o          \
+        ../debug/setmapsizecommand.o        \
+        ../debug/outputformatcommands.o     \
+        ../debug/undobudget.o               \
+        ../debug/moc_undobudget.o           \
         ../debug/layer.o                    \
+        ../debug/keyvaluemodel.o            \
+        ../debug/maptiles.o                 \
+        ../debug/refreshscheduler.o         \
+        ../debug/moc_refreshscheduler.o     \
+        ../debug/mapfileloader.o            \
+        ../debug/moc_mapfileloader.o        \
+        ../debug/mapfilesaver.o             \
+        ../debug/moc_mapfilesaver.o         \
+        ../debug/layersortfiltermodel.o     \
+        ../debug/moc_layersortfiltermodel.o \
         -L/usr/lib/x86_64-linux-gnu/ -lmapserver -lgdal -lgcov
 
 
@@ -34,11 +55,23 @@ HEADERS += testmapfileparser.h      \
            testlayer.h              \
            testoutputformat.h       \
            testcommands.h           \
+           testmaptiles.h           \
+           testrefreshscheduler.h   \
+           testmapfileloader.h      \
+           testmapfilesaver.h       \
+           testkeyvaluemodel.h      \
+           testlayersortfiltermodel.h \
            autotest.h
 
 SOURCES += testmapfileparser.cpp    \
            testlayer.cpp            \
            testoutputformat.cpp     \
            testcommands.cpp         \
+           testmaptiles.cpp         \
+           testrefreshscheduler.cpp \
+           testmapfileloader.cpp    \
+           testmapfilesaver.cpp     \
+           testkeyvaluemodel.cpp    \
+           testlayersortfiltermodel.cpp \
            main.cpp
 
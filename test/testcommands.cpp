@@ -1,5 +1,17 @@
 #include "testcommands.h"
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QUndoStack>
+
 #include "../commands/changemapnamecommand.h"
+#include "../commands/commandjournal.h"
+#include "../commands/continuousedit.h"
+#include "../commands/outputformatcommands.h"
+#include "../commands/setanglecommand.h"
+#include "../commands/setmapsizecommand.h"
+#include "../commands/undobudget.h"
 
 void TestCommands::testChangeMapNameCommand(void) {
   MapfileParser *p = new MapfileParser();
@@ -26,3 +38,204 @@ void TestCommands::testChangeMapNameCommand(void) {
   if (c) delete c;
 
 }
+
+/** the changes of a value made in one interaction end up as one entry of the undo stack */
+void TestCommands::testMergeCommands(void) {
+  MapfileParser *p = new MapfileParser();
+  QUndoStack stack;
+  float angle = p->getAngle();
+
+  // a continuous interaction (e.g. dragging a slider)
+  for (int i = 1; i <= 10; ++i) {
+    stack.push(new SetAngleCommand(i * 10, p));
+  }
+  QVERIFY(stack.count() == 1);
+  QVERIFY(p->getAngle() == 100);
+
+  // another kind of command stops the merging
+  stack.push(new SetMapSizeCommand(640, 480, p));
+  stack.push(new SetMapSizeCommand(800, 600, p));
+  stack.push(new SetAngleCommand(45, p));
+  QVERIFY(stack.count() == 3);
+
+  stack.undo();
+  QVERIFY(p->getAngle() == 100);
+  stack.undo();
+  stack.undo();
+  QVERIFY(p->getAngle() == angle);
+
+  // nor the clean state
+  stack.redo();
+  stack.setClean();
+  stack.push(new SetAngleCommand(90, p));
+  QVERIFY(stack.count() == 2);
+
+  // separate changes (e.g. each validation of the settings dialog) are kept
+  stack.clear();
+  ContinuousEdit::setInterval(0);
+  stack.push(new SetAngleCommand(10, p));
+  stack.push(new SetAngleCommand(20, p));
+  QVERIFY(stack.count() == 2);
+  stack.undo();
+  QVERIFY(p->getAngle() == 10);
+  ContinuousEdit::setInterval(ContinuousEdit::DEFAULT_INTERVAL);
+
+  stack.clear();
+  delete p;
+}
+
+// the budget only recreates output format commands here
+static QUndoCommand * createOutputFormatCommand(int commandId, QByteArray const & payload, MapfileParser * parser, MainWindow *) {
+  QDataStream in(payload);
+  in.setVersion(CommandJournal::STREAM_VERSION);
+  OutputFormat format;
+  in >> format;
+  return (commandId == ADD_OUTPUT_FORMAT_COMMAND) ? new AddNewOutputFormatCommand(& format, parser) : NULL;
+}
+
+/** the oldest commands are compacted first, then dropped */
+void TestCommands::testUndoBudget(void) {
+  MapfileParser *p = new MapfileParser();
+  int formats = p->getOutputFormats().size();
+  QUndoStack stack;
+  UndoBudget budget(& stack, 0);
+  QSignalSpy collapsed(& budget, SIGNAL(historyCollapsed(int)));
+
+  OutputFormat of("big", "image/png", "AGG/PNG", "png");
+  for (int i = 0; i < 100; ++i) {
+    of.addFormatOption(QString("OPTION_%1").arg(i), QString(64, 'x'));
+  }
+  for (int i = 0; i < 20; ++i) {
+    of.setName(QString("big%1").arg(i));
+    stack.push(new AddNewOutputFormatCommand(& of, p));
+  }
+  QVERIFY(p->getOutputFormats().size() == formats + 20);
+
+  qint64 usage = budget.getMemoryUsage();
+  budget.setBudget(usage - 1);
+  QVERIFY(budget.getMemoryUsage() < usage);
+  QVERIFY(stack.count() == 20);
+  QVERIFY(collapsed.count() == 0);
+
+  // compacted copies are restored when needed
+  while (stack.canUndo()) {
+    stack.undo();
+  }
+  QVERIFY(p->getOutputFormats().size() == formats);
+  stack.redo();
+  QVERIFY(p->getOutputFormats().last()->getName() == "big0");
+  QVERIFY(p->getOutputFormats().last()->getFormatOptions().size() == 100);
+
+  // nothing can be dropped without recreating the recent commands
+  while (stack.canRedo()) {
+    stack.redo();
+  }
+  budget.setBudget(1);
+  QVERIFY(collapsed.count() == 0);
+  QVERIFY(stack.count() == 20);
+
+  budget.setCommandFactory(createOutputFormatCommand, p, NULL);
+  budget.enforce();
+  QVERIFY(collapsed.count() == 1);
+  QVERIFY(collapsed.at(0).at(0).toInt() == 20 - UndoBudget::UNCOMPACTED_COMMANDS);
+  QVERIFY(stack.count() == UndoBudget::UNCOMPACTED_COMMANDS);
+  QVERIFY(stack.index() == stack.count());
+  QVERIFY(p->getOutputFormats().size() == formats + 20);
+  QVERIFY(p->getOutputFormats().last()->getName() == "big19");
+  // the saved state has been dropped
+  QVERIFY(! stack.isClean());
+
+  // the mapfile as it was before the remaining commands is the new bottom
+  while (stack.canUndo()) {
+    stack.undo();
+  }
+  QVERIFY(p->getOutputFormats().size() == formats + 20 - UndoBudget::UNCOMPACTED_COMMANDS);
+  QVERIFY(! stack.isClean());
+
+  delete p;
+}
+
+/** the edits made since the last save are journaled next to the mapfile */
+void TestCommands::testJournal(void) {
+  QTemporaryDir dir;
+  QString path = dir.path() + "/journaled.map";
+  QFile mapfile(path);
+  QVERIFY(mapfile.open(QIODevice::WriteOnly));
+  mapfile.write("MAP\n  INCLUDE 'included.map'\nEND\n");
+  mapfile.close();
+  QFile included(dir.path() + "/included.map");
+  QVERIFY(included.open(QIODevice::WriteOnly));
+  included.write("NAME 'journaled'\n");
+  included.close();
+
+  MapfileParser *p = new MapfileParser();
+  QUndoStack stack;
+  CommandJournal journal(& stack);
+  QVERIFY(journal.start(path));
+
+  stack.push(new SetAngleCommand(10, p));
+  stack.push(new SetAngleCommand(20, p));
+  stack.push(new SetMapSizeCommand(640, 480, p));
+  stack.undo();
+  stack.push(new ChangeMapNameCommand("journaled", p));
+
+  QList<CommandJournal::Record> records;
+  QVERIFY(CommandJournal::read(path, records));
+  QVERIFY(records.size() == 5);
+  QVERIFY(records[0].kind == CommandJournal::PUSH);
+  QVERIFY(records[0].commandId == SET_ANGLE_COMMAND);
+  QVERIFY(records[1].kind == CommandJournal::MERGE);
+  QVERIFY(records[2].commandId == SET_MAP_SIZE_COMMAND);
+  QVERIFY(records[3].kind == CommandJournal::SET_INDEX);
+  QVERIFY(records[3].index == 1);
+  QVERIFY(records[4].kind == CommandJournal::PUSH);
+  QVERIFY(records[4].commandId == CHANGE_MAP_NAME_COMMAND);
+
+  // the merged command is written with its latest value
+  QDataStream in(records[1].payload);
+  in.setVersion(CommandJournal::STREAM_VERSION);
+  float angle;
+  in >> angle;
+  QVERIFY(angle == 20);
+
+  // once saved, the journal starts over
+  stack.setClean();
+  journal.reset();
+  QVERIFY(! CommandJournal::read(path, records));
+
+  // undoing past the saved state cannot be journaled
+  stack.undo();
+  QVERIFY(journal.isSuspended());
+  stack.redo();
+  QVERIFY(! CommandJournal::read(path, records));
+  journal.reset();
+  QVERIFY(! journal.isSuspended());
+
+  // clearing the history away from the saved state cannot be journaled
+  stack.push(new ChangeMapNameCommand("cleared", p));
+  stack.clear();
+  QVERIFY(journal.isSuspended());
+  QVERIFY(! CommandJournal::read(path, records));
+  journal.reset();
+
+  // a record partly written is ignored
+  stack.push(new SetAngleCommand(30, p));
+  stack.push(new SetMapSizeCommand(800, 600, p));
+  QFile journalFile(CommandJournal::getJournalPath(path));
+  QVERIFY(journalFile.resize(journalFile.size() - 1));
+  QVERIFY(CommandJournal::read(path, records));
+  QVERIFY(records.size() == 1);
+
+  // nor does it apply once a file of the mapfile has been modified, be it
+  // an included one
+  QVERIFY(included.open(QIODevice::Append));
+  included.write("# modified\n");
+  included.close();
+  QVERIFY(! CommandJournal::read(path, records));
+
+  journal.discard();
+  QVERIFY(! journalFile.exists());
+
+  stack.clear();
+  delete p;
+}
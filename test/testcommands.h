@@ -10,6 +10,9 @@ class TestCommands : public QObject {
   Q_OBJECT
       private slots:
       void testChangeMapNameCommand();
+      void testMergeCommands();
+      void testUndoBudget();
+      void testJournal();
 };
 
 DECLARE_TEST(TestCommands)
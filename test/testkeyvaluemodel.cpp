@@ -0,0 +1,70 @@
+#include "testkeyvaluemodel.h"
+
+#include "../keyvaluemodel.h"
+
+#include <QSignalSpy>
+
+/** the rows are sorted by key, the filtered keys left aside */
+void TestKeyValueModel::testSetData() {
+  KeyValueModel m(0, QStringList("wms_enable_request"));
+  QHash<QString, QString> kv;
+  kv.insert("wms_title", "World");
+  kv.insert("ows_title", "OWS");
+  kv.insert("wms_enable_request", "*");
+  m.setData(kv);
+
+  QVERIFY(m.rowCount() == 2);
+  QVERIFY(m.keyAt(0) == "ows_title");
+  QVERIFY(m.rowOf("wms_title") == 1);
+  QVERIFY(m.rowOf("wms_enable_request") == -1);
+  QVERIFY(m.data(m.index(1, KeyValueModel::Value), Qt::DisplayRole).toString() == "World");
+}
+
+/** a new key is inserted as the last row, an existing one updated in place */
+void TestKeyValueModel::testAddData() {
+  KeyValueModel m;
+  m.addData("wms_title", "World");
+  m.addData("ows_title", "OWS");
+
+  QSignalSpy inserted(& m, SIGNAL(rowsInserted(QModelIndex, int, int)));
+  QSignalSpy changed(& m, SIGNAL(dataChanged(QModelIndex, QModelIndex)));
+  QSignalSpy reset(& m, SIGNAL(modelReset()));
+
+  m.addData("wms_srs", "EPSG:4326");
+  QVERIFY(inserted.count() == 1);
+  QVERIFY(inserted.first().at(1).toInt() == 2);
+  QVERIFY(m.keyAt(2) == "wms_srs");
+
+  m.addData("wms_title", "Monde");
+  QVERIFY(inserted.count() == 1);
+  QVERIFY(changed.count() == 1);
+  QVERIFY(m.rowOf("wms_title") == 0);
+  QVERIFY(m.getData().value("wms_title") == "Monde");
+  QVERIFY(reset.count() == 0);
+}
+
+/** the following rows move up */
+void TestKeyValueModel::testRemoveData() {
+  KeyValueModel m;
+  for (int i = 0; i < 6; ++i) {
+    m.addData(QString("key%1").arg(i), QString::number(i));
+  }
+
+  QSignalSpy removed(& m, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+  m.removeData("key1");
+  QVERIFY(removed.count() == 1);
+  QVERIFY(m.rowCount() == 5);
+  QVERIFY(m.rowOf("key2") == 1);
+  QVERIFY(! m.getData().contains("key1"));
+
+  // key2, key3 (one range) and key5
+  QModelIndexList selection;
+  selection << m.index(4, 0) << m.index(1, 0) << m.index(2, 0);
+  m.removeDataAt(selection);
+  QVERIFY(removed.count() == 3);
+  QVERIFY(m.rowCount() == 2);
+  QVERIFY(m.keyAt(0) == "key0");
+  QVERIFY(m.keyAt(1) == "key4");
+  QVERIFY(m.rowOf("key4") == 1);
+  QVERIFY(m.getData().size() == 2);
+}
@@ -0,0 +1,19 @@
+#ifndef TESTKEYVALUEMODEL_H
+#define TESTKEYVALUEMODEL_H
+
+#include "autotest.h"
+
+class TestKeyValueModel: public QObject
+{
+  Q_OBJECT
+      private slots:
+        void testSetData(void);
+        void testAddData(void);
+        void testRemoveData(void);
+
+};
+
+DECLARE_TEST(TestKeyValueModel)
+
+
+#endif // TESTKEYVALUEMODEL_H
@@ -4,6 +4,7 @@
 #include "../parser/mapfileparser.h"
 
 #include <QDebug>
+#include <QSignalSpy>
 
 /** simple test case to check the parsing
  * of layers in an existing mapfile.
@@ -60,4 +61,121 @@ void TestLayer::testLayer()
 
 }
 
+/**
+ * Checks that the layers lookup follows the renamings and removals.
+ */
+void TestLayer::testLayerIndex()
+{
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  QVERIFY(p->isLoaded());
+
+  QVERIFY(p->getLayerIndex("world raster") == 0);
+  QVERIFY(p->getLayerIndex("World contour") == 1);
+  QVERIFY(p->getLayerIndex("unknown layer") == -1);
+
+  // renaming
+  Layer * raster = p->getLayers().at(0);
+  raster->setName("renamed raster");
+  QVERIFY(p->layerExists("renamed raster"));
+  QVERIFY(! p->layerExists("world raster"));
+  QVERIFY(raster->getGroup() == "common");
+
+  // removing: a copy of the wrapper shall not reach the removed layer anymore
+  Layer * contour = p->getLayers().at(1);
+  Layer copy(* contour);
+  QVERIFY(copy.getStatus() == 2); // MS_DEFAULT
+  p->removeLayer(contour);
+  QVERIFY(p->getLayers().size() == 1);
+  QVERIFY(p->getLayerIndex("World contour") == -1);
+  QVERIFY(copy.getStatus() == -1);
+  QVERIFY(p->getLayers().at(0)->getGroup() == "common");
+
+  // adding
+  Layer * added = p->addLayer("new layer", false);
+  QVERIFY(p->getLayerIndex("new layer") == 1);
+  QVERIFY(added->getStatus() != -1);
+
+  // a name shared by several layers does not identify one of them
+  QVERIFY(added->getNameCount("new layer") == 1);
+  p->addLayer("new layer", false);
+  QVERIFY(added->getNameCount("new layer") == 2);
+  QVERIFY(added->getNameCount("World contour") == 0);
+
+  delete p;
+  // the wrapper copy outlives the map object
+  QVERIFY(copy.getStatus() == -1);
+}
+
+/**
+ * Checks the incremental fetching of the layers model, over a mapfile whose
+ * layers wrappers are created on demand.
+ */
+void TestLayer::testLayerModel()
+{
+  MapfileParser * p = new MapfileParser();
+  for (int i = 0; i < 600; ++i) {
+    p->addLayer(QString("layer %1").arg(i), false);
+  }
+  // the copy creates its wrappers lazily
+  MapfileParser * c = new MapfileParser(* p);
+  delete p;
+  QVERIFY(c->getLayerCount() == 600);
+  QVERIFY(c->getLayerList().at(599) == "layer 599");
 
+  LayerModel model(NULL, c);
+  QVERIFY(model.rowCount() == 0);
+  QVERIFY(model.canFetchMore(QModelIndex()));
+
+  model.fetchMore(QModelIndex());
+  QVERIFY(model.rowCount() > 0);
+  QVERIFY(model.rowCount() < 600);
+  QVERIFY(model.data(model.index(10, LayerModel::LAYER_NAME), Qt::DisplayRole).toString() == "layer 10");
+
+  while (model.canFetchMore(QModelIndex())) {
+    model.fetchMore(QModelIndex());
+  }
+  QVERIFY(model.rowCount() == 600);
+  QVERIFY(model.getLayer(model.index(599, 0))->getName() == "layer 599");
+
+  model.removeLayer(model.index(0, 0));
+  QVERIFY(model.rowCount() == 599);
+  QVERIFY(c->getLayerCount() == 599);
+  QVERIFY(c->getLayer(0)->getName() == "layer 1");
+
+  model.setMapfile(NULL);
+  delete c;
+}
+
+/**
+ * Checks that the cells are read again once their layer is modified.
+ */
+void TestLayer::testLayerModelCache()
+{
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  LayerModel model(NULL, p);
+  model.fetchMore(QModelIndex());
+  QVERIFY(model.rowCount() == 2);
+
+  QVERIFY(model.getValue(1, LayerModel::LAYER_NAME).toString() == "World contour");
+  QVERIFY(model.getValue(1, LayerModel::LAYER_OPACITY).toInt() == 20);
+  QVERIFY(model.getColumn(LayerModel::LAYER_MIN_X).at(0).toDouble() == -180);
+
+  Layer * l = p->getLayer(1);
+  quint64 revision = l->getRevision();
+  QSignalSpy changed(& model, SIGNAL(dataChanged(QModelIndex, QModelIndex)));
+
+  // unmodified layers are not notified
+  model.refresh();
+  QVERIFY(changed.count() == 0);
+
+  l->setOpacity(50);
+  QVERIFY(l->getRevision() != revision);
+  model.refresh();
+  QVERIFY(changed.count() == 1);
+  QVERIFY(changed.first().at(0).value<QModelIndex>().row() == 1);
+  QVERIFY(model.getValue(1, LayerModel::LAYER_OPACITY).toInt() == 50);
+  QVERIFY(model.getColumn(LayerModel::LAYER_OPACITY).at(1).toInt() == 50);
+
+  model.setMapfile(NULL);
+  delete p;
+}
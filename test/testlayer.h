@@ -9,6 +9,9 @@ class TestLayer: public QObject
   Q_OBJECT
       private slots:
         void testLayer(void);
+        void testLayerIndex(void);
+        void testLayerModel(void);
+        void testLayerModelCache(void);
 
 };
 
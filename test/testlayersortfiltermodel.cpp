@@ -0,0 +1,55 @@
+#include "testlayersortfiltermodel.h"
+
+#include "../layersortfiltermodel.h"
+#include "../parser/mapfileparser.h"
+
+/** names are compared regardless of the case */
+void TestLayerSortFilterModel::testSort() {
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  LayerModel model(NULL, p);
+  model.fetchMore(QModelIndex());
+  LayerSortFilterModel proxy;
+  proxy.setSourceModel(& model);
+  QVERIFY(proxy.rowCount() == 2);
+
+  proxy.sort(LayerModel::LAYER_NAME, Qt::AscendingOrder);
+  QVERIFY(proxy.mapToSource(proxy.index(0, 0)).row() == 1);
+  QVERIFY(proxy.index(1, LayerModel::LAYER_NAME).data().toString() == "world raster");
+
+  proxy.sort(LayerModel::LAYER_NAME, Qt::DescendingOrder);
+  QVERIFY(proxy.mapToSource(proxy.index(0, 0)).row() == 0);
+
+  // a renamed layer moves once the model is refreshed
+  p->getLayer(0)->setName("Aaa");
+  model.refresh();
+  proxy.sort(LayerModel::LAYER_NAME, Qt::AscendingOrder);
+  QVERIFY(proxy.index(0, LayerModel::LAYER_NAME).data().toString() == "Aaa");
+
+  model.setMapfile(NULL);
+  QVERIFY(proxy.rowCount() == 0);
+  delete p;
+}
+
+void TestLayerSortFilterModel::testFilter() {
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  LayerModel model(NULL, p);
+  model.fetchMore(QModelIndex());
+  LayerSortFilterModel proxy;
+  proxy.setSourceModel(& model);
+
+  proxy.setFilter(QRegExp("raster", Qt::CaseInsensitive), LayerModel::LAYER_NAME);
+  QVERIFY(proxy.rowCount() == 1);
+  QVERIFY(proxy.mapToSource(proxy.index(0, 0)).row() == 0);
+
+  proxy.setFilter(QRegExp("^common$"), LayerModel::LAYER_GROUP);
+  QVERIFY(proxy.rowCount() == 2);
+
+  proxy.setFilter(QRegExp("^contour"), LayerModel::LAYER_NAME);
+  QVERIFY(proxy.rowCount() == 0);
+
+  proxy.setFilter(QRegExp(), LayerModel::LAYER_NAME);
+  QVERIFY(proxy.rowCount() == 2);
+
+  model.setMapfile(NULL);
+  delete p;
+}
@@ -0,0 +1,18 @@
+#ifndef TESTLAYERSORTFILTERMODEL_H
+#define TESTLAYERSORTFILTERMODEL_H
+
+#include "autotest.h"
+
+class TestLayerSortFilterModel: public QObject
+{
+  Q_OBJECT
+      private slots:
+        void testSort(void);
+        void testFilter(void);
+
+};
+
+DECLARE_TEST(TestLayerSortFilterModel)
+
+
+#endif // TESTLAYERSORTFILTERMODEL_H
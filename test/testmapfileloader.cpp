@@ -0,0 +1,92 @@
+#include "testmapfileloader.h"
+
+#include "../mapfileloader.h"
+
+#include <QDir>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+/** the mapfile is loaded, its symbolset and fontset being scanned first */
+void TestMapfileLoader::testLoading() {
+  MapfileLoader loader("../data/world_mapfile.map");
+  QSignalSpy progress(& loader, SIGNAL(progress(qint64, int)));
+  QSignalSpy parsing(& loader, SIGNAL(parsing()));
+
+  loader.start();
+  QVERIFY(loader.wait(30000));
+
+  QVERIFY(parsing.count() == 1);
+  QVERIFY(progress.count() >= 3);
+  QVERIFY(progress.last().at(0).toLongLong() > 0);
+  QVERIFY(progress.last().at(1).toInt() == 2); // FONTSET and SYMBOLSET
+
+  MapfileParser * p = loader.takeParser();
+  QVERIFY(p != NULL);
+  QVERIFY(p->isLoaded());
+  QVERIFY(p->getLayerCount() == 2);
+  // given once only
+  QVERIFY(loader.takeParser() == NULL);
+  delete p;
+}
+
+/** a cancelled loading gives no parser */
+void TestMapfileLoader::testCancel() {
+  MapfileLoader loader("../data/world_mapfile.map");
+  QSignalSpy parsing(& loader, SIGNAL(parsing()));
+
+  loader.cancel();
+  loader.start();
+  QVERIFY(loader.wait(30000));
+
+  QVERIFY(loader.isCancelled());
+  QVERIFY(parsing.count() == 0);
+  QVERIFY(loader.takeParser() == NULL);
+}
+
+/** the second loading of the same content gives its snapshot beforehand */
+void TestMapfileLoader::testSnapshotCache() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  SnapshotCache cache(dir.path());
+
+  MapfileLoader first("../data/world_mapfile.map");
+  first.setSnapshotCache(cache);
+  QSignalSpy firstSnapshots(& first, SIGNAL(snapshotLoaded(MapfileSnapshot)));
+  first.start();
+  QVERIFY(first.wait(30000));
+  QVERIFY(firstSnapshots.count() == 0);
+  QVERIFY(! first.getContentHash().isEmpty());
+  delete first.takeParser();
+
+  MapfileLoader second("../data/world_mapfile.map");
+  second.setSnapshotCache(cache);
+  QSignalSpy secondSnapshots(& second, SIGNAL(snapshotLoaded(MapfileSnapshot)));
+  second.start();
+  QVERIFY(second.wait(30000));
+  QVERIFY(second.getContentHash() == first.getContentHash());
+  QVERIFY(secondSnapshots.count() == 1);
+
+  MapfileSnapshot snapshot = secondSnapshots.first().at(0).value<MapfileSnapshot>();
+  QVERIFY(snapshot.mapName == "World Map");
+  QVERIFY(snapshot.layers.size() == 2);
+  QVERIFY(snapshot.layers[1].name == "World contour");
+  delete second.takeParser();
+}
+
+/** the cache keeps its most recent entries only */
+void TestMapfileLoader::testSnapshotCacheEviction() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  SnapshotCache cache(dir.path(), 3);
+
+  MapfileSnapshot snapshot;
+  snapshot.mapName = "World Map";
+  for (int i = 0; i < 5; ++i) {
+    QVERIFY(cache.store(QByteArray(1, char(i)), snapshot));
+  }
+  QVERIFY(QDir(dir.path()).entryList(QStringList() << "*.snapshot", QDir::Files).size() == 3);
+
+  MapfileSnapshot read;
+  QVERIFY(cache.load(QByteArray(1, char(4)), read));
+  QVERIFY(read.mapName == "World Map");
+}
@@ -0,0 +1,20 @@
+#ifndef TESTMAPFILELOADER_H
+#define TESTMAPFILELOADER_H
+
+#include "autotest.h"
+
+class TestMapfileLoader: public QObject
+{
+  Q_OBJECT
+      private slots:
+        void testLoading(void);
+        void testCancel(void);
+        void testSnapshotCache(void);
+        void testSnapshotCacheEviction(void);
+
+};
+
+DECLARE_TEST(TestMapfileLoader)
+
+
+#endif // TESTMAPFILELOADER_H
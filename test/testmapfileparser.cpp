@@ -1,7 +1,9 @@
 #include "testmapfileparser.h"
 #include "../parser/mapfileparser.h"
 
+#include <QBuffer>
 #include <QDir>
+#include <QTemporaryDir>
 
 /** tests construtor */
 void TestMapfileParser::testInitMapfileParser()
@@ -17,6 +19,28 @@ void TestMapfileParser::testInitMapfileParser()
   delete p;
 }
 
+/** tests the copy constructor (used by the preview renderer) */
+void TestMapfileParser::testCopyMapfileParser() {
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  MapfileParser * c = new MapfileParser(* p);
+
+  QVERIFY(c->isLoaded());
+  QVERIFY(c->getMapName() == "World Map");
+  QVERIFY(c->getLayers().size() == 2);
+  QVERIFY(c->getMetadatas().size() == 9);
+
+  // modifying the copy should not alter the original
+  c->setMapName("copy");
+  c->setMapExtent(0, 0, 10, 10);
+  QVERIFY(p->getMapName() == "World Map");
+  QVERIFY(p->getMapExtentMaxX() == 180);
+
+  delete c;
+  // the original is still usable once the copy is gone
+  QVERIFY(p->getCurrentMapImage(100, 100) != NULL);
+  delete p;
+}
+
 /** tests getters / setters for the map name */
 void TestMapfileParser::testMapName() {
   MapfileParser * p = new MapfileParser();
@@ -69,6 +93,309 @@ void TestMapfileParser::testGetCurrentMapImage() {
 
 }
 
+/** tests drawing map without encoding (MapfileParser::getCurrentMapRawImage() */
+void TestMapfileParser::testGetCurrentMapRawImage() {
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  QVERIFY(p->isLoaded());
+
+  QImage im = p->getCurrentMapRawImage(500, 250);
+  QVERIFY(! im.isNull());
+  QVERIFY(im.width() == 500 && im.height() == 250);
+
+  // the image should remain valid once the parser is gone
+  delete p;
+  QImage copy = im.copy();
+  QVERIFY(copy.size() == im.size());
+
+  // invalid mapfile: null image
+  p = new MapfileParser("/dev/urandom");
+  QVERIFY(p->getCurrentMapRawImage(500, 250).isNull());
+  delete p;
+}
+
+/** tests drawing a single layer (MapfileParser::getLayerRawImage() */
+void TestMapfileParser::testGetLayerRawImage() {
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  QVERIFY(p->isLoaded());
+  QVERIFY(p->getLayerOrder() == QList<int>() << 0 << 1);
+
+  // read without creating the wrappers
+  QVERIFY(p->getLayerOpacity(0) == 20);
+  QVERIFY(p->getLayerStatus(2) == -1);
+  QVERIFY(! p->layerRequiresOthers(0));
+  quint64 unwrapped = p->getLayerRenderStamp(0);
+  QVERIFY(unwrapped != p->getLayerRenderStamp(1));
+  QVERIFY(p->getLayersRevision() == 0);
+  QVERIFY(p->getLayer(0)->getRenderStamp() == p->getLayerRenderStamp(0));
+  QVERIFY(p->getLayerRenderStamp(0) != unwrapped);
+
+  QImage im = p->getLayerRawImage(1, 500, 250);
+  QVERIFY(! im.isNull());
+  QVERIFY(im.width() == 500 && im.height() == 250);
+  QVERIFY(im.hasAlphaChannel());
+
+  // the opacity is left to the compositing, but is kept in the mapfile
+  QVERIFY(! p->getLayerRawImage(0, 500, 250).isNull());
+  QVERIFY(p->getLayers().at(0)->getOpacity() == 20);
+
+  QVERIFY(p->getLayerRawImage(2, 500, 250).isNull());
+
+  // no labels to draw over the layers, the overlay is blank
+  QVERIFY(! p->hasLabels());
+  QImage labels = p->getLabelsRawImage(500, 250);
+  QVERIFY(labels.width() == 500 && labels.height() == 250);
+
+  // render stamps & revision
+  Layer * l = p->getLayers().at(1);
+  quint64 stamp = l->getRenderStamp();
+  QVERIFY(stamp != p->getLayers().at(0)->getRenderStamp());
+  l->setOpacity(50);
+  l->setStatus(0);
+  QVERIFY(l->getRenderStamp() == stamp);
+  l->setMinScaleDenom(1000);
+  QVERIFY(l->getRenderStamp() != stamp);
+
+  quint64 revision = p->getRenderRevision();
+  p->setMapName("renamed");
+  QVERIFY(p->getRenderRevision() == revision);
+  p->setShapepath("/tmp");
+  QVERIFY(p->getRenderRevision() != revision);
+
+  delete p;
+}
+
+/** tests drawing a draft of the map (MapfileParser::getCurrentMapDraftImage() */
+void TestMapfileParser::testGetCurrentMapDraftImage() {
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  QVERIFY(p->isLoaded());
+
+  double resolution = p->getResolution();
+  int maxFeatures = p->getLayers().at(1)->getMaxFeatures();
+
+  QImage im = p->getCurrentMapDraftImage(125, 62, 4, 10);
+  QVERIFY(! im.isNull());
+  QVERIFY(im.width() == 125 && im.height() == 62);
+
+  // the mapfile is left untouched
+  QVERIFY(p->getResolution() == resolution);
+  QVERIFY(p->getLayers().at(1)->getMaxFeatures() == maxFeatures);
+
+  QVERIFY(p->getCurrentMapDraftImage(125, 62, 0, 10).isNull());
+
+  delete p;
+}
+
+/** tests profiling the drawing of the layers */
+void TestMapfileParser::testProfileCurrentMap() {
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  QVERIFY(p->isLoaded());
+
+  double minx = p->getMapExtentMinX();
+  QList<LayerProfile> profile = p->profileCurrentMap(500, 250);
+
+  // a layer per layer, then the labels
+  QVERIFY(profile.size() == 3);
+  QVERIFY(profile.at(0).name == "world raster");
+  QVERIFY(profile.at(0).index == 0);
+  QVERIFY(profile.at(0).features == 0);
+  QVERIFY(profile.at(1).name == "World contour");
+  QVERIFY(profile.at(2).index == LayerProfile::LABELS);
+  for (int i = 0; i < profile.size(); ++i) {
+    QVERIFY(profile.at(i).time >= 0);
+  }
+
+  QVERIFY(p->getMapExtentMinX() == minx);
+
+  delete p;
+}
+
+/** the snapshot of a mapfile survives a round trip through the cache */
+void TestMapfileParser::testSnapshot() {
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  MapfileSnapshot snapshot = p->getSnapshot();
+  int outputFormats = p->getOutputFormats().size();
+  delete p;
+
+  QVERIFY(snapshot.isValid());
+  QVERIFY(snapshot.mapName == "World Map");
+  QVERIFY(snapshot.layers.size() == 2);
+  QVERIFY(snapshot.layers[0].name == "world raster");
+  QVERIFY(snapshot.layers[1].minx == -180);
+  QVERIFY(snapshot.outputFormats.size() == outputFormats);
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  SnapshotCache cache(dir.path());
+  MapfileSnapshot read;
+  QVERIFY(! cache.load("key", read));
+  QVERIFY(cache.store("key", snapshot));
+  QVERIFY(cache.load("key", read));
+
+  QVERIFY(read.mapName == snapshot.mapName);
+  QVERIFY(read.projection == snapshot.projection);
+  QVERIFY(read.metadatas == snapshot.metadatas);
+  QVERIFY(read.outputFormats.size() == outputFormats);
+  QVERIFY(read.outputFormats[0].name == snapshot.outputFormats[0].name);
+  QVERIFY(read.layers.size() == 2);
+  QVERIFY(read.layers[1].name == "World contour");
+  QVERIFY(read.layers[1].status == snapshot.layers[1].status);
+  QVERIFY(read.layers[1].maxy == 90);
+}
+
+/** the text is the same as the one of a saved mapfile */
+void TestMapfileParser::testMapfileText() {
+  MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
+  QByteArray text = p->getMapfileText();
+  QVERIFY(text.contains("World contour"));
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString path = dir.path() + "/world.map";
+  QVERIFY(p->saveMapfile(path));
+  QFile saved(path);
+  QVERIFY(saved.open(QIODevice::ReadOnly));
+  QVERIFY(saved.readAll() == text);
+
+  QByteArray streamed;
+  QBuffer buffer(& streamed);
+  QVERIFY(! p->writeMapfile(& buffer));
+  buffer.open(QIODevice::WriteOnly);
+  QVERIFY(p->writeMapfile(& buffer));
+  QVERIFY(streamed == text);
+
+  delete p;
+}
+
+static void writeFile(QString const & path, QByteArray const & content) {
+  QFile f(path);
+  f.open(QIODevice::WriteOnly);
+  f.write(content);
+}
+
+/** only the modified blocks are written, into the files they come from */
+void TestMapfileParser::testIncrementalSave() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString main = dir.path() + "/main.map", included = dir.path() + "/layers.inc";
+  QByteArray mainContent =
+    "# main mapfile\n"
+    "MAP\n"
+    "  NAME \"patched\"\n"
+    "  EXTENT -180 -90 180 90\n"
+    "  SIZE 400 300\n"
+    "  WEB\n"
+    "    METADATA\n"
+    "      \"wms_title\" \"Patched\" # the title\n"
+    "    END\n"
+    "  END\n"
+    "  INCLUDE \"layers.inc\"\n"
+    "END\n";
+  QByteArray first =
+    "# first layer, untouched\n"
+    "LAYER\n"
+    "  NAME \"first\"\n"
+    "  TYPE POLYGON\n"
+    "  STATUS ON\n"
+    "  CLASS\n"
+    "    NAME \"all\"\n"
+    "    STYLE\n"
+    "      COLOR 255 0 0\n"
+    "    END\n"
+    "  END\n"
+    "END\n"
+    "\n";
+  QByteArray second =
+    "LAYER\n"
+    "  NAME 'second'\n"
+    "  TYPE LINE\n"
+    "  STATUS OFF\n"
+    "END\n";
+  writeFile(main, mainContent);
+  writeFile(included, first + second + "# trailing comment\n");
+
+  MapfileParser * p = new MapfileParser(main);
+  QVERIFY(p->getLayerCount() == 2);
+  QVERIFY(p->enableIncrementalSave());
+
+  QHash<QString, QByteArray> files;
+  QVERIFY(p->getFilesToSave(files));
+  QVERIFY(files.isEmpty());
+
+  p->getLayer(1)->setOpacity(50);
+  QVERIFY(p->getFilesToSave(files));
+  QVERIFY(files.keys() == QStringList() << included);
+  QByteArray patched = files.value(included);
+  QVERIFY(patched.startsWith(first + "LAYER\n"));
+  QVERIFY(patched.endsWith("END\n# trailing comment\n"));
+  QVERIFY(patched.contains("50"));
+
+  writeFile(included, patched);
+  p->setSaveSucceeded();
+  MapfileParser * reloaded = new MapfileParser(main);
+  QVERIFY(reloaded->getLayerCount() == 2);
+  QVERIFY(reloaded->getLayer(1)->getOpacity() == 50);
+  delete reloaded;
+
+  // the patches were not all written, the changes are looked for again in
+  // the files as they are
+  p->getLayer(1)->setOpacity(60);
+  QVERIFY(p->getFilesToSave(files));
+  QVERIFY(files.keys() == QStringList() << included);
+  p->setSaveFailed();
+  QVERIFY(p->isIncrementalSaveEnabled());
+  QVERIFY(p->getPatchedFiles(files));
+  QVERIFY(files.keys() == QStringList() << included);
+  QVERIFY(files.value(included).contains("60"));
+  writeFile(included, files.value(included));
+  p->setSaveSucceeded();
+
+  // the keywords of the map are patched in place too
+  p->setMapName("renamed");
+  QVERIFY(p->getFilesToSave(files));
+  QVERIFY(files.keys() == QStringList() << main);
+  QVERIFY(files.value(main) == QByteArray(mainContent).replace("\"patched\"", "\"renamed\""));
+  writeFile(main, files.value(main));
+  p->setSaveSucceeded();
+
+  // a new one is inserted next to the others
+  p->setAngle(30);
+  QVERIFY(p->getFilesToSave(files));
+  QVERIFY(files.keys() == QStringList() << main);
+  QVERIFY(files.value(main).contains("\n  ANGLE 30\n"));
+  QVERIFY(files.value(main).contains("INCLUDE \"layers.inc\""));
+  writeFile(main, files.value(main));
+  p->setSaveSucceeded();
+
+  // a new layer goes after the last one, a removed one is deleted
+  p->removeLayer("first");
+  p->addLayer("third", false);
+  QVERIFY(p->getFilesToSave(files));
+  QVERIFY(files.keys() == QStringList() << included);
+  QByteArray layers = files.value(included);
+  QVERIFY(layers.startsWith("# first layer, untouched\n\nLAYER\n"));
+  QVERIFY(! layers.contains("\"first\""));
+  QVERIFY(layers.indexOf("second") < layers.indexOf("third"));
+  QVERIFY(layers.endsWith("END\n# trailing comment\n"));
+  writeFile(included, layers);
+  p->setSaveSucceeded();
+  reloaded = new MapfileParser(main);
+  QVERIFY(reloaded->getLayerCount() == 2);
+  QVERIFY(reloaded->getLayer(0)->getName() == "second");
+  QVERIFY(reloaded->getLayer(1)->getName() == "third");
+  QVERIFY(reloaded->getMapName() == "renamed");
+  delete reloaded;
+
+  // saving the whole mapfile merges the included files into it
+  QVERIFY(p->hasIncludes());
+  QVERIFY(p->getFilesToSave(files, false));
+  QVERIFY(files.keys() == QStringList() << main);
+  QVERIFY(files.value(main) == p->getMapfileText());
+  QVERIFY(! files.value(main).contains("INCLUDE"));
+  QVERIFY(! p->hasIncludes());
+
+  delete p;
+}
+
 /** tests layers getters / setters */
 void TestMapfileParser::testLayers() {
   MapfileParser * p = new MapfileParser("../data/world_mapfile.map");
@@ -260,6 +587,49 @@ void TestMapfileParser::testMetadata() {
   if (p) delete p;
 }
 
+/** tests the parsing of the *_enable_request metadata */
+void TestMapfileParser::testEnabledRequests() {
+  // whole tokens only, the last one winning
+  QVERIFY(! OgcRequests::parse("GetMapXYZ").isEnabled(OgcRequests::GET_MAP));
+  QVERIFY(OgcRequests::parse("getmap").isEnabled(OgcRequests::GET_MAP));
+  QVERIFY(! OgcRequests::parse("* !GetMap").isEnabled(OgcRequests::GET_MAP));
+  QVERIFY(OgcRequests::parse("!* GetMap").isEnabled(OgcRequests::GET_MAP));
+  QVERIFY(! OgcRequests::parse("!* GetMap").isEnabled(OgcRequests::GET_FEATURE_INFO));
+  QVERIFY(OgcRequests::parse("!* GetMap").isSpecified(OgcRequests::GET_FEATURE_INFO));
+
+  MapfileParser * p  = new MapfileParser("../data/world_mapfile.map");
+
+  // wms_enable_request "GetCapabilities GetMap", ows_enable_request "* !DescribeFeatureType"
+  QVERIFY(p->wmsGetMapEnabled());
+  QVERIFY(p->wmsGetFeatureInfoEnabled());
+  QVERIFY(p->wfsGetFeatureEnabled());
+  QVERIFY(! p->wfsDescribeFeatureTypeEnabled());
+
+  // the service-specific metadata takes precedence
+  p->setMetadata("wms_enable_request", "* !GetFeatureInfo");
+  QVERIFY(! p->wmsGetFeatureInfoEnabled());
+  QVERIFY(p->wmsGetLegendGraphicEnabled());
+
+  p->removeMetadata("ows_enable_request");
+  QVERIFY(! p->wfsGetFeatureEnabled());
+  QVERIFY(p->wmsGetMapEnabled());
+
+  // so does the layer-level one
+  Layer * l = p->getLayer(0);
+  QVERIFY(p->isRequestEnabled(OgcRequests::WMS, OgcRequests::GET_MAP, l));
+  l->setMetadata("wms_enable_request", "!GetMap GetFeatureInfo");
+  QVERIFY(l->getMetadata("wms_enable_request") == "!GetMap GetFeatureInfo");
+  QVERIFY(! p->isRequestEnabled(OgcRequests::WMS, OgcRequests::GET_MAP, l));
+  QVERIFY(p->isRequestEnabled(OgcRequests::WMS, OgcRequests::GET_FEATURE_INFO, l));
+  QVERIFY(p->isRequestEnabled(OgcRequests::WMS, OgcRequests::GET_CAPABILITIES, l));
+  QVERIFY(p->wmsGetMapEnabled());
+
+  l->removeMetadata("wms_enable_request");
+  QVERIFY(p->isRequestEnabled(OgcRequests::WMS, OgcRequests::GET_MAP, l));
+
+  delete p;
+}
+
 /** test shape path */
 void TestMapfileParser::testShapePath() {
   MapfileParser * p  = new MapfileParser("../data/world_mapfile.map");
@@ -9,9 +9,17 @@ class TestMapfileParser: public QObject
   Q_OBJECT
       private slots:
       void testInitMapfileParser();
+      void testCopyMapfileParser();
       void testMapName();
       void testFilePath();
       void testGetCurrentMapImage();
+      void testGetCurrentMapRawImage();
+      void testGetLayerRawImage();
+      void testGetCurrentMapDraftImage();
+      void testProfileCurrentMap();
+      void testSnapshot();
+      void testMapfileText();
+      void testIncrementalSave();
       void testLayers();
       void testStatus();
       void testWidthHeight();
@@ -22,6 +30,7 @@ class TestMapfileParser: public QObject
       void testDebug();
       void testConfigOptions();
       void testMetadata();
+      void testEnabledRequests();
       void testShapePath();
       void testSymbolSet();
       void testFontSet();
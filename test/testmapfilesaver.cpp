@@ -0,0 +1,57 @@
+#include "testmapfilesaver.h"
+
+#include "../mapfilesaver.h"
+#include "../parser/mapfileparser.h"
+
+#include <QDir>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+static QByteArray readFile(QString const & path) {
+  QFile f(path);
+  f.open(QIODevice::ReadOnly);
+  return f.readAll();
+}
+
+/** no temporary file is left behind */
+void TestMapfileSaver::testReplaceFile() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString path = dir.path() + "/test.map";
+
+  QVERIFY(MapfileParser::replaceFile(path, "MAP\nEND\n"));
+  QVERIFY(MapfileParser::replaceFile(path, "MAP\n  NAME \"test\"\nEND\n"));
+  QVERIFY(readFile(path) == "MAP\n  NAME \"test\"\nEND\n");
+  QVERIFY(QDir(dir.path()).entryList(QDir::Files) == QStringList() << "test.map");
+
+  QVERIFY(! MapfileParser::replaceFile(dir.path() + "/missing/test.map", "MAP\nEND\n"));
+
+  // the "save" action writes to the mapfile which has been loaded
+  MapfileParser p(path);
+  QVERIFY(p.isLoaded());
+  p.setMapName("saved");
+  QVERIFY(p.saveMapfile(QString()));
+  QVERIFY(readFile(path).contains("saved"));
+}
+
+/** the last content of a file is the one written */
+void TestMapfileSaver::testSaving() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString first = dir.path() + "/first.map", second = dir.path() + "/second.map";
+
+  MapfileSaver saver;
+  QSignalSpy saved(& saver, SIGNAL(saved(QString, bool)));
+  for (int i = 0; i < 10; ++i) {
+    saver.save(first, QByteArray("# ") + QByteArray::number(i));
+  }
+  saver.save(second, "# second");
+  QVERIFY(saver.wait(30000));
+
+  QVERIFY(saver.getPendingCount() == 0);
+  QVERIFY(saved.count() == 11 - saver.getCoalescedCount());
+  QVERIFY(saved.last().at(0).toString() == second);
+  QVERIFY(saved.last().at(1).toBool());
+  QVERIFY(readFile(first) == "# 9");
+  QVERIFY(readFile(second) == "# second");
+}
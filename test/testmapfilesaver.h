@@ -0,0 +1,18 @@
+#ifndef TESTMAPFILESAVER_H
+#define TESTMAPFILESAVER_H
+
+#include "autotest.h"
+
+class TestMapfileSaver: public QObject
+{
+  Q_OBJECT
+      private slots:
+        void testReplaceFile(void);
+        void testSaving(void);
+
+};
+
+DECLARE_TEST(TestMapfileSaver)
+
+
+#endif // TESTMAPFILESAVER_H
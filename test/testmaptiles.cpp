@@ -0,0 +1,54 @@
+#include "testmaptiles.h"
+
+#include "../maptiles.h"
+
+/** tests the zoom levels / tiles computation */
+void TestMapTiles::testTilePyramid() {
+  // level 0: the whole world into a single tile
+  TilePyramid p(-180, -90, 180, 90);
+
+  QVERIFY(p.getResolution(0) == 360.0 / TilePyramid::TILE_SIZE);
+  QVERIFY(p.getResolution(1) == p.getResolution(0) / 2);
+  QVERIFY(p.getResolution(-1) == p.getResolution(0) * 2);
+
+  QVERIFY(p.getZoomLevel(p.getResolution(0)) == 0);
+  QVERIFY(p.getZoomLevel(p.getResolution(3)) == 3);
+  // closest level
+  QVERIFY(p.getZoomLevel(p.getResolution(3) * 1.2) == 3);
+  QVERIFY(p.getZoomLevel(p.getResolution(3) * 1.8) == 2);
+
+  QRect r = p.getTileRange(0, -180, -90, 180, 90);
+  QVERIFY(r.left() == 0 && r.top() == 0);
+  QVERIFY(r.width() == 1 && r.height() == 1);
+
+  // level 1: 2x2 tiles for the upper half of the world
+  r = p.getTileRange(1, -179, 1, 179, 89);
+  QVERIFY(r.width() == 2 && r.height() == 1);
+
+  MapTile t = p.getTile(1, 1, 0, 42);
+  QVERIFY(t.minx == 0 && t.maxx == 180);
+  QVERIFY(t.maxy == 90 && t.miny == -90);
+  QVERIFY(t.width == TilePyramid::TILE_SIZE);
+  QVERIFY(t.key == TileKey(1, 1, 0, 42));
+
+  // undefined extent should not lead to a null resolution
+  TilePyramid blank(-1, -1, -1, -1);
+  QVERIFY(blank.getResolution(0) > 0);
+}
+
+/** tests the tiles identification */
+void TestMapTiles::testTileKey() {
+  QVERIFY(TileKey(1, 2, 3, 4) == TileKey(1, 2, 3, 4));
+  QVERIFY(! (TileKey(1, 2, 3, 4) == TileKey(1, 2, 3, 5)));
+  QVERIFY(! (TileKey(1, 2, 3, 4) == TileKey(1, 3, 2, 4)));
+
+  QHash<TileKey, int> h;
+  h.insert(TileKey(1, 2, 3, 4), 1);
+  h.insert(TileKey(1, 3, 2, 4), 2);
+  QVERIFY(h.size() == 2);
+  QVERIFY(h.value(TileKey(1, 2, 3, 4)) == 1);
+
+  QVERIFY(LayerTileKey(TileKey(1, 2, 3, 4), 5) == LayerTileKey(TileKey(1, 2, 3, 4), 5));
+  QVERIFY(! (LayerTileKey(TileKey(1, 2, 3, 4), 5) == LayerTileKey(TileKey(1, 2, 3, 4), 6)));
+  QVERIFY(MapTile().layer == MapTile::WHOLE_MAP);
+}
@@ -0,0 +1,18 @@
+#ifndef TESTMAPTILES_H
+#define TESTMAPTILES_H
+
+#include "autotest.h"
+
+class TestMapTiles: public QObject
+{
+  Q_OBJECT
+      private slots:
+        void testTilePyramid(void);
+        void testTileKey(void);
+
+};
+
+DECLARE_TEST(TestMapTiles)
+
+
+#endif // TESTMAPTILES_H
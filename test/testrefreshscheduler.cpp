@@ -0,0 +1,40 @@
+#include "testrefreshscheduler.h"
+
+#include "../refreshscheduler.h"
+
+#include <QSignalSpy>
+
+/** requests made within the same window lead to a single refresh */
+void TestRefreshScheduler::testCoalescing() {
+  RefreshScheduler s(0, 20);
+  QSignalSpy spy(& s, SIGNAL(refresh()));
+
+  for (int i = 0; i < 5; ++i) {
+    s.schedule();
+  }
+  QTest::qWait(100);
+
+  QVERIFY(spy.count() == 1);
+  QVERIFY(s.getRequestCount() == 5);
+  QVERIFY(s.getRefreshCount() == 1);
+  QVERIFY(s.getSavedCount() == 4);
+
+  s.schedule();
+  QTest::qWait(100);
+  QVERIFY(spy.count() == 2);
+  QVERIFY(s.getSavedCount() == 4);
+}
+
+/** a refresh made in the meantime drops the pending requests */
+void TestRefreshScheduler::testPerformed() {
+  RefreshScheduler s(0, 20);
+  QSignalSpy spy(& s, SIGNAL(refresh()));
+
+  s.schedule();
+  s.schedule();
+  s.performed();
+  QTest::qWait(100);
+
+  QVERIFY(spy.count() == 0);
+  QVERIFY(s.getSavedCount() == 2);
+}
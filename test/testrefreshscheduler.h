@@ -0,0 +1,18 @@
+#ifndef TESTREFRESHSCHEDULER_H
+#define TESTREFRESHSCHEDULER_H
+
+#include "autotest.h"
+
+class TestRefreshScheduler: public QObject
+{
+  Q_OBJECT
+      private slots:
+        void testCoalescing(void);
+        void testPerformed(void);
+
+};
+
+DECLARE_TEST(TestRefreshScheduler)
+
+
+#endif // TESTREFRESHSCHEDULER_H